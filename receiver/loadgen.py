@@ -0,0 +1,513 @@
+#!/usr/bin/env python3
+"""
+brakeMachine fleet load generator — benchmarks receiver.py.
+
+Simulates N devices posting realistic 920i dumps the way DataUploader
+does: one kept-alive HTTP/1.1 connection per device, a summary POST
+ahead of each dump, immediate retries paced by the measured link, and
+duplicate resends. Reports request throughput, latency percentiles,
+error rates and the receiver's disk write bandwidth.
+
+Usage:
+    python loadgen.py --spawn                          # local receiver, defaults
+    python loadgen.py --spawn --devices 50 --rate 0    # closed loop, max throughput
+    python loadgen.py --url http://10.0.0.5:5000/upload --dir Z:\\WeightData
+    python loadgen.py --spawn --save-baseline base.json
+    python loadgen.py --spawn --baseline base.json     # exit 1 on regression
+
+--rate is dumps per minute per device; 0 sends back to back. Disk
+bandwidth is measured from the growth of --dir (implied with --spawn).
+
+No dependencies beyond Python 3.7+ stdlib.
+"""
+import argparse
+import datetime
+import http.client
+import json
+import os
+import random
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.parse
+import zlib
+
+# Mirrors config.h and LinkQuality: immediate attempts (1 once the link
+# has failed twice in a row), retry delay and timeouts from the measured
+# connect time and RTT, widened per failure in a row
+UPLOAD_ATTEMPTS = 3
+HTTP_IDLE_CLOSE_S = 20.0
+HTTP_CONNECT_TIMEOUT_S = 3.0
+HTTP_RESPONSE_TIMEOUT_S = 5.0
+LINK_TIMEOUT_FACTOR = 3
+LINK_CONNECT_RANGE_S = (2.0, 10.0)
+LINK_RESPONSE_RANGE_S = (5.0, 20.0)
+LINK_FAILURE_WIDEN_MAX = 3
+LINK_EWMA_WEIGHT = 0.25
+# Summaries: retried on their own backoff, 5 s doubling up to 5 min
+SUMMARY_RETRY_INTERVAL_S = 5.0
+SUMMARY_RETRY_MAX_S = 300.0
+SUMMARY_QUEUE_MAX = 16
+
+
+def make_dump(size, seq, rng):
+    """A 920i-style print: banner, column header, tab-separated rows, CR/LF.
+    Returns the bytes and the DumpSummary fields for them."""
+    now = datetime.datetime.now()
+    lines = [
+        "920i Print Output",
+        f"Date: {now:%Y-%m-%d}",
+        f"Time: {now:%H:%M:%S}",
+        "",
+        "ID\tGross\tTare\tNet\tUnit",
+    ]
+    out = "\r\n".join(lines) + "\r\n"
+    row = 1
+    parts = [out]
+    total = len(out)
+    cols = {"gross": [], "tare": [], "net": []}
+    while total < size:
+        gross = round(rng.uniform(500, 4000), 1)
+        tare = 120.0
+        line = f"{seq * 1000 + row}\t{gross:.1f}\t{tare:.1f}\t{gross - tare:.1f}\tlb\r\n"
+        parts.append(line)
+        total += len(line)
+        cols["gross"].append(gross)
+        cols["tare"].append(tare)
+        cols["net"].append(round(gross - tare, 1))
+        row += 1
+
+    summary = {"records": row - 1, "bytes": total}
+    if row > 1:
+        summary.update(first_id=seq * 1000 + 1, last_id=seq * 1000 + row - 1, unit="lb")
+        for name, vals in cols.items():
+            summary[name] = {"total": round(sum(vals), 1), "min": min(vals), "max": max(vals)}
+    return "".join(parts).encode("ascii"), summary
+
+
+def percentile(sorted_vals, pct):
+    if not sorted_vals:
+        return 0.0
+    k = (len(sorted_vals) - 1) * pct / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(sorted_vals) - 1)
+    return sorted_vals[lo] + (sorted_vals[hi] - sorted_vals[lo]) * (k - lo)
+
+
+def dir_bytes(path):
+    total = 0
+    try:
+        for entry in os.scandir(path):
+            if entry.is_file():
+                total += entry.stat().st_size
+    except FileNotFoundError:
+        pass
+    return total
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = []
+        self.codes = {}
+        self.errors = 0         # connection errors / timeouts
+        self.requests = 0
+        self.bytes_sent = 0
+        self.dumps = 0          # distinct dumps generated
+        self.delivered = 0      # dumps acknowledged with 2xx
+        self.retries = 0        # extra attempts after a failure
+        self.duplicates = 0     # resends of an already-acknowledged dump
+        self.abandoned = 0      # dumps that failed all attempts (queued on a device)
+        self.summaries = 0      # summaries acknowledged
+        self.connects = 0       # TCP connections opened
+
+    def record(self, latency, code, nbytes):
+        with self.lock:
+            self.requests += 1
+            self.bytes_sent += nbytes
+            if code is None:
+                self.errors += 1
+            else:
+                self.codes[code] = self.codes.get(code, 0) + 1
+                self.latencies.append(latency)
+
+
+class Link:
+    """The parts of LinkQuality that pace a device's requests."""
+
+    def __init__(self):
+        self.connect = 0.0      # Seconds, smoothed; 0 = not measured yet
+        self.rtt = 0.0
+        self.failures = 0       # Requests failed in a row
+
+    @staticmethod
+    def smooth(avg, sample):
+        return sample if not avg else avg * (1 - LINK_EWMA_WEIGHT) + sample * LINK_EWMA_WEIGHT
+
+    def widen(self, seconds):
+        return seconds * (1 << min(self.failures, LINK_FAILURE_WIDEN_MAX))
+
+    def connect_timeout(self):
+        if not self.connect:
+            return self.widen(HTTP_CONNECT_TIMEOUT_S)
+        lo, hi = LINK_CONNECT_RANGE_S
+        return self.widen(min(max(self.connect * LINK_TIMEOUT_FACTOR + 1.0, lo), hi))
+
+    def response_timeout(self):
+        if not self.rtt:
+            return self.widen(HTTP_RESPONSE_TIMEOUT_S)
+        lo, hi = LINK_RESPONSE_RANGE_S
+        return self.widen(min(max(self.rtt * LINK_TIMEOUT_FACTOR + 1.0, lo), hi))
+
+    def attempts(self):
+        return 1 if self.failures >= 2 else UPLOAD_ATTEMPTS
+
+    def retry_delay(self):
+        if not self.connect:
+            return 0.5
+        return min(max(self.connect * 2, 0.25), 2.0)
+
+
+class Device(threading.Thread):
+    def __init__(self, idx, args, stats, stop):
+        super().__init__(daemon=True)
+        self.id_hdr = f"loadgen-{idx:03d}"
+        self.args = args
+        self.stats = stats
+        self.stop = stop
+        self.rng = random.Random(args.seed + idx)
+        self.next_id = 1
+        url = urllib.parse.urlsplit(args.url)
+        self.host = url.hostname
+        self.port = url.port or 80
+        self.path = url.path or "/upload"
+        self.link = Link()
+        self.conn = None        # One upload session, kept alive across dumps
+        self.last_use = 0.0
+        self.summaries = []     # Undelivered (json, dump_id, ts, crc), oldest first
+        self.summary_failures = 0
+        self.summary_interval = SUMMARY_RETRY_INTERVAL_S
+        self.last_summary_try = 0.0
+
+    def close(self):
+        if self.conn:
+            self.conn.close()
+            self.conn = None
+
+    def connect(self):
+        start = time.perf_counter()
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=self.link.connect_timeout())
+        try:
+            conn.connect()
+        except OSError:
+            conn.close()
+            return False
+        self.link.connect = Link.smooth(self.link.connect, time.perf_counter() - start)
+        conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        with self.stats.lock:
+            self.stats.connects += 1
+        self.conn = conn
+        return True
+
+    def request(self, body, headers):
+        """One request on the open connection; status code or None."""
+        self.conn.sock.settimeout(self.link.response_timeout())
+        try:
+            self.conn.request("POST", self.path, body=body, headers=headers)
+            sent = time.perf_counter()
+            resp = self.conn.getresponse()
+            resp.read()
+        except (OSError, http.client.HTTPException):
+            self.close()
+            return None
+        self.link.rtt = Link.smooth(self.link.rtt, time.perf_counter() - sent)
+        self.link.failures = 0
+        if resp.will_close:
+            self.close()
+        return resp.status
+
+    def post(self, body, content_type, dump_id, ts, crc):
+        """HttpTransport::_post: reuse the session, reconnecting once if
+        the receiver closed it meanwhile."""
+        headers = {
+            "Content-Type": content_type,
+            "X-Device-Name": "brakeMachine",   # Same on every unit, as on the firmware
+            "X-Device-Id": self.id_hdr,
+            "X-Timestamp": ts,
+            "X-Dump-Id": str(dump_id),
+            "X-Channel": "1",
+            "X-Content-CRC32": f"{crc:08x}",
+        }
+        start = time.perf_counter()
+        code = None
+        reused = self.conn is not None
+        if reused or self.connect():
+            code = self.request(body, headers)
+            if code is None and reused and self.connect():
+                code = self.request(body, headers)
+        if code is None:
+            self.link.failures += 1
+        self.last_use = time.perf_counter()
+        self.stats.record(self.last_use - start, code, len(body))
+        return code
+
+    def send_dump(self, body, dump_id, ts, crc):
+        code = self.post(body, "text/tab-separated-values", dump_id, ts, crc)
+        return code is not None and 200 <= code < 300
+
+    def send_summaries(self):
+        """DataUploader::_sendSummaries: oldest first, stop at the first failure."""
+        self.last_summary_try = time.perf_counter()
+        while self.summaries:
+            data, dump_id, ts, crc = self.summaries[0]
+            code = self.post(data, "application/x-brakemachine-summary+json", dump_id, ts, crc)
+            # An older receiver that doesn't take summaries isn't retried
+            if code is None or not (200 <= code < 300 or code in (400, 404, 415)):
+                break
+            self.summaries.pop(0)
+            with self.stats.lock:
+                self.stats.summaries += 1
+
+        if not self.summaries:
+            self.summary_failures = 0
+            self.summary_interval = SUMMARY_RETRY_INTERVAL_S
+        else:
+            self.summary_failures = min(self.summary_failures + 1, 16)
+            self.summary_interval = min(SUMMARY_RETRY_INTERVAL_S * (1 << self.summary_failures),
+                                        SUMMARY_RETRY_MAX_S)
+
+    def idle(self, seconds):
+        """Wait between dumps, doing what DataUploader::update() would:
+        summary retries and closing a session idle for HTTP_IDLE_CLOSE_S."""
+        until = time.perf_counter() + seconds
+        while not self.stop.is_set():
+            now = time.perf_counter()
+            if self.conn and now - self.last_use >= HTTP_IDLE_CLOSE_S:
+                self.close()
+            if self.summaries and now - self.last_summary_try >= self.summary_interval:
+                self.send_summaries()
+                continue
+            wake = until
+            if self.conn:
+                wake = min(wake, self.last_use + HTTP_IDLE_CLOSE_S)
+            if self.summaries:
+                wake = min(wake, self.last_summary_try + self.summary_interval)
+            if wake <= now:
+                if now >= until:
+                    return
+                continue
+            self.stop.wait(wake - now)
+
+    def run(self):
+        interval = 60.0 / self.args.rate if self.args.rate > 0 else 0.0
+        # Spread start times so devices don't fire in lockstep
+        if interval:
+            self.stop.wait(self.rng.uniform(0, interval))
+
+        while not self.stop.is_set():
+            dump_id = self.next_id
+            self.next_id += 1
+            size = max(256, int(self.rng.gauss(self.args.size, self.args.size * 0.1)))
+            body, summary = make_dump(size, dump_id, self.rng)
+            crc = zlib.crc32(body) & 0xFFFFFFFF
+            ts = datetime.datetime.now().strftime("%Y-%m-%dT%H:%M:%S")
+            with self.stats.lock:
+                self.stats.dumps += 1
+
+            # The summary goes first; while the last try failed it waits
+            # for its backoff instead of holding up the dump
+            summary.update(device="brakeMachine", device_id=self.id_hdr, id=dump_id,
+                           timestamp=ts, channel=1, crc32=f"{crc:08x}")
+            if len(self.summaries) >= SUMMARY_QUEUE_MAX:
+                self.summaries.pop(0)
+            self.summaries.append((json.dumps(summary).encode("utf-8"), dump_id, ts, crc))
+            if self.summary_failures == 0:
+                self.send_summaries()
+
+            ok = False
+            attempts = self.link.attempts()
+            for attempt in range(attempts):
+                if attempt > 0:
+                    with self.stats.lock:
+                        self.stats.retries += 1
+                    time.sleep(self.link.retry_delay())
+                if self.send_dump(body, dump_id, ts, crc):
+                    ok = True
+                    break
+
+            with self.stats.lock:
+                if ok:
+                    self.stats.delivered += 1
+                else:
+                    self.stats.abandoned += 1
+
+            # Lost-ack resend: the device never saw the 200 and retries
+            # the same dump from its queue
+            if ok and self.rng.random() < self.args.dup_rate:
+                with self.stats.lock:
+                    self.stats.duplicates += 1
+                self.send_dump(body, dump_id, ts, crc)
+
+            if interval:
+                self.idle(self.rng.expovariate(1.0 / interval))
+        self.close()
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def spawn_receiver(save_dir):
+    port = free_port()
+    here = os.path.dirname(os.path.abspath(__file__))
+    proc = subprocess.Popen(
+        [sys.executable, os.path.join(here, "receiver.py"),
+         "--host", "127.0.0.1", "--port", str(port), "--dir", save_dir, "--stream-port", "0"],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    deadline = time.time() + 10
+    while time.time() < deadline:
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=0.2).close()
+            return proc, f"http://127.0.0.1:{port}/upload"
+        except OSError:
+            time.sleep(0.1)
+    proc.kill()
+    raise SystemExit("receiver.py did not start")
+
+
+def summarize(stats, elapsed, disk_bytes):
+    lat = sorted(stats.latencies)
+    ok = sum(n for c, n in stats.codes.items() if 200 <= c < 300)
+    return {
+        "requests": stats.requests,
+        "elapsed_s": round(elapsed, 2),
+        "throughput_rps": round(stats.requests / elapsed, 2) if elapsed else 0,
+        "payload_mbps": round(stats.bytes_sent / elapsed / 1e6, 3) if elapsed else 0,
+        "p50_ms": round(percentile(lat, 50) * 1000, 2),
+        "p90_ms": round(percentile(lat, 90) * 1000, 2),
+        "p99_ms": round(percentile(lat, 99) * 1000, 2),
+        "max_ms": round(lat[-1] * 1000, 2) if lat else 0,
+        "error_rate": round((stats.requests - ok) / stats.requests, 4) if stats.requests else 0,
+        "conn_errors": stats.errors,
+        "status_codes": {str(c): n for c, n in sorted(stats.codes.items())},
+        "dumps": stats.dumps,
+        "delivered": stats.delivered,
+        "abandoned": stats.abandoned,
+        "retries": stats.retries,
+        "duplicates": stats.duplicates,
+        "summaries": stats.summaries,
+        "connections": stats.connects,
+        "disk_mbps": round(disk_bytes / elapsed / 1e6, 3) if disk_bytes is not None and elapsed else None,
+    }
+
+
+def compare(result, baseline, tolerance):
+    """Return a list of regressions versus a stored baseline."""
+    problems = []
+    if result["throughput_rps"] < baseline["throughput_rps"] * (1 - tolerance):
+        problems.append(f"throughput {result['throughput_rps']} rps < baseline {baseline['throughput_rps']}")
+    for key in ("p50_ms", "p99_ms"):
+        if result[key] > baseline[key] * (1 + tolerance):
+            problems.append(f"{key} {result[key]} > baseline {baseline[key]}")
+    if result["error_rate"] > baseline["error_rate"] + 0.01:
+        problems.append(f"error rate {result['error_rate']} > baseline {baseline['error_rate']}")
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description="brakeMachine receiver load generator")
+    parser.add_argument("--url", default="http://127.0.0.1:5000/upload", help="Receiver upload URL")
+    parser.add_argument("--spawn", action="store_true", help="Start a local receiver.py in a temp dir")
+    parser.add_argument("--dir", help="Receiver save dir, for disk bandwidth (implied by --spawn)")
+    parser.add_argument("--devices", type=int, default=10, help="Simulated devices (default: 10)")
+    parser.add_argument("--duration", type=float, default=30, help="Seconds to run (default: 30)")
+    parser.add_argument("--rate", type=float, default=6,
+                        help="Dumps per minute per device, 0 = back to back (default: 6)")
+    parser.add_argument("--size", type=int, default=40000, help="Mean dump size in bytes (default: 40000)")
+    parser.add_argument("--dup-rate", type=float, default=0.02,
+                        help="Fraction of dumps resent after success (default: 0.02)")
+    parser.add_argument("--seed", type=int, default=1, help="Random seed (default: 1)")
+    parser.add_argument("--json", action="store_true", help="Print the result as JSON")
+    parser.add_argument("--save-baseline", help="Write the result to this file")
+    parser.add_argument("--baseline", help="Compare against this file; exit 1 on regression")
+    parser.add_argument("--tolerance", type=float, default=0.2,
+                        help="Allowed regression vs baseline (default: 0.2 = 20%%)")
+    args = parser.parse_args()
+
+    proc = None
+    tmp = None
+    if args.spawn:
+        tmp = tempfile.TemporaryDirectory(prefix="loadgen-")
+        args.dir = tmp.name
+        proc, args.url = spawn_receiver(args.dir)
+
+    disk_start = dir_bytes(args.dir) if args.dir else None
+    stats = Stats()
+    stop = threading.Event()
+    devices = [Device(i, args, stats, stop) for i in range(args.devices)]
+
+    print(f"Load: {args.devices} devices x {args.rate or 'max'} dumps/min, "
+          f"~{args.size} B each, {args.duration:.0f}s against {args.url}", file=sys.stderr)
+    start = time.perf_counter()
+    for d in devices:
+        d.start()
+    try:
+        time.sleep(args.duration)
+    except KeyboardInterrupt:
+        pass
+    stop.set()
+    for d in devices:
+        # Worst case: every attempt at the widest timeouts
+        d.join(timeout=(LINK_CONNECT_RANGE_S[1] + LINK_RESPONSE_RANGE_S[1]) * UPLOAD_ATTEMPTS + 5)
+    elapsed = time.perf_counter() - start
+
+    disk_bytes = dir_bytes(args.dir) - disk_start if args.dir else None
+    result = summarize(stats, elapsed, disk_bytes)
+    result["config"] = {k: getattr(args, k) for k in ("devices", "rate", "size", "dup_rate")}
+
+    if proc:
+        proc.terminate()
+        proc.wait()
+    if tmp:
+        tmp.cleanup()
+
+    if args.json:
+        print(json.dumps(result, indent=2))
+    else:
+        print(f"Requests     {result['requests']} in {result['elapsed_s']}s "
+              f"({result['throughput_rps']} req/s, {result['payload_mbps']} MB/s payload)")
+        print(f"Latency      p50 {result['p50_ms']} ms  p90 {result['p90_ms']} ms  "
+              f"p99 {result['p99_ms']} ms  max {result['max_ms']} ms")
+        print(f"Errors       {result['error_rate'] * 100:.2f}%  "
+              f"(conn {result['conn_errors']}, codes {result['status_codes']})")
+        print(f"Dumps        {result['dumps']} generated, {result['delivered']} delivered, "
+              f"{result['abandoned']} abandoned, {result['retries']} retries, "
+              f"{result['duplicates']} duplicate resends")
+        print(f"Sessions     {result['connections']} connections, {result['summaries']} summaries")
+        if result["disk_mbps"] is not None:
+            print(f"Disk writes  {result['disk_mbps']} MB/s")
+
+    if args.save_baseline:
+        with open(args.save_baseline, "w") as f:
+            json.dump(result, f, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get("config") != result["config"]:
+            print(f"WARNING: baseline was run with {baseline.get('config')}, "
+                  f"this run used {result['config']}", file=sys.stderr)
+        problems = compare(result, baseline, args.tolerance)
+        for p in problems:
+            print(f"REGRESSION: {p}", file=sys.stderr)
+        if problems:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
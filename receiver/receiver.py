@@ -6,14 +6,46 @@ Usage:
     python receiver.py
     python receiver.py --port 5000 --dir ./dumps
     python receiver.py --port 5000 --dir "Z:\\WeightData"
+    python receiver.py --dir "Z:\\WeightData" --spool C:\\brakeMachine\\spool
+    python receiver.py --stream-port 0        # disable live reading log
+    python receiver.py --pull                 # also collect from devices on the LAN
+    python receiver.py --pull-from 192.168.1.50 --pull-from scale2.local
+
+With --spool, dumps are committed to a local directory and acknowledged
+at once; a background thread moves them to --dir. Live readings are
+logged there too and appended to --dir in batches. Use it when --dir is
+a network share, so a slow file server doesn't become upload timeouts.
+
+GET /metrics reports per-device counters, latency histograms and dump id
+gaps in Prometheus text format. A device is the unit's X-Device-Id
+(hostname and MAC, e.g. brakemachine-a1b2c3), which also names its
+files; firmware that doesn't send one is known by X-Device-Name.
+
+With --pull (mDNS discovery) or --pull-from HOST, the receiver also
+collects dumps itself: it pages through each device's queue at
+/api/dumps, stores the dumps like uploads and acks them. Devices then
+need no receiver URL, and the receiver sets the ingest pace.
+
+To benchmark a receiver under fleet load, see loadgen.py.
 
 No dependencies beyond Python 3.7+ stdlib.
 """
 import argparse
 import datetime
+import json
 import logging
 import os
-from http.server import BaseHTTPRequestHandler, HTTPServer
+import re
+import socket
+import socketserver
+import struct
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
 
 logging.basicConfig(
     level=logging.INFO,
@@ -22,76 +54,650 @@ logging.basicConfig(
 )
 log = logging.getLogger("receiver")
 
-MAX_BODY = 64 * 1024  # 64 KB safety limit
+MAX_BODY = 16 * 1024 * 1024  # Safety limit; large dumps spill to flash on the device
+MOVER_BATCH = 50       # Files moved per spool pass
+MOVER_MAX_BACKOFF = 60.0
+STREAM_SUFFIX = "_stream.tsv"  # Live reading logs: appended to, not replaced
+# Latency histogram bounds, seconds
+LATENCY_BUCKETS = (0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0)
+MISSING_MAX = 1000     # Missing dump ids remembered per device
+# Pull mode
+MDNS_GROUP = ("224.0.0.251", 5353)
+PULL_DISCOVER_INTERVAL = 60.0  # Seconds between mDNS browses
+PULL_TIMEOUT = 15.0            # Per request to a device
+PULL_MAX_BACKOFF = 300.0
+PULL_GIVE_UP = 10      # Failed polls before an mDNS-found address is dropped
+PULL_PAGE_ERRORS = 3   # Failed fetches in a row that end a page early
+
+
+def write_atomic(path, data):
+    """Write data so that path either doesn't exist or is complete."""
+    folder, name = os.path.split(path)
+    tmp = os.path.join(folder, f".{name}.tmp")
+    with open(tmp, "wb") as f:
+        f.write(data)
+        f.flush()
+        os.fsync(f.fileno())
+    os.replace(tmp, path)
+
+
+class Store:
+    """Where dumps are written: straight into the destination, or into a
+    local spool that a background mover drains into it.
+
+    A file is only acknowledged once it is durable in the spool (temp
+    file, fsync, rename), so a receiver crash loses nothing the device
+    has dropped from its queue. The mover copies files across in batches
+    the same way and deletes the spooled copy afterwards; on errors
+    (share offline) it retries with exponential backoff up to
+    MOVER_MAX_BACKOFF seconds.
+
+    With a spool, requests never touch the destination (often a network
+    share): the mover keeps an index of what it holds, filled from one
+    listing at startup and then from each file moved.
+
+    Live reading logs (*_stream.tsv) are appended to in the spool too.
+    The mover takes what has accumulated (renamed aside under the lock)
+    and appends it to the destination copy, about once a second.
+    """
+
+    def __init__(self, dest_dir, spool_dir=None):
+        self.dest_dir = dest_dir
+        self.spool_dir = spool_dir
+        self.lock = threading.Lock()  # Name choice + write, across handler threads
+        self.moved = 0
+        self.move_errors = 0
+        self.last_error = ""
+        self.backoff = 0.0
+        self.index = {}   # Spool mode: name in dest_dir -> (size, crc32), None if found at startup
+        self._wake = threading.Event()
+        if spool_dir:
+            os.makedirs(spool_dir, exist_ok=True)
+            for name in os.listdir(spool_dir):
+                path = os.path.join(spool_dir, name)
+                if name.endswith(".append"):
+                    # Readings taken aside but not yet appended: put them back
+                    self._unstage(path, os.path.join(spool_dir, name[1:-len(".append")]))
+                elif name.startswith("."):
+                    # Temp files from a crash were never acknowledged
+                    os.remove(path)
+        else:
+            os.makedirs(dest_dir, exist_ok=True)
+
+    def find(self, name):
+        """Path of an existing file, spooled or already moved."""
+        if not self.spool_dir:
+            path = os.path.join(self.dest_dir, name)
+            return path if os.path.exists(path) else None
+        # The mover indexes a file before removing it from the spool, so
+        # one in flight is always found in one place or the other
+        path = os.path.join(self.spool_dir, name)
+        if os.path.exists(path):
+            return path
+        if name in self.index:
+            return os.path.join(self.dest_dir, name)
+        return None
+
+    def holds(self, name, data):
+        """True if name is stored with exactly these bytes. A moved file
+        is compared by the size and CRC the mover recorded; only one
+        that was in the destination before startup is read back."""
+        path = self.find(name)
+        if path is None:
+            return False
+        if self.spool_dir and not path.startswith(self.spool_dir):
+            known = self.index.get(name)
+            if known is not None:
+                return known == (len(data), zlib.crc32(data))
+        with open(path, "rb") as f:
+            return f.read() == data
+
+    def list(self):
+        if not self.spool_dir:
+            return sorted(n for n in os.listdir(self.dest_dir) if not n.startswith("."))
+        names = set(self.index)
+        names.update(n for n in os.listdir(self.spool_dir) if not n.startswith("."))
+        return sorted(names)
+
+    def write(self, name, data):
+        """Commit a file; returns where it landed."""
+        path = os.path.join(self.spool_dir or self.dest_dir, name)
+        write_atomic(path, data)
+        self._wake.set()
+        return path
+
+    def append(self, name, data):
+        """Append to a log file (live readings), in the spool if there is one."""
+        with self.lock:
+            with open(os.path.join(self.spool_dir or self.dest_dir, name), "ab") as f:
+                f.write(data)
+
+    def depth(self):
+        if not self.spool_dir:
+            return 0
+        return sum(1 for n in os.listdir(self.spool_dir) if not n.startswith("."))
+
+    def run_mover(self):
+        self._scan()
+        while True:
+            if self.backoff:
+                time.sleep(self.backoff)  # New arrivals don't cut it short
+            else:
+                self._wake.wait(timeout=1.0)
+            self._wake.clear()
+
+            names = sorted(self._spooled())
+            try:
+                for name in names[:MOVER_BATCH]:
+                    self._move(name)
+                    self.moved += 1
+                if self.backoff:
+                    log.info("Mover  destination reachable again, %d spooled", self.depth())
+                self.backoff = 0.0
+                if len(names) > MOVER_BATCH:
+                    self._wake.set()
+            except OSError as e:
+                self.move_errors += 1
+                self.last_error = str(e)
+                self.backoff = min(max(self.backoff * 2, 1.0), MOVER_MAX_BACKOFF)
+                log.warning("Mover  %s — %d spooled, retry in %.0f s", e, self.depth(), self.backoff)
+
+    def _spooled(self):
+        """Names to move, including logs with lines left aside by a failed pass."""
+        names = set()
+        for name in os.listdir(self.spool_dir):
+            if name.endswith(".append"):
+                names.add(name[1:-len(".append")])
+            elif not name.startswith("."):
+                names.add(name)
+        return names
+
+    def _scan(self):
+        """Create the destination and index what is already there,
+        retrying with backoff until it is reachable."""
+        while True:
+            try:
+                os.makedirs(self.dest_dir, exist_ok=True)
+                names = [n for n in os.listdir(self.dest_dir) if not n.startswith(".")]
+                break
+            except OSError as e:
+                self.move_errors += 1
+                self.last_error = str(e)
+                self.backoff = min(max(self.backoff * 2, 1.0), MOVER_MAX_BACKOFF)
+                log.warning("Mover  %s — destination not reachable, retry in %.0f s", e, self.backoff)
+                time.sleep(self.backoff)
+        for name in names:
+            self.index.setdefault(name, None)
+        self.backoff = 0.0
+        log.info("Mover  %d files already in %s", len(names), self.dest_dir)
+
+    def _move(self, name):
+        if name.endswith(STREAM_SUFFIX):
+            self._move_log(name)
+            return
+        src = os.path.join(self.spool_dir, name)
+        part = os.path.join(self.dest_dir, f".{name}.part")
+        with open(src, "rb") as f:
+            data = f.read()
+        with open(part, "wb") as f:
+            f.write(data)
+            f.flush()
+            os.fsync(f.fileno())
+        os.replace(part, os.path.join(self.dest_dir, name))
+        self.index[name] = (len(data), zlib.crc32(data))
+        os.remove(src)
+
+    def _move_log(self, name):
+        """Append a spooled log's new lines to its destination copy. Lines
+        are taken aside first, so appends carry on in a fresh spool file;
+        on an error they stay aside and go first on the next pass."""
+        src = os.path.join(self.spool_dir, name)
+        staged = os.path.join(self.spool_dir, f".{name}.append")
+        if not os.path.exists(staged):
+            with self.lock:
+                os.replace(src, staged)
+        with open(staged, "rb") as f:
+            data = f.read()
+        with open(os.path.join(self.dest_dir, name), "ab") as f:
+            f.write(data)
+            f.flush()
+            os.fsync(f.fileno())
+        self.index.setdefault(name, None)
+        os.remove(staged)
+
+    @staticmethod
+    def _unstage(staged, path):
+        """Put lines taken aside back in front of path's."""
+        with open(staged, "rb") as f:
+            data = f.read()
+        if os.path.exists(path):
+            with open(path, "rb") as f:
+                data += f.read()
+        write_atomic(path, data)
+        os.remove(staged)
+
+
+def device_key(device_id, name):
+    """What per-device state and file names are keyed on: the unit's id,
+    or the shared DEVICE_NAME from firmware that doesn't send one."""
+    return os.path.basename(device_id or name or "") or "unknown"
+
+
+def label(value):
+    return value.replace("\\", "\\\\").replace('"', '\\"').replace("\n", "\\n")
+
+
+class Histogram:
+    def __init__(self):
+        self.counts = [0] * len(LATENCY_BUCKETS)
+        self.total = 0
+        self.sum = 0.0
+
+    def observe(self, seconds):
+        for i, bound in enumerate(LATENCY_BUCKETS):
+            if seconds <= bound:
+                self.counts[i] += 1   # Buckets are cumulative, as exported
+        self.total += 1
+        self.sum += seconds
+
+
+class DeviceStats:
+    def __init__(self):
+        self.dumps = 0
+        self.bytes = 0
+        self.duplicates = 0
+        self.summaries = 0
+        self.rejected = {}          # reason -> count
+        self.last_seen = 0.0
+        self.last_id = 0            # Highest dump id seen
+        self.missing = set()        # Ids below last_id not received yet
+        self.gaps = 0               # Times last_id jumped by more than one
+        self.id_resets = 0
+        self.request = {}           # kind -> Histogram, whole request
+        self.write = Histogram()    # Disk write inside the request
+
+
+class Metrics:
+    """Per-device ingest counters behind GET /metrics.
+
+    Dump ids come from a counter the device keeps in NVS, one sequence
+    across its channels. A jump in X-Dump-Id leaves the skipped ids as
+    missing until they arrive: dumps that went to the device's retry
+    queue fill in later, so a missing count that stays up — or a
+    last-seen time that stops moving — is a device that is dropping or
+    holding dumps. An id of 1 below the current sequence is a device
+    whose NVS was erased and starts the sequence over.
+    """
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.devices = {}
+        self.started = time.time()
+
+    def _device(self, name):
+        dev = self.devices.get(name)
+        if dev is None:
+            dev = self.devices[name] = DeviceStats()
+        return dev
+
+    def request(self, device, kind, seconds):
+        with self.lock:
+            dev = self._device(device)
+            dev.last_seen = time.time()
+            dev.request.setdefault(kind, Histogram()).observe(seconds)
+
+    def write(self, device, seconds):
+        with self.lock:
+            self._device(device).write.observe(seconds)
+
+    def saved(self, device, dump_id, size):
+        with self.lock:
+            dev = self._device(device)
+            dev.dumps += 1
+            dev.bytes += size
+            self._sequence(dev, dump_id)
+
+    def duplicate(self, device, dump_id):
+        with self.lock:
+            dev = self._device(device)
+            dev.duplicates += 1
+            self._sequence(dev, dump_id)
+
+    def summary(self, device):
+        with self.lock:
+            self._device(device).summaries += 1
+
+    def rejected(self, device, reason):
+        with self.lock:
+            dev = self._device(device)
+            dev.rejected[reason] = dev.rejected.get(reason, 0) + 1
+
+    @staticmethod
+    def _sequence(dev, dump_id):
+        try:
+            n = int(dump_id)
+        except ValueError:
+            return
+        if n <= 0:
+            return
+        if n == 1 and dev.last_id > 1 and 1 not in dev.missing:
+            dev.id_resets += 1
+            dev.last_id = 0
+            dev.missing.clear()
+        if dev.last_id and n > dev.last_id + 1:
+            dev.gaps += 1
+            for skipped in range(max(dev.last_id + 1, n - MISSING_MAX), n):
+                dev.missing.add(skipped)
+            while len(dev.missing) > MISSING_MAX:
+                dev.missing.remove(min(dev.missing))
+        if n > dev.last_id:
+            dev.last_id = n
+        else:
+            dev.missing.discard(n)
+
+    def render(self):
+        out = []
+
+        def family(name, kind, help_text):
+            out.append(f"# HELP {name} {help_text}")
+            out.append(f"# TYPE {name} {kind}")
+
+        def hist(name, labels, h):
+            for bound, count in zip(LATENCY_BUCKETS, h.counts):
+                out.append(f'{name}_bucket{{{labels},le="{bound}"}} {count}')
+            out.append(f'{name}_bucket{{{labels},le="+Inf"}} {h.total}')
+            out.append(f"{name}_sum{{{labels}}} {h.sum:.6f}")
+            out.append(f"{name}_count{{{labels}}} {h.total}")
+
+        with self.lock:
+            devices = [(label(name), dev) for name, dev in sorted(self.devices.items())]
+
+            family("brakemachine_receiver_start_time_seconds", "gauge", "Receiver start, Unix time")
+            out.append(f"brakemachine_receiver_start_time_seconds {self.started:.0f}")
+
+            counters = (
+                ("dumps_total", "counter", "Dumps stored", lambda d: d.dumps),
+                ("bytes_total", "counter", "Dump bytes stored (after delta rebuild)", lambda d: d.bytes),
+                ("duplicates_total", "counter", "Retried dumps skipped as identical", lambda d: d.duplicates),
+                ("summaries_total", "counter", "Dump summaries stored", lambda d: d.summaries),
+                ("last_seen_seconds", "gauge", "Last request, Unix time", lambda d: f"{d.last_seen:.0f}"),
+                ("dump_id_last", "gauge", "Highest X-Dump-Id received", lambda d: d.last_id),
+                ("dumps_missing", "gauge", "Dump ids below the highest not received yet",
+                 lambda d: len(d.missing)),
+                ("dump_id_gaps_total", "counter", "Times X-Dump-Id skipped ahead", lambda d: d.gaps),
+                ("dump_id_resets_total", "counter", "Times X-Dump-Id restarted at 1",
+                 lambda d: d.id_resets),
+            )
+            for suffix, kind, help_text, value in counters:
+                name = f"brakemachine_{suffix}"
+                family(name, kind, help_text)
+                for device, dev in devices:
+                    out.append(f'{name}{{device="{device}"}} {value(dev)}')
+
+            family("brakemachine_rejected_total", "counter", "Requests refused, by reason")
+            for device, dev in devices:
+                for reason, count in sorted(dev.rejected.items()):
+                    out.append(f'brakemachine_rejected_total{{device="{device}",reason="{reason}"}} {count}')
+
+            family("brakemachine_request_seconds", "histogram",
+                   "POST /upload from body read to response, by kind")
+            for device, dev in devices:
+                for kind, h in sorted(dev.request.items()):
+                    hist("brakemachine_request_seconds", f'device="{device}",kind="{kind}"', h)
+
+            family("brakemachine_write_seconds", "histogram", "Disk write (temp file, fsync, rename)")
+            for device, dev in devices:
+                hist("brakemachine_write_seconds", f'device="{device}"', dev.write)
+
+        return "\n".join(out) + "\n"
+
+
+def crc_matches(body, crc_hdr):
+    """Check body against an X-Content-CRC32 header (8 hex digits)."""
+    try:
+        return zlib.crc32(body) & 0xFFFFFFFF == int(crc_hdr, 16)
+    except ValueError:
+        return False
+
+
+def apply_delta(base, delta):
+    """Rebuild a dump from a line delta against a base dump.
+
+    Delta format (see DeltaEncoder on the device):
+        #delta base=<id> lines=<n>
+        =<start>,<count>    copy lines from the base
+        +<text>             literal line
+    Lines are split on LF only, so CRs survive unchanged.
+    """
+    ops = delta.split(b"\n")
+    header = ops[0].split()
+    if not header or header[0] != b"#delta":
+        raise ValueError("not a delta")
+    fields = dict(f.split(b"=", 1) for f in header[1:] if b"=" in f)
+    expected = int(fields.get(b"lines", b"-1"))
+
+    base_lines = base.split(b"\n")
+    out = []
+    for op in ops[1:]:
+        if op.startswith(b"="):
+            start, count = (int(x) for x in op[1:].split(b","))
+            if start < 0 or count < 1 or start + count > len(base_lines):
+                raise ValueError("copy out of range")
+            out.extend(base_lines[start:start + count])
+        elif op.startswith(b"+"):
+            out.append(op[1:])
+        elif op:
+            raise ValueError("bad op")
+
+    if len(out) != expected:
+        raise ValueError("line count mismatch")
+    return b"\n".join(out)
 
 
 class UploadHandler(BaseHTTPRequestHandler):
-    save_dir: str = "./dumps"
+    # Keep-alive: devices hold one connection open across uploads. Every
+    # response must then carry a Content-Length (send_text, send_error).
+    protocol_version = "HTTP/1.1"
+    timeout = 30  # Drop idle connections; the device closes first at 20 s
+    # The body follows the headers in a second write; with Nagle on it
+    # waits for the device's delayed ACK on a kept-alive connection
+    disable_nagle_algorithm = True
+
+    store: Store = None
+    metrics: Metrics = None
+    saved: dict = {}  # (device, dump id) -> file name, for delta bases
+
+    def send_text(self, body):
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    @classmethod
+    def write_file(cls, device, name, data):
+        start = time.monotonic()
+        cls.store.write(name, data)
+        cls.metrics.write(device, time.monotonic() - start)
+
+    def reject(self, device, code, reason, message):
+        self.metrics.rejected(device, reason)
+        self.send_error(code, message)
+
+    def find_dump(self, device, dump_id):
+        name = self.saved.get((device, dump_id))
+        path = name and self.store.find(name)
+        if path:
+            return path
+        # Dump ids are unique per device across channels, so the base may
+        # be any channel's file: <ts>_<device>[_ch<n>]_<id>.tsv
+        pattern = re.compile(rf"_{re.escape(device)}(_ch\d+)?_{re.escape(dump_id)}\.tsv$")
+        for name in self.store.list():
+            if pattern.search(name):
+                return self.store.find(name)
+        return None
+
+    @staticmethod
+    def base_name(device, ts_hdr, dump_id, channel):
+        try:
+            ts = datetime.datetime.fromisoformat(ts_hdr)
+        except (ValueError, TypeError):
+            ts = datetime.datetime.now()
+
+        # Channel 1 keeps the original name so single-port devices are unchanged
+        tag = device if channel == "1" else f"{device}_ch{channel}"
+        return f"{ts.strftime('%Y%m%d_%H%M%S')}_{tag}_{dump_id}"
+
+    def save_summary(self, body, device, ts_hdr, dump_id, channel):
+        try:
+            summary = json.loads(body)
+        except ValueError:
+            self.reject(device, 400, "bad_summary", "Bad summary")
+            return
+
+        filename = f"{self.base_name(device, ts_hdr, dump_id, channel)}.summary.json"
+        with self.store.lock:
+            self.write_file(device, filename, body)
+        self.metrics.summary(device)
+
+        net = summary.get("net") or {}
+        log.info("Summary %-44s  (%d records, net %s %s)  from %s", filename,
+                 summary.get("records", 0), net.get("total", "-"), summary.get("unit", ""),
+                 self.client_address[0])
+
+        self.send_text(b"OK")
 
     def do_POST(self):
         if self.path != "/upload":
             self.send_error(404, "Not found")
             return
 
+        start = time.monotonic()
+        device = device_key(self.headers.get("X-Device-Id"), self.headers.get("X-Device-Name"))
         content_length = int(self.headers.get("Content-Length", 0))
         if content_length == 0:
-            self.send_error(400, "Empty body")
+            self.reject(device, 400, "empty", "Empty body")
             return
         if content_length > MAX_BODY:
-            self.send_error(413, "Payload too large")
+            self.reject(device, 413, "too_large", "Payload too large")
             return
 
         body = self.rfile.read(content_length)
+        kind = self.save_upload(body, device, content_length)
+        self.metrics.request(device, kind, time.monotonic() - start)
 
-        device = self.headers.get("X-Device-Name", "unknown")
+    def save_upload(self, body, device, content_length):
+        """Store one POST /upload; returns its kind for the latency metrics."""
         ts_hdr = self.headers.get("X-Timestamp", "")
         dump_id = self.headers.get("X-Dump-Id", "0")
+        # Capture channel (second indicator / 920i Port 2); absent = 1
+        channel = self.headers.get("X-Channel", "1")
+        if not channel.isdigit():
+            channel = "1"
 
-        try:
-            ts = datetime.datetime.fromisoformat(ts_hdr)
-        except (ValueError, TypeError):
-            ts = datetime.datetime.now()
+        # Summary sent ahead of the dump: record count and weight totals.
+        # Stored next to where the dump will land; X-Content-CRC32 here is
+        # the dump's CRC, not the summary's, so it isn't checked.
+        if self.headers.get("Content-Type", "").startswith("application/x-brakemachine-summary"):
+            self.save_summary(body, device, ts_hdr, dump_id, channel)
+            return "summary"
 
-        base = f"{ts.strftime('%Y%m%d_%H%M%S')}_{device}_{dump_id}"
-        os.makedirs(self.save_dir, exist_ok=True)
-
-        # Avoid overwriting if same dump is retried
-        filepath = os.path.join(self.save_dir, f"{base}.tsv")
-        if os.path.exists(filepath):
-            # Check if content is identical — skip duplicate
-            with open(filepath, "rb") as existing:
-                if existing.read() == body:
-                    log.info("Skip   %-45s  (duplicate)", f"{base}.tsv")
-                    self.send_response(200)
-                    self.send_header("Content-Type", "text/plain")
-                    self.end_headers()
-                    self.wfile.write(b"OK")
-                    return
+        # Incremental upload: body holds only new lines relative to a dump
+        # we already stored. 409 tells the device to send it in full.
+        base_id = self.headers.get("X-Delta-Base")
+        if base_id:
+            base_path = self.find_dump(device, base_id)
+            if not base_path:
+                log.warning("Delta #%s from %s: base #%s not found", dump_id, device, base_id)
+                self.reject(device, 409, "delta_base", "Delta base not found")
+                return "delta"
+            try:
+                with open(base_path, "rb") as f:
+                    body = apply_delta(f.read(), body)
+            except ValueError as e:
+                log.warning("Delta #%s from %s: %s", dump_id, device, e)
+                self.reject(device, 409, "bad_delta", "Bad delta")
+                return "delta"
 
-            # Different content with same name — add suffix
-            n = 2
-            while os.path.exists(filepath):
-                filepath = os.path.join(self.save_dir, f"{base}_{n}.tsv")
-                n += 1
+        # CRC-32 computed on the device as bytes arrived from the scale.
+        # Reject on mismatch so the device keeps the dump and retries.
+        crc_hdr = self.headers.get("X-Content-CRC32")
+        if crc_hdr and not crc_matches(body, crc_hdr):
+            log.warning("CRC mismatch from %s: header %s, body %08x (%d bytes)",
+                        self.client_address[0], crc_hdr, zlib.crc32(body) & 0xFFFFFFFF, len(body))
+            # A bad rebuild means the base differs — ask for the full dump
+            self.reject(device, 409 if base_id else 400, "crc", "CRC mismatch")
+            return "delta" if base_id else "dump"
 
-        with open(filepath, "wb") as f:
-            f.write(body)
-        filename = os.path.basename(filepath)
+        filename = self.store_dump(body, device, ts_hdr, dump_id, channel)
+        if not filename:
+            self.send_text(b"OK")
+            return "delta" if base_id else "dump"
 
         size_kb = len(body) / 1024
-        log.info("Saved  %-45s  (%.1f KB)  from %s", filename, size_kb, self.client_address[0])
+        if base_id:
+            log.info("Saved  %-45s  (%.1f KB, delta %.1f KB on #%s)  from %s", filename, size_kb,
+                     content_length / 1024, base_id, self.client_address[0])
+        else:
+            log.info("Saved  %-45s  (%.1f KB)  from %s", filename, size_kb, self.client_address[0])
 
-        self.send_response(200)
-        self.send_header("Content-Type", "text/plain")
-        self.end_headers()
-        self.wfile.write(b"OK")
+        self.send_text(b"OK")
+        return "delta" if base_id else "dump"
+
+    @classmethod
+    def store_dump(cls, body, device, ts_hdr, dump_id, channel):
+        """Write a verified dump; returns its file name, or None if the
+        same bytes are already stored under it (a resend)."""
+        base = cls.base_name(device, ts_hdr, dump_id, channel)
+
+        with cls.store.lock:
+            # Avoid overwriting if same dump is retried
+            filename = f"{base}.tsv"
+            if cls.store.find(filename):
+                # Check if content is identical — skip duplicate
+                if cls.store.holds(filename, body):
+                    log.info("Skip   %-45s  (duplicate)", filename)
+                    cls.metrics.duplicate(device, dump_id)
+                    return None
+
+                # Different content with same name — add suffix
+                n = 2
+                while cls.store.find(filename):
+                    filename = f"{base}_{n}.tsv"
+                    n += 1
+
+            cls.write_file(device, filename, body)
+        cls.saved[(device, dump_id)] = filename
+        cls.metrics.saved(device, dump_id, len(body))
+        return filename
 
     def do_GET(self):
         if self.path == "/":
+            text = "brakeMachine receiver is running.\n"
+            store = self.store
+            if store.spool_dir:
+                text += (f"Spool: {store.depth()} waiting, {store.moved} moved, "
+                         f"{store.move_errors} move errors")
+                if store.backoff:
+                    text += f", retrying in up to {store.backoff:.0f} s ({store.last_error})"
+                text += "\n"
+            self.send_text(text.encode())
+        elif self.path == "/metrics":
+            text = self.metrics.render()
+            store = self.store
+            if store.spool_dir:
+                text += ("# HELP brakemachine_spool_files Files waiting to move to --dir\n"
+                         "# TYPE brakemachine_spool_files gauge\n"
+                         f"brakemachine_spool_files {store.depth()}\n"
+                         "# HELP brakemachine_spool_move_errors_total Failed spool passes\n"
+                         "# TYPE brakemachine_spool_move_errors_total counter\n"
+                         f"brakemachine_spool_move_errors_total {store.move_errors}\n")
+            body = text.encode()
             self.send_response(200)
-            self.send_header("Content-Type", "text/plain")
+            self.send_header("Content-Type", "text/plain; version=0.0.4")
+            self.send_header("Content-Length", str(len(body)))
             self.end_headers()
-            self.wfile.write(b"brakeMachine receiver is running.\n")
+            self.wfile.write(body)
         else:
             self.send_error(404, "Not found")
 
@@ -99,19 +705,320 @@ class UploadHandler(BaseHTTPRequestHandler):
         pass  # Suppress default access log — we use our own
 
 
+class StreamHandler(socketserver.BaseRequestHandler):
+    """Appends live readings (stream capture mode) to a per-device daily log.
+
+    Each datagram is "<device id>\\t<seq>\\t<uptime ms>\\t<reading>", with the
+    same per-unit id as X-Device-Id. The device coalesces readings under
+    load, so gaps in seq are expected.
+    """
+    store: Store = None
+    seen: set = set()
+
+    def handle(self):
+        data = self.request[0].decode("utf-8", errors="replace")
+        parts = data.split("\t", 3)
+        if len(parts) != 4:
+            return
+        device, seq, _uptime, reading = parts
+        device = os.path.basename(device) or "unknown"
+
+        now = datetime.datetime.now()
+        name = f"{now.strftime('%Y%m%d')}_{device}{STREAM_SUFFIX}"
+        line = f"{now.isoformat(timespec='milliseconds')}\t{seq}\t{reading}\n"
+        self.store.append(name, line.encode("utf-8"))
+
+        key = (device, self.client_address[0])
+        if key not in self.seen:
+            self.seen.add(key)
+            log.info("Stream %-45s  from %s", name, self.client_address[0])
+
+
+def dns_name(data, pos):
+    """Decode a (possibly compressed) DNS name; returns (name, next pos)."""
+    labels = []
+    end = None
+    for _ in range(64):  # Bound on pointer chains
+        n = data[pos]
+        if n == 0:
+            pos += 1
+            break
+        if n & 0xC0 == 0xC0:
+            if end is None:
+                end = pos + 2
+            pos = struct.unpack_from(">H", data, pos)[0] & 0x3FFF
+            continue
+        labels.append(data[pos + 1:pos + 1 + n].decode("utf-8", "replace"))
+        pos += 1 + n
+    return ".".join(labels), (end if end is not None else pos)
+
+
+def mdns_browse(service="_http._tcp.local", timeout=2.0):
+    """Ask the LAN who offers service; returns {(address, port)}.
+
+    A one-shot query from an ephemeral port, which mDNS responders
+    (ESPmDNS included) answer by unicast with the PTR, SRV and A records.
+    """
+    query = struct.pack(">6H", 0, 0, 1, 0, 0, 0)
+    for part in service.split("."):
+        query += bytes([len(part)]) + part.encode()
+    query += b"\0" + struct.pack(">HH", 12, 1)  # PTR, IN
+
+    srv, addrs = {}, {}
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP) as sock:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+        sock.sendto(query, MDNS_GROUP)
+        deadline = time.monotonic() + timeout
+        while True:
+            left = deadline - time.monotonic()
+            if left <= 0:
+                break
+            sock.settimeout(left)
+            try:
+                data, _ = sock.recvfrom(9000)
+            except socket.timeout:
+                break
+            try:
+                _, _, qd, an, ns, ar = struct.unpack_from(">6H", data)
+                pos = 12
+                for _ in range(qd):
+                    pos = dns_name(data, pos)[1] + 4
+                for _ in range(an + ns + ar):
+                    name, pos = dns_name(data, pos)
+                    rtype, _, _, rdlen = struct.unpack_from(">HHIH", data, pos)
+                    pos += 10
+                    if rtype == 33:    # SRV: priority, weight, port, target
+                        port = struct.unpack_from(">H", data, pos + 4)[0]
+                        srv[name] = (dns_name(data, pos + 6)[0], port)
+                    elif rtype == 1:   # A
+                        addrs[name] = socket.inet_ntoa(data[pos:pos + 4])
+                    pos += rdlen
+            except (struct.error, IndexError):
+                continue  # Truncated or not DNS
+
+    found = set()
+    for target, port in srv.values():
+        addr = addrs.get(target)
+        if not addr:
+            try:
+                addr = socket.gethostbyname(target)
+            except OSError:
+                continue
+        found.add((addr, port))
+    return found
+
+
+class Puller:
+    """Pull mode: the receiver collects dumps instead of waiting for them.
+
+    Each device gets a thread that pages through its queue with
+    GET /api/dumps?after=<cursor>, fetches each dump from /api/dump?id=,
+    stores it exactly like an upload and acks the batch with
+    POST /api/dumps/ack. A dump that fails its CRC is reported as bad,
+    so the device can quarantine a corrupt flash copy. A semaphore caps
+    fetches across the whole fleet: ingest runs at the receiver's pace,
+    and an outage ends in an orderly drain instead of a burst of retries.
+
+    Devices come from a static list, from mDNS (_http._tcp, as
+    WiFiManager advertises it), or both; anything that doesn't answer
+    /api/dumps like a brakeMachine is ignored.
+    """
+
+    def __init__(self, static, discover, interval, batch, workers):
+        self.static = set(static)
+        self.discover = discover
+        self.interval = interval
+        self.batch = batch
+        self.slots = threading.Semaphore(workers)
+        self.lock = threading.Lock()
+        self.polling = set()
+        self.ignored = set()
+
+    def run(self):
+        while True:
+            targets = set(self.static)
+            if self.discover:
+                try:
+                    targets |= mdns_browse()
+                except OSError as e:
+                    log.warning("Pull   mDNS browse failed: %s", e)
+            with self.lock:
+                new = targets - self.polling - self.ignored
+                self.polling |= new
+            for addr in sorted(new):
+                threading.Thread(target=self._poll, args=(addr,), daemon=True).start()
+            time.sleep(PULL_DISCOVER_INTERVAL)
+
+    def _request(self, addr, path, data=None):
+        url = f"http://{addr[0]}:{addr[1]}{path}"
+        body = urllib.parse.urlencode(data).encode() if data is not None else None
+        with urllib.request.urlopen(url, data=body, timeout=PULL_TIMEOUT) as resp:
+            return resp.read(), resp.headers
+
+    def _list(self, addr, cursor):
+        body, _ = self._request(addr, f"/api/dumps?after={cursor}&limit={self.batch}")
+        listing = json.loads(body)
+        if not isinstance(listing, dict) or "dumps" not in listing:
+            raise ValueError("not a brakeMachine")
+        return listing
+
+    def _poll(self, addr):
+        where = f"{addr[0]}:{addr[1]}"
+        try:
+            listing = self._list(addr, 0)
+        except (OSError, ValueError):
+            # Some other _http._tcp service, or not up yet
+            with self.lock:
+                self.polling.discard(addr)
+                if addr not in self.static:
+                    self.ignored.add(addr)
+            return
+        log.info("Pull   %s at %s", device_key(listing.get("device_id"), listing.get("device")), where)
+
+        cursor = 0
+        failures = 0
+        fetch_failures = 0
+        clean_pass = True
+        while True:
+            try:
+                listing = self._list(addr, cursor)
+                failures = 0
+            except (OSError, ValueError) as e:
+                failures += 1
+                if failures >= PULL_GIVE_UP and addr not in self.static:
+                    log.warning("Pull   %s unreachable, dropping until rediscovered", where)
+                    with self.lock:
+                        self.polling.discard(addr)
+                    return
+                delay = min(self.interval * 2 ** failures, PULL_MAX_BACKOFF)
+                log.warning("Pull   %s: %s, retry in %.0f s", where, e, delay)
+                time.sleep(delay)
+                continue
+
+            device = device_key(listing.get("device_id"), listing.get("device"))
+            dumps = listing["dumps"]
+
+            # A dump that can't be fetched is skipped, not waited on; the
+            # next pass from the start of the queue retries it. Several in
+            # a row mean the device went away, and the rest of the page
+            # would only time out one by one.
+            acked, bad = [], []
+            errors = consecutive = 0
+            for d in dumps:
+                try:
+                    ok = self._fetch(addr, device, d["id"])
+                    consecutive = 0
+                except (OSError, ValueError, KeyError) as e:
+                    log.warning("Pull   %s #%s: %s", where, d.get("id"), e)
+                    errors += 1
+                    consecutive += 1
+                    if consecutive >= PULL_PAGE_ERRORS:
+                        break
+                    if isinstance(d.get("id"), int):
+                        cursor = max(cursor, d["id"])
+                    continue
+                (acked if ok else bad).append(str(d["id"]))
+                cursor = max(cursor, d["id"])
+
+            if acked or bad:
+                try:
+                    self._request(addr, "/api/dumps/ack", {"ids": ",".join(acked), "bad": ",".join(bad)})
+                except OSError as e:
+                    log.warning("Pull   %s: ack failed (%s)", where, e)
+
+            # Fetch errors back off like listing errors, until a whole
+            # pass over the queue goes through clean
+            if errors:
+                fetch_failures += 1
+                clean_pass = False
+                delay = min(self.interval * 2 ** fetch_failures, PULL_MAX_BACKOFF)
+                log.warning("Pull   %s: %d of %d fetches failed, next page in %.0f s",
+                            where, errors, len(dumps), delay)
+                time.sleep(delay)
+
+            # End of the queue: the next pass starts over, picking up
+            # anything skipped or left unacked (stored ones come back as
+            # duplicates). A full page means more is waiting.
+            if len(dumps) < self.batch:
+                cursor = 0
+                if clean_pass:
+                    fetch_failures = 0
+                clean_pass = True
+                if not errors:
+                    time.sleep(self.interval)
+
+    def _fetch(self, addr, device, dump_id):
+        """Fetch and store one dump; False if it failed its CRC."""
+        with self.slots:
+            start = time.monotonic()
+            body, headers = self._request(addr, f"/api/dump?id={dump_id}")
+            crc_hdr = headers.get("X-Content-CRC32")
+            if crc_hdr and not crc_matches(body, crc_hdr):
+                log.warning("CRC mismatch pulling #%s from %s: header %s, body %08x (%d bytes)",
+                            dump_id, addr[0], crc_hdr, zlib.crc32(body) & 0xFFFFFFFF, len(body))
+                UploadHandler.metrics.rejected(device, "crc")
+                return False
+
+            channel = headers.get("X-Channel", "1")
+            if not channel.isdigit():
+                channel = "1"
+            filename = UploadHandler.store_dump(body, device, headers.get("X-Timestamp", ""),
+                                                str(dump_id), channel)
+            UploadHandler.metrics.request(device, "pull", time.monotonic() - start)
+        if filename:
+            log.info("Pulled %-45s  (%.1f KB)  from %s", filename, len(body) / 1024, addr[0])
+        return True
+
+
 def main():
     parser = argparse.ArgumentParser(description="brakeMachine HTTP receiver")
     parser.add_argument("--port", type=int, default=5000, help="Port (default: 5000)")
     parser.add_argument("--dir", default="./dumps", help="Save directory (default: ./dumps)")
+    parser.add_argument("--spool", default=None,
+                        help="Local spool directory; dumps are moved to --dir in the background")
     parser.add_argument("--host", default="0.0.0.0", help="Bind address (default: 0.0.0.0)")
+    parser.add_argument("--stream-port", type=int, default=5001,
+                        help="UDP port for live readings, 0 to disable (default: 5001)")
+    parser.add_argument("--pull", action="store_true",
+                        help="Collect dumps from devices found by mDNS")
+    parser.add_argument("--pull-from", action="append", default=[], metavar="HOST[:PORT]",
+                        help="Collect dumps from this device (repeatable)")
+    parser.add_argument("--pull-interval", type=float, default=10.0,
+                        help="Seconds between polls of an idle device (default: 10)")
+    parser.add_argument("--pull-batch", type=int, default=16,
+                        help="Dumps fetched per poll (default: 16, the device's page size)")
+    parser.add_argument("--pull-workers", type=int, default=4,
+                        help="Dump fetches in flight across all devices (default: 4)")
     args = parser.parse_args()
 
-    UploadHandler.save_dir = args.dir
-    os.makedirs(args.dir, exist_ok=True)
+    UploadHandler.store = Store(args.dir, args.spool)
+    UploadHandler.metrics = Metrics()
+    StreamHandler.store = UploadHandler.store
+    if args.spool:
+        threading.Thread(target=UploadHandler.store.run_mover, daemon=True).start()
+
+    if args.stream_port:
+        stream = socketserver.UDPServer((args.host, args.stream_port), StreamHandler)
+        threading.Thread(target=stream.serve_forever, daemon=True).start()
+        log.info("Live readings on UDP %s:%d", args.host, args.stream_port)
+
+    if args.pull or args.pull_from:
+        static = []
+        for entry in args.pull_from:
+            host, _, port = entry.partition(":")
+            static.append((host, int(port or 80)))
+        puller = Puller(static, args.pull, args.pull_interval, args.pull_batch, args.pull_workers)
+        threading.Thread(target=puller.run, daemon=True).start()
+        log.info("Pulling from %s", ", ".join(args.pull_from + (["mDNS"] if args.pull else [])))
 
-    server = HTTPServer((args.host, args.port), UploadHandler)
+    # One thread per connection, so a device's idle keep-alive connection
+    # doesn't hold up the others
+    server = ThreadingHTTPServer((args.host, args.port), UploadHandler)
+    server.daemon_threads = True
     log.info("Listening on %s:%d", args.host, args.port)
     log.info("Saving dumps to: %s", os.path.abspath(args.dir))
+    if args.spool:
+        log.info("Spooling via:    %s", os.path.abspath(args.spool))
     log.info("Press Ctrl+C to stop")
 
     try:
@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+"""
+brakeMachine UART trace replayer — reads a trace recorded by the device
+(dashboard "UART Trace", or GET /api/trace) and plays it back.
+
+Usage:
+    python trace_replay.py trace.bin                      # what was recorded
+    python trace_replay.py trace.bin --events             # every record, with times
+    python trace_replay.py trace.bin --timeout 1000       # re-split with another capture timeout
+    python trace_replay.py trace.bin --out dumps/         # write the re-split dumps as .tsv
+    python trace_replay.py trace.bin --serial COM5        # feed a bench unit's 920i port
+    python trace_replay.py trace.bin --serial /dev/ttyUSB0 --channel 2 --speed 4
+
+--timeout re-splits the bytes into dumps the way SerialComm does (a dump
+closes once nothing has been read for that long; the device default is
+DUMP_COMPLETE_TIMEOUT_MS = 2000) and marks where the result differs from
+the dumps the device actually closed. Dumps the device split early on a
+full buffer show up as differences too.
+
+--serial sends the bytes out of a USB-RS232 adapter wired to a unit's
+capture port, with the original gaps between chunks (divided by
+--speed), so capture and parser changes meet the same traffic the field
+unit saw. Times are those at which the device read each chunk out of its
+UART driver (every line end, or after a short idle), not per byte; gaps
+inside a chunk are replayed at line rate. Needs pyserial.
+
+The parser is stdlib only.
+"""
+import argparse
+import os
+import sys
+import time
+
+HEADER, START, DATA, ERROR, DUMP = 0x0, 0x1, 0x2, 0x3, 0x4
+ERROR_NAMES = ["framing", "parity", "overflow", "break"]
+
+# Arduino SERIAL_xxx constants (UART_CONF0 layout)
+PARITY = {0: "N", 2: "E", 3: "O"}
+STOP_BITS = {1: 1, 2: 1.5, 3: 2}
+
+
+class Event:
+    __slots__ = ("t", "kind", "channel", "data", "value", "session")
+
+    def __init__(self, t, kind, channel, data=b"", value=0, session=False):
+        self.t = t              # Seconds since the start of the trace
+        self.kind = kind
+        self.channel = channel
+        self.data = data        # DATA bytes
+        self.value = value      # ERROR code, DUMP length, or START baud
+        self.session = session  # START that begins a new recording
+
+
+class Channel:
+    def __init__(self, baud=None, config=None):
+        self.baud = baud
+        self.config = config
+
+    def describe(self):
+        if self.baud is None:
+            return "unknown serial profile"
+        c = self.config
+        return f"{self.baud} {5 + ((c >> 2) & 3)}{PARITY.get(c & 3, '?')}{STOP_BITS.get((c >> 4) & 3, '?')}"
+
+
+def read_varint(buf, pos):
+    v = shift = 0
+    while True:
+        if pos >= len(buf):
+            raise ValueError("truncated varint")
+        b = buf[pos]
+        pos += 1
+        v |= (b & 0x7F) << shift
+        if b < 0x80:
+            return v, pos
+        shift += 7
+
+
+def parse(buf):
+    """Records -> (events, channels, error). A new session (the device
+    rebooted or recording was restarted) has no time link to the one before,
+    so it is placed a second after the end of it. A damaged or truncated
+    record ends the parse; error says where, and what came before is kept."""
+    events = []
+    channels = {}
+    try:
+        _parse(buf, events, channels)
+    except ValueError as e:
+        return events, channels, str(e)
+    return events, channels, None
+
+
+def _parse(buf, events, channels):
+    t_us = 0
+    pos = 0
+    while pos < len(buf):
+        tag = buf[pos]
+        pos += 1
+        kind, ch = tag >> 4, tag & 0x0F
+        if tag == HEADER:
+            if buf[pos:pos + 4] != b"BMT1":
+                raise ValueError(f"bad file header at offset {pos - 1}")
+            pos += 4
+            continue
+
+        dt, pos = read_varint(buf, pos)
+        t_us += dt
+        if kind == START:
+            if pos + 13 > len(buf):
+                raise ValueError("truncated START record")
+            baud = int.from_bytes(buf[pos:pos + 4], "little")
+            config = int.from_bytes(buf[pos + 4:pos + 8], "little")
+            session = buf[pos + 12] == 1
+            pos += 13
+            if session and events:
+                t_us = int(events[-1].t * 1e6) + 1000000
+            channels[ch] = Channel(baud, config)
+            events.append(Event(t_us / 1e6, START, ch, value=baud, session=session))
+        elif kind == DATA:
+            n, pos = read_varint(buf, pos)
+            if pos + n > len(buf):
+                raise ValueError("truncated DATA record")
+            events.append(Event(t_us / 1e6, DATA, ch, data=bytes(buf[pos:pos + n])))
+            pos += n
+        elif kind == ERROR:
+            if pos >= len(buf):
+                raise ValueError("truncated ERROR record")
+            events.append(Event(t_us / 1e6, ERROR, ch, value=buf[pos]))
+            pos += 1
+        elif kind == DUMP:
+            n, pos = read_varint(buf, pos)
+            events.append(Event(t_us / 1e6, DUMP, ch, value=n))
+        else:
+            raise ValueError(f"unknown record type {kind} at offset {pos - 1}")
+        channels.setdefault(ch, Channel())
+
+
+def split_dumps(events, channel, timeout_s):
+    """Group a channel's bytes into dumps as SerialComm does: a dump closes
+    once no bytes have been read for timeout_s. Returns (start, end, bytes)."""
+    dumps = []
+    cur = None
+    for e in events:
+        if e.channel != channel:
+            continue
+        if e.kind == START and e.session and cur:
+            dumps.append(cur)
+            cur = None
+        if e.kind != DATA:
+            continue
+        if cur and e.t - cur[1] >= timeout_s:
+            dumps.append(cur)
+            cur = None
+        if cur is None:
+            cur = [e.t, e.t, bytearray()]
+        cur[1] = e.t
+        cur[2] += e.data
+    if cur:
+        dumps.append(cur)
+    return [(s, t, bytes(d)) for s, t, d in dumps]
+
+
+def recorded_dumps(events, channel):
+    return [(e.t, e.value) for e in events if e.kind == DUMP and e.channel == channel]
+
+
+def show_events(events):
+    for e in events:
+        if e.kind == START:
+            print(f"{e.t:12.6f} ch{e.channel} START {e.value} baud"
+                  + (" (new session)" if e.session else ""))
+        elif e.kind == DATA:
+            text = e.data.decode("latin-1").replace("\r", "\\r").replace("\n", "\\n").replace("\t", "\\t")
+            print(f"{e.t:12.6f} ch{e.channel} DATA  {len(e.data):4d}  {text[:80]}")
+        elif e.kind == ERROR:
+            name = ERROR_NAMES[e.value] if e.value < len(ERROR_NAMES) else str(e.value)
+            print(f"{e.t:12.6f} ch{e.channel} ERROR {name}")
+        elif e.kind == DUMP:
+            print(f"{e.t:12.6f} ch{e.channel} DUMP  {e.value} bytes")
+
+
+def summarize(events, channels, timeout_s):
+    span = events[-1].t - events[0].t if events else 0
+    print(f"{len(events)} records over {span:.1f} s")
+    for ch in sorted(channels):
+        data = [e for e in events if e.channel == ch and e.kind == DATA]
+        errors = [e for e in events if e.channel == ch and e.kind == ERROR]
+        print(f"\nChannel {ch}: {channels[ch].describe()}, {sum(len(e.data) for e in data)} bytes "
+              f"in {len(data)} reads, {len(errors)} UART errors")
+
+        recorded = recorded_dumps(events, ch)
+        replayed = split_dumps(events, ch, timeout_s)
+        print(f"  Device closed {len(recorded)} dumps; a {timeout_s * 1000:.0f} ms timeout gives {len(replayed)}")
+        print(f"  {'start s':>10} {'end s':>10} {'bytes':>8} {'lines':>6}  device")
+        rec = list(recorded)
+        for start, end, body in replayed:
+            # Device dumps that closed inside this one (or at its end)
+            inside = [r for r in rec if start <= r[0] <= end + timeout_s + 1]
+            rec = [r for r in rec if r not in inside]
+            lengths = [n for _, n in inside]
+            mark = ""
+            if len(inside) > 1:
+                mark = f"split into {len(inside)}: " + ", ".join(str(n) for n in lengths)
+            elif len(inside) == 1 and lengths[0] > len(body):
+                mark = f"{lengths[0]} bytes (joined to the dump before)"
+            elif len(inside) == 1 and lengths[0] < len(body):
+                mark = f"{lengths[0]} bytes (filtered or truncated)"
+            elif not inside:
+                mark = "not closed"
+            else:
+                mark = "same"
+            lines = body.count(b"\n")
+            print(f"  {start:10.3f} {end:10.3f} {len(body):8d} {lines:6d}  {mark}")
+        for t, n in rec:
+            print(f"  {'':>10} {t:10.3f} {n:8d} {'':>6}  device dump with no bytes here")
+
+
+def write_dumps(events, channel, timeout_s, out_dir):
+    os.makedirs(out_dir, exist_ok=True)
+    dumps = split_dumps(events, channel, timeout_s)
+    for i, (start, _, body) in enumerate(dumps, 1):
+        path = os.path.join(out_dir, f"ch{channel}_{i:04d}_{start:.3f}s.tsv")
+        with open(path, "wb") as f:
+            f.write(body)
+    print(f"Wrote {len(dumps)} dumps to {out_dir}")
+
+
+def replay_serial(events, channels, args):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("--serial needs pyserial (pip install pyserial)")
+
+    profile = channels.get(args.channel, Channel())
+    baud = args.baud or profile.baud or 9600
+    config = profile.config if profile.config is not None else 0x800001C  # SERIAL_8N1
+    port = serial.Serial(
+        args.serial, baudrate=baud,
+        bytesize={5: serial.FIVEBITS, 6: serial.SIXBITS, 7: serial.SEVENBITS, 8: serial.EIGHTBITS}[5 + ((config >> 2) & 3)],
+        parity={"N": serial.PARITY_NONE, "E": serial.PARITY_EVEN, "O": serial.PARITY_ODD}[PARITY.get(config & 3, "N")],
+        stopbits={1: serial.STOPBITS_ONE, 1.5: serial.STOPBITS_ONE_POINT_FIVE, 2: serial.STOPBITS_TWO}[STOP_BITS.get((config >> 4) & 3, 1)],
+    )
+
+    data = [e for e in events if e.channel == args.channel and e.kind == DATA]
+    if not data:
+        sys.exit(f"No bytes recorded on channel {args.channel}")
+    print(f"Replaying {sum(len(e.data) for e in data)} bytes of channel {args.channel} "
+          f"to {args.serial} at {baud} baud, {args.speed}x")
+
+    # A chunk's time is when its last byte was read; start sending it
+    # early enough to finish then
+    byte_s = 10.0 / baud
+    t0 = time.monotonic() - (data[0].t - len(data[0].data) * byte_s) / args.speed
+    sent = 0
+    for e in data:
+        due = t0 + (e.t - len(e.data) * byte_s) / args.speed
+        wait = due - time.monotonic()
+        if wait > 0:
+            time.sleep(wait)
+        port.write(e.data)
+        sent += len(e.data)
+    port.flush()
+    port.close()
+    print(f"Sent {sent} bytes in {time.monotonic() - t0:.1f} s")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="brakeMachine UART trace replayer")
+    parser.add_argument("trace", help="Trace file from /api/trace")
+    parser.add_argument("--events", action="store_true", help="List every record")
+    parser.add_argument("--channel", type=int, default=1, help="Channel for --out/--serial (default: 1)")
+    parser.add_argument("--timeout", type=float, default=2000,
+                        help="Capture timeout ms for re-splitting (default: 2000)")
+    parser.add_argument("--out", help="Write the re-split dumps of --channel to this directory")
+    parser.add_argument("--serial", help="Replay --channel out of this serial port")
+    parser.add_argument("--baud", type=int, help="Override the recorded baud rate")
+    parser.add_argument("--speed", type=float, default=1.0, help="Replay speed factor (default: 1)")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as f:
+        buf = f.read()
+    events, channels, error = parse(buf)
+    if error:
+        # The device may have reset mid-write; use what came before
+        print(f"WARNING: {error}, {len(events)} records read", file=sys.stderr)
+    if not events:
+        return 1
+
+    timeout_s = args.timeout / 1000.0
+    if args.events:
+        show_events(events)
+    elif args.serial:
+        replay_serial(events, channels, args)
+    elif args.out:
+        write_dumps(events, args.channel, timeout_s, args.out)
+    else:
+        summarize(events, channels, timeout_s)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,224 @@
+#include "command_scheduler.h"
+#include "config.h"
+#include "logger.h"
+#include "persistent_state.h"
+
+CommandScheduler::CommandScheduler(SerialComm& serial)
+    : _serial(serial)
+    , _nextId(1)
+    , _timeouts(0)
+    , _lastSend(0)
+    , _holdUntil(0) {
+}
+
+void CommandScheduler::begin() {
+    _serial.onReply([this](const String& reply) { _onReply(reply); });
+
+    String spec = State.getString("commands", "sched");
+
+    if (!_parseSchedules(spec, _schedules)) {
+        Log.warn(LogModule::COMMANDS, "Stored schedule invalid, ignoring");
+        _schedules.clear();
+    }
+    Log.info(LogModule::COMMANDS, "Ready. %u schedule(s)", _schedules.size());
+}
+
+void CommandScheduler::update() {
+    unsigned long now = millis();
+
+    // The 920i answers in order, so if the oldest command timed out every
+    // later reply is suspect too — fail them all and resynchronise.
+    if (!_inFlight.empty() && now - _inFlight.front().sentAt >= COMMAND_REPLY_TIMEOUT_MS) {
+        Log.warn(LogModule::COMMANDS, "Timeout waiting for '%s' (%u in flight)",
+                 _inFlight.front().command.c_str(), _inFlight.size());
+        while (!_inFlight.empty()) {
+            _finish(_inFlight.front(), CommandStatus::TIMEOUT);
+            _inFlight.pop_front();
+            _timeouts++;
+        }
+        _serial.cancelReplies();
+        _holdUntil = now + COMMAND_QUIET_MS;
+    }
+
+    _runSchedules();
+
+    while (!_queue.empty() && _canSend()) {
+        _sendNext();
+    }
+}
+
+uint32_t CommandScheduler::submit(const String& command, bool expectReply) {
+    if (command.length() == 0 || _queue.size() >= COMMAND_MAX_QUEUED) return 0;
+
+    CommandResult cmd;
+    cmd.id = _nextId++;
+    cmd.command = command;
+    cmd.expectReply = expectReply;
+    cmd.queuedAt = millis();
+    _queue.push_back(cmd);
+    return cmd.id;
+}
+
+bool CommandScheduler::setSchedules(const String& spec) {
+    std::vector<CommandSchedule> parsed;
+    if (!_parseSchedules(spec, parsed)) return false;
+
+    _schedules = parsed;
+    State.setString("commands", "sched", getScheduleSpec());
+    State.commit();
+
+    // Indices changed — queued scheduled commands no longer map to them
+    for (auto& cmd : _queue) cmd.schedule = -1;
+    for (auto& cmd : _inFlight) cmd.schedule = -1;
+
+    Log.info(LogModule::COMMANDS, "Schedules set: %s", getScheduleSpec().c_str());
+    return true;
+}
+
+String CommandScheduler::getScheduleSpec() const {
+    String spec;
+    for (size_t i = 0; i < _schedules.size(); i++) {
+        if (i > 0) spec += ';';
+        spec += _schedules[i].command + "@" + String(_schedules[i].intervalMs);
+    }
+    return spec;
+}
+
+const std::vector<CommandSchedule>& CommandScheduler::getSchedules() const {
+    return _schedules;
+}
+
+const std::deque<CommandResult>& CommandScheduler::getHistory() const {
+    return _history;
+}
+
+size_t CommandScheduler::getQueuedCount() const {
+    return _queue.size();
+}
+
+size_t CommandScheduler::getInFlightCount() const {
+    return _inFlight.size();
+}
+
+uint32_t CommandScheduler::getTimeoutCount() const {
+    return _timeouts;
+}
+
+void CommandScheduler::_onReply(const String& reply) {
+    if (_inFlight.empty()) {
+        Log.warn(LogModule::COMMANDS, "Unmatched reply: %s", reply.c_str());
+        return;
+    }
+    CommandResult& cmd = _inFlight.front();
+    cmd.reply = reply;
+    _finish(cmd, CommandStatus::DONE);
+    _inFlight.pop_front();
+}
+
+void CommandScheduler::_runSchedules() {
+    unsigned long now = millis();
+    for (size_t i = 0; i < _schedules.size(); i++) {
+        CommandSchedule& s = _schedules[i];
+        if (s.lastRun != 0 && now - s.lastRun < s.intervalMs) continue;
+
+        // Don't pile up copies if the line has been busy for a while
+        bool pending = false;
+        for (const auto& cmd : _queue) {
+            if (cmd.schedule == (int8_t)i) pending = true;
+        }
+        for (const auto& cmd : _inFlight) {
+            if (cmd.schedule == (int8_t)i) pending = true;
+        }
+        if (pending || _queue.size() >= COMMAND_MAX_QUEUED) continue;
+
+        s.lastRun = now;
+        CommandResult cmd;
+        cmd.id = _nextId++;
+        cmd.command = s.command;
+        cmd.schedule = i;
+        cmd.queuedAt = now;
+        _queue.push_back(cmd);
+    }
+}
+
+bool CommandScheduler::_canSend() const {
+    unsigned long now = millis();
+
+    if (_serial.getState() == CaptureState::RECEIVING) return false;
+    if ((long)(now - _holdUntil) < 0) return false;
+    if (_inFlight.size() >= COMMAND_MAX_INFLIGHT) return false;
+    if (_lastSend != 0 && now - _lastSend < COMMAND_MIN_GAP_MS) return false;
+
+    // Unsolicited traffic in dump mode is probably the start of a print —
+    // wait for the line to go quiet before opening a new burst.
+    if (_inFlight.empty() && _serial.getMode() == CaptureMode::DUMP
+        && _serial.getIdleTime() < COMMAND_QUIET_MS) {
+        return false;
+    }
+    return true;
+}
+
+void CommandScheduler::_sendNext() {
+    CommandResult cmd = _queue.front();
+    _queue.pop_front();
+
+    if (cmd.expectReply) {
+        _serial.expectReply();
+    }
+    _serial.sendCommand(cmd.command);
+    cmd.sentAt = millis();
+    _lastSend = cmd.sentAt;
+
+    if (cmd.expectReply) {
+        cmd.status = CommandStatus::SENT;
+        _inFlight.push_back(cmd);
+    } else {
+        // e.g. a print trigger — its output is a dump, not a reply.
+        // Give the dump time to start before anything else goes out.
+        _finish(cmd, CommandStatus::DONE);
+        _holdUntil = cmd.sentAt + DUMP_COMPLETE_TIMEOUT_MS;
+    }
+}
+
+void CommandScheduler::_finish(CommandResult& cmd, CommandStatus status) {
+    cmd.status = status;
+    cmd.doneAt = millis();
+
+    if (status == CommandStatus::DONE && cmd.schedule >= 0
+        && cmd.schedule < (int8_t)_schedules.size()) {
+        CommandSchedule& s = _schedules[cmd.schedule];
+        s.lastReply = cmd.reply;
+        s.lastReplyAt = cmd.doneAt;
+    }
+
+    _history.push_back(cmd);
+    while (_history.size() > COMMAND_HISTORY) {
+        _history.pop_front();
+    }
+}
+
+bool CommandScheduler::_parseSchedules(const String& spec, std::vector<CommandSchedule>& out) const {
+    out.clear();
+    int pos = 0;
+    while (pos < (int)spec.length()) {
+        int end = spec.indexOf(';', pos);
+        if (end < 0) end = spec.length();
+        String item = spec.substring(pos, end);
+        pos = end + 1;
+
+        item.trim();
+        if (item.length() == 0) continue;
+
+        int at = item.lastIndexOf('@');
+        if (at <= 0) return false;
+
+        CommandSchedule s;
+        s.command = item.substring(0, at);
+        s.command.trim();
+        s.intervalMs = item.substring(at + 1).toInt();
+        if (s.command.length() == 0 || s.intervalMs < COMMAND_MIN_INTERVAL_MS) return false;
+        if (out.size() >= COMMAND_MAX_SCHEDULES) return false;
+        out.push_back(s);
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef COMMAND_SCHEDULER_H
+#define COMMAND_SCHEDULER_H
+
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+#include "serial_comm.h"
+
+enum class CommandStatus {
+    QUEUED,   // Waiting for a send slot
+    SENT,     // On the wire, waiting for the reply
+    DONE,     // Reply received (or command needs none)
+    TIMEOUT   // No reply within COMMAND_REPLY_TIMEOUT_MS
+};
+
+struct CommandResult {
+    uint32_t id = 0;
+    String command;
+    bool expectReply = true;
+    int8_t schedule = -1;          // Index into schedules, -1 = one-off
+    CommandStatus status = CommandStatus::QUEUED;
+    String reply;
+    unsigned long queuedAt = 0;
+    unsigned long sentAt = 0;
+    unsigned long doneAt = 0;
+};
+
+struct CommandSchedule {
+    String command;
+    unsigned long intervalMs = 0;
+    unsigned long lastRun = 0;
+    String lastReply;
+    unsigned long lastReplyAt = 0;
+};
+
+// Sends 920i serial commands on schedules or on request and matches the
+// replies back to them.
+//
+// The 920i answers commands strictly in order, so replies are matched
+// FIFO against the in-flight list; up to COMMAND_MAX_INFLIGHT commands are
+// pipelined. Nothing is sent while a print dump is arriving, and a command
+// that triggers a print (no reply expected) holds off further sends until
+// that dump has had time to start.
+class CommandScheduler {
+public:
+    explicit CommandScheduler(SerialComm& serial);
+
+    // Load schedules from NVS and hook SerialComm's reply callback
+    void begin();
+
+    // Call from loop() — runs schedules, sends, expires timeouts
+    void update();
+
+    // Queue a one-off command. Returns its id, or 0 if the queue is full.
+    uint32_t submit(const String& command, bool expectReply = true);
+
+    // Replace all schedules. Format: "CMD@ms;CMD@ms" (persisted to NVS)
+    bool setSchedules(const String& spec);
+    String getScheduleSpec() const;
+
+    const std::vector<CommandSchedule>& getSchedules() const;
+    const std::deque<CommandResult>& getHistory() const;
+    size_t getQueuedCount() const;
+    size_t getInFlightCount() const;
+    uint32_t getTimeoutCount() const;
+
+private:
+    SerialComm& _serial;
+    std::vector<CommandSchedule> _schedules;
+    std::deque<CommandResult> _queue;
+    std::deque<CommandResult> _inFlight;
+    std::deque<CommandResult> _history;
+    uint32_t _nextId;
+    uint32_t _timeouts;
+    unsigned long _lastSend;
+    unsigned long _holdUntil;
+
+    void _onReply(const String& reply);
+    void _runSchedules();
+    bool _canSend() const;
+    void _sendNext();
+    void _finish(CommandResult& cmd, CommandStatus status);
+    bool _parseSchedules(const String& spec, std::vector<CommandSchedule>& out) const;
+};
+
+#endif // COMMAND_SCHEDULER_H
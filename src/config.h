@@ -15,25 +15,140 @@
 #ifndef STATUS_LED_PIN
 #define STATUS_LED_PIN 8
 #endif
+// Optional RTS/CTS handshake lines (the MAX3232's second driver/receiver
+// pair), for hardware flow control. -1 = not wired.
+#ifndef RS232_RTS_PIN
+#define RS232_RTS_PIN -1
+#endif
+#ifndef RS232_CTS_PIN
+#define RS232_CTS_PIN -1
+#endif
 
 // --- Serial Configuration (920i) ---
 // Port 1: 9600 8N1 CR/LF
 // Port 2: 115200 8N2 CR/LF
 #define RS232_BAUD 9600
 #define RS232_CONFIG SERIAL_8N1  // 8 data bits, no parity, 1 stop bit
+#define RS232_UART_NUM UART_NUM_1
+
+// Optional second capture channel — a second indicator, or the 920i's
+// Port 2 — on UART2. Enabled by defining RS232_2_RX_PIN in build_flags.
+// DevKitC only: the ESP32-C3 has no UART2 (UART0 is the USB console).
+#ifdef RS232_2_RX_PIN
+#define SERIAL_CHANNELS 2
+#ifndef RS232_2_TX_PIN
+#define RS232_2_TX_PIN -1        // Receive-only
+#endif
+#ifndef RS232_2_BAUD
+#define RS232_2_BAUD 115200
+#endif
+#ifndef RS232_2_CONFIG
+#define RS232_2_CONFIG SERIAL_8N2
+#endif
+#ifndef RS232_2_RTS_PIN
+#define RS232_2_RTS_PIN -1
+#endif
+#ifndef RS232_2_CTS_PIN
+#define RS232_2_CTS_PIN -1
+#endif
+#define RS232_2_UART_NUM UART_NUM_2
+#else
+#define SERIAL_CHANNELS 1
+#endif
+
+// ESP-IDF UART driver: RX ring buffer (~8 s of data at 9600 baud, so a
+// slow loop() can't lose bytes), event queue depth, and the stack chunk
+// used for bulk reads out of the ring
+#define UART_RX_RING_SIZE 8192
+#define UART_EVENT_QUEUE_LEN 32
+#define UART_READ_CHUNK 256
+// Collect bytes not followed by CR/LF after this much quiet
+#define UART_PARTIAL_LINE_MS 50
+
+// Flow control (per channel: none, RTS/CTS or XON/XOFF). The 920i is held
+// off once the bytes waiting in the RX ring leave less than the XOFF
+// headroom free, and released when the XON headroom is free again. With
+// it on, a dump that outgrows DUMP_BUFFER_SIZE (flash full, so it can't
+// spill) is split rather than truncated: the rest waits in the ring and
+// becomes the next dump.
+#define FLOW_XOFF_HEADROOM 4096
+#define FLOW_XON_HEADROOM 6144
+// A lost XOFF would leave the 920i sending; repeat it while held off
+#define FLOW_XOFF_RESEND_MS 1000
 
 // The 920i terminates lines with CR/LF
 #define RS232_LINE_TERMINATOR "\r\n"
 
+// Hardware RX FIFO depth; the loop profiler counts any call longer than
+// one FIFO's worth of characters at the fastest channel's baud as a stall
+#define UART_FIFO_BYTES 128
+// Stalls per subsystem logged to serial before going quiet
+#define LOOP_STALL_LOG_LIMIT 10
+
 // --- Data Capture ---
 // Timeout (ms) after last received byte to consider a dump complete.
 // At 9600 baud, one character takes ~1ms. A 40KB dump takes ~40 seconds.
 // 2 seconds of silence means the dump is finished.
 #define DUMP_COMPLETE_TIMEOUT_MS 2000
 
-// Maximum dump size in bytes (920i dumps are ~40KB max)
+// Dump bytes held in RAM (920i dumps are ~40KB max). Past
+// SPILL_RAM_WATERMARK a dump moves to flash instead, so only a dump that
+// can't spill (flash full) is truncated here.
 #define DUMP_BUFFER_SIZE 50000
 
+// Large dumps (truck databases, audit trails): past the watermark the
+// capture streams into SPILL_DIR in SPILL_CHUNK writes, and upload and
+// queueing read it back STREAM_CHUNK at a time — size is limited by free
+// flash (less SPILL_FLASH_RESERVE for the queue and logs), not heap.
+#define SPILL_RAM_WATERMARK 40960
+#define SPILL_CHUNK 4096
+#define SPILL_DIR "/spill"
+#define SPILL_FLASH_RESERVE 65536
+#define STREAM_CHUNK 1024
+
+// --- Dump Filter (/api/filter) ---
+#define FILTER_MAX_PATTERNS 16       // Drop patterns
+#define FILTER_MAX_COLUMNS 8         // Kept columns
+#define FILTER_MAX_FIELDS 16         // Fields split per line; later ones can't be kept
+#define FILTER_MAX_LINE 512          // Longer lines pass through unprojected
+#define RAW_DIR "/raw"               // Unfiltered dumps kept for audit
+#define RAW_KEEP 8                   // Oldest raw dumps are deleted past this
+
+// --- UART Trace (/api/trace) ---
+// Raw RX bytes with timings, for replay with receiver/trace_replay.py
+#define TRACE_DIR "/trace"
+#define TRACE_BUFFER_SIZE 4096       // Staged in RAM between flash writes
+#define TRACE_FLUSH_MS 1000
+#define TRACE_MAX_BYTES 131072       // Rotate trace.bin to trace.1.bin past this
+#define TRACE_MAX_CHANNELS 4
+
+// --- 920i Commands ---
+// Replies are matched in order; this many may be pipelined at once
+#define COMMAND_MAX_INFLIGHT 4
+#define COMMAND_MAX_QUEUED 16
+#define COMMAND_MAX_SCHEDULES 8
+#define COMMAND_HISTORY 16
+#define COMMAND_REPLY_TIMEOUT_MS 1000
+// Minimum spacing between commands on the wire
+#define COMMAND_MIN_GAP_MS 50
+// Line must be quiet this long before a new burst (avoids colliding with
+// the start of a print)
+#define COMMAND_QUIET_MS 250
+// Fastest allowed schedule
+#define COMMAND_MIN_INTERVAL_MS 1000
+
+// --- Live Streaming ---
+// In stream capture mode each CR/LF-terminated line is one reading.
+#define STREAM_MAX_LINE 128
+// Server-Sent Events feed for wall displays: http://<device>:81/
+#define LIVE_STREAM_PORT 81
+#define LIVE_STREAM_MAX_CLIENTS 4
+// Readings arriving faster than this are coalesced (latest wins)
+#define LIVE_STREAM_MIN_INTERVAL_MS 50
+#define LIVE_STREAM_KEEPALIVE_MS 15000
+// UDP datagrams to the receiver host (receiver.py --stream-port)
+#define LIVE_STREAM_UDP_PORT 5001
+
 // --- Device Identity ---
 #define DEVICE_HOSTNAME "brakemachine"
 #define DEVICE_NAME "brakeMachine"
@@ -48,6 +163,11 @@
 #define DEFAULT_UTC_OFFSET -25200
 #define DEFAULT_DST_OFFSET 3600
 
+// --- Wi-Fi Scan (/api/scan) ---
+#define WIFI_SCAN_MS_PER_CHANNEL 300
+#define WIFI_SCAN_MIN_INTERVAL_MS 10000  // Sooner requests get the cached results
+#define WIFI_SCAN_MAX_RESULTS 20
+
 // --- HTTP Upload ---
 #define UPLOAD_ENDPOINT "/upload"
 #define UPLOAD_TIMEOUT_MS 10000
@@ -57,7 +177,112 @@
 #define UPLOAD_RETRY_INTERVAL_MS 30000
 #define DUMP_PREVIEW_LINES 3
 
+// Upload session: the receiver's address is cached for HTTP_DNS_TTL_MS
+// and the connection kept open between uploads (HTTP/1.1 keep-alive).
+// An idle connection is closed after HTTP_IDLE_CLOSE_MS, before the
+// receiver's own idle timeout can close it under a request.
+#define HTTP_DNS_TTL_MS 300000
+#define HTTP_IDLE_CLOSE_MS 20000
+#define HTTP_CONNECT_TIMEOUT_MS 3000   // Until LinkQuality has measured the link
+#define HTTP_RESPONSE_TIMEOUT_MS 5000
+#define HTTP_HEADER_BUF 384
+
+// --- Link Quality ---
+// Upload timeouts, write chunk size and delta threshold follow the
+// measured link (see LinkQuality). Timeouts allow LINK_TIMEOUT_FACTOR
+// times the expected time.
+#define LINK_EWMA_WEIGHT_PCT 25         // Weight of each new sample
+#define LINK_RSSI_SAMPLE_MS 2000
+#define LINK_SAMPLE_MIN_BYTES 4096      // Smaller bodies give no throughput sample
+#define LINK_DEFAULT_BPS 8000           // Assumed until measured
+#define LINK_TIMEOUT_FACTOR 3
+#define LINK_CONNECT_MIN_MS 2000
+#define LINK_CONNECT_MAX_MS 10000
+#define LINK_RESPONSE_MIN_MS 5000      // No tighter than HTTP_RESPONSE_TIMEOUT_MS
+#define LINK_RESPONSE_MAX_MS 20000
+#define LINK_FAILURE_WIDEN_MAX 3        // Timeouts double per failure in a row, up to 8x
+#define LINK_CHUNK_MIN 256
+#define LINK_CHUNK_TARGET_MS 100
+// Below LINK_SLOW_BPS a delta is sent if it saves anything worth having
+#define LINK_SLOW_BPS 4000
+#define LINK_SLOW_DELTA_RATIO_PCT 95
+
+// While RSSI is below UPLOAD_DEFER_RSSI, dumps of UPLOAD_BULK_BYTES or
+// more and queue retries wait until it is back UPLOAD_DEFER_HYSTERESIS_DB
+// above it, or for at most UPLOAD_DEFER_MAX_MS. Summaries still go.
+#define UPLOAD_BULK_BYTES 4096
+#define UPLOAD_DEFER_RSSI -80
+#define UPLOAD_DEFER_HYSTERESIS_DB 5
+#define UPLOAD_DEFER_MAX_MS 600000
+#define UPLOAD_ATTEMPTS 3               // Immediate attempts; 1 on a weak link
+
+// --- Pull Feed (/api/dumps) ---
+// A receiver run with --pull lists the queue, fetches each dump and acks
+// it. With no receiver URL set, dumps wait in the queue for it.
+#define PULL_LIST_MAX 16             // Dumps per /api/dumps page
+#define PULL_ACTIVE_MS 120000        // A listing this recent counts as an active puller
+
+// --- RAM Queue ---
+// Failed uploads wait in RAM first and are only written to QUEUE_DIR
+// after RAM_QUEUE_DWELL_MS, when the RAM tier is over its limits, when
+// free heap drops below RAM_QUEUE_MIN_FREE_HEAP, or on restart. Most
+// failures clear on the next retry, so most dumps never touch flash.
+#define RAM_QUEUE_DWELL_MS 120000
+#define RAM_QUEUE_MAX_DUMPS 4
+#define RAM_QUEUE_MAX_BYTES 65536
+#define RAM_QUEUE_MIN_FREE_HEAP 40000
+
+// --- Dump Summaries ---
+// Record count and weight totals go out ahead of each dump. Undelivered
+// summaries are kept in RAM and retried on their own backoff, not the
+// dump queue's: SUMMARY_RETRY_INTERVAL_MS, doubling per failed try up to
+// SUMMARY_RETRY_MAX_MS.
+#define SUMMARY_RETRY_INTERVAL_MS 5000
+#define SUMMARY_RETRY_MAX_MS 300000
+#define SUMMARY_QUEUE_MAX 16
+
+// --- Delta Upload ---
+// Cumulative reports are sent as line deltas against the last delivered
+// dump of the same report type (HTTP only).
+#define DELTA_DIR "/delta"
+#define DELTA_MAX_TYPES 4
+// Dumps shorter than this are always sent in full
+#define DELTA_MIN_LINES 20
+// Only send a delta if it is at most this % of the full dump
+#define DELTA_MAX_RATIO_PCT 75
+
+// --- MQTT Upload ---
+// Selected by a receiver URL of the form mqtt://[user:pass@]host[:port][/prefix]
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_TOPIC_PREFIX "brakemachine"
+#define MQTT_KEEPALIVE_S 60
+#define MQTT_ACK_TIMEOUT_MS 5000
+#define MQTT_RECONNECT_INTERVAL_MS 5000   // Doubles per failed connect
+#define MQTT_RECONNECT_MAX_MS 300000
+#define MQTT_STATUS_INTERVAL_MS 30000
+
+// --- Logging ---
+// Binary records in a RAM ring, formatted only when read (see logger.h)
+#define LOG_RING_SIZE 8192
+#define LOG_MAX_ARGS 128             // Encoded argument bytes per record
+#define LOG_MAX_STRING 64            // String arguments are truncated to this
+#define LOG_MAX_LINE 200             // Formatted line, must fit LOG_CONSOLE_TX_BUFFER
+#define LOG_CONSOLE_TX_BUFFER 1024   // Serial TX buffer the console echo fills
+#define LOG_DEFAULT_LEVEL LogLevel::INFO
+#define LOG_DIR "/logs"
+#define LOG_SPILL_INTERVAL_MS 5000
+#define LOG_SPILL_MAX_BYTES 65536    // Rotate log.bin to log.1.bin past this
+
+// --- Persistent State (NVS) ---
+#define STATE_COMMIT_DELAY_MS 30000  // Counters/stats are written this long after a change
+#define STATE_ID_BLOCK 16            // Dump ids reserved per NVS write
+
 // --- Web Server ---
 #define WEB_SERVER_PORT 80
 
+// --- Load Generator (/api/test-dump) ---
+#define LOADGEN_DEFAULT_ROWS 5
+#define LOADGEN_MAX_DUMPS 50         // Per run; one result kept per dump
+#define LOADGEN_CHUNKS_PER_LOOP 8    // Unthrottled: UART_READ_CHUNKs fed per loop()
+
 #endif // CONFIG_H
@@ -0,0 +1,33 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <Arduino.h>
+
+// CRC-32 (IEEE 802.3, same as zlib.crc32 / binascii.crc32), computed a
+// byte at a time so it can run alongside capture without a second pass.
+//
+//   uint32_t crc = CRC32_INIT;
+//   crc = crc32Update(crc, b);   // for each byte
+//   uint32_t result = crc32Final(crc);
+
+#define CRC32_INIT 0xFFFFFFFFUL
+
+uint32_t crc32Update(uint32_t crc, uint8_t b);
+
+// Update with a block of bytes
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len);
+
+inline uint32_t crc32Final(uint32_t crc) {
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+// One-shot CRC of a whole buffer
+inline uint32_t crc32Of(const uint8_t* data, size_t len) {
+    return crc32Final(crc32Update(CRC32_INIT, data, len));
+}
+
+inline uint32_t crc32Of(const String& s) {
+    return crc32Of((const uint8_t*)s.c_str(), s.length());
+}
+
+#endif // CRC32_H
@@ -30,7 +30,7 @@ section h3{font-size:.85em;color:var(--tx2);text-transform:uppercase;letter-spac
 .badge{display:inline-block;padding:2px 8px;border-radius:4px;font-size:.75em;font-weight:600}
 .badge.ok{background:#3fb95022;color:var(--ok)}.badge.wn{background:#d2992222;color:var(--wn)}.badge.er{background:#f8514922;color:var(--er)}
 .no-url{background:#d2992218;border:1px solid var(--wn);border-radius:8px;padding:12px 14px;margin-bottom:14px;font-size:.85em;color:var(--wn)}
-input[type=text],input[type=url],input[type=password]{width:100%;padding:9px 10px;border:1px solid var(--bd);border-radius:6px;background:var(--bg);color:var(--tx);font-size:.9em;margin:4px 0 10px}
+input[type=text],input[type=url],input[type=password],input[type=number]{width:100%;padding:9px 10px;border:1px solid var(--bd);border-radius:6px;background:var(--bg);color:var(--tx);font-size:.9em;margin:4px 0 10px}
 button{padding:10px 16px;border:none;border-radius:6px;font-size:.85em;cursor:pointer;font-weight:500}
 .btn-p{background:var(--ac);color:#fff;width:100%}.btn-p:hover{opacity:.85}
 .btn-d{background:var(--er);color:#fff;width:100%;margin-top:8px}.btn-d:hover{opacity:.85}
@@ -41,6 +41,12 @@ details .panel{margin-top:8px}
 label{font-size:.8em;color:var(--tx2)}
 .dot{display:inline-block;width:8px;height:8px;border-radius:50%;margin-right:6px}
 .dot.ok{background:var(--ok)}.dot.er{background:var(--er)}.dot.wn{background:var(--wn)}
+table{width:100%;border-collapse:collapse;font-size:.78em}
+th,td{padding:4px 6px;text-align:right;border-bottom:1px solid var(--bd)}
+th:first-child,td:first-child{text-align:left}
+th{color:var(--tx2);font-weight:500}
+.live{font-size:2.6em;font-weight:600;font-family:ui-monospace,monospace;text-align:center;padding:10px 0;white-space:pre}
+select{width:100%;padding:9px 10px;border:1px solid var(--bd);border-radius:6px;background:var(--bg);color:var(--tx);font-size:.9em;margin:4px 0 10px}
 </style>
 </head><body>
 
@@ -55,12 +61,21 @@ label{font-size:.8em;color:var(--tx2)}
 <div class="card"><div class="lb">Uploaded</div><div class="vl ok" id="uploaded">--</div></div>
 <div class="card"><div class="lb">Failed</div><div class="vl" id="failed">--</div></div>
 <div class="card"><div class="lb">Queued</div><div class="vl" id="queued">--</div></div>
+<div class="card"><div class="lb">UART Errors</div><div class="vl" id="uart-err">--</div></div>
 </div>
 
 <div id="url-warning" class="no-url" style="margin:0 20px 14px;display:none">
-No receiver URL configured &mdash; dumps will be queued locally until a URL is set below.
+No receiver URL configured &mdash; dumps will be queued locally until a URL is set below, or a receiver in pull mode collects them.
 </div>
 
+<section id="live-sec" style="display:none">
+<h3>Live Weight</h3>
+<div class="panel">
+<div class="live" id="live-val">--</div>
+<div class="meta" id="live-info"></div>
+</div>
+</section>
+
 <section>
 <h3>Last Dump</h3>
 <div class="panel">
@@ -74,23 +89,142 @@ No receiver URL configured &mdash; dumps will be queued locally until a URL is s
 <h3>Receiver URL</h3>
 <div class="panel">
 <form id="url-form">
-<input type="url" id="recv-url" placeholder="http://192.168.1.100:5000/upload">
+<input type="url" id="recv-url" placeholder="http://192.168.1.100:5000/upload or mqtt://broker:1883">
 <button type="submit" class="btn-p">Save</button>
 </form>
 <div id="url-status"></div>
+<div class="meta" id="link-info"></div>
+</div>
+</section>
+
+<section>
+<h3>Capture Mode</h3>
+<div class="panel">
+<select id="cap-mode">
+<option value="dump">Dump &mdash; upload each print as one file</option>
+<option value="stream">Stream &mdash; live reading per line</option>
+</select>
+<label>Flow control</label>
+<select id="flow-mode">
+<option value="none">None &mdash; drop bytes past a full buffer</option>
+<option value="rts">RTS/CTS</option>
+<option value="xon">XON/XOFF</option>
+</select>
+<div class="meta" id="flow-info"></div>
 </div>
 </section>
 
+<details id="cmd-sec">
+<summary>920i Commands</summary>
+<div class="panel">
+<form id="cmd-form">
+<label>Send command</label>
+<input type="text" id="cmd-in" placeholder="XG#1">
+<button type="submit" class="btn-p">Send</button>
+</form>
+<form id="sched-form" style="margin-top:12px">
+<label>Schedule (CMD@ms;CMD@ms)</label>
+<input type="text" id="sched-in" placeholder="XG#1@5000;XN#1@10000">
+<button type="submit" class="btn-p">Save Schedule</button>
+</form>
+<div id="sched-status"></div>
+<pre id="cmd-log">--</pre>
+</div>
+</details>
+
+<details id="filter-sec">
+<summary>Dump Filter</summary>
+<div class="panel">
+<div class="meta" id="filter-info">--</div>
+<form id="filter-form">
+<label>Drop lines matching (* and ?, separated by ;)</label>
+<input type="text" id="filter-drop" placeholder="920i Print*;Date:*">
+<label>Keep columns (name or number, separated by ,)</label>
+<input type="text" id="filter-cols" placeholder="ID,Gross,Net">
+<label><input type="checkbox" id="filter-blank"> Drop blank lines</label>
+<label><input type="checkbox" id="filter-raw"> Keep unfiltered copy on flash (recent dumps)</label>
+<button type="submit" class="btn-p">Save Filter</button>
+</form>
+<div id="filter-status"></div>
+<div class="meta" id="filter-raw-list"></div>
+</div>
+</details>
+
+<details id="prof-sec">
+<summary>Loop Profile</summary>
+<div class="panel">
+<div class="meta" id="prof-info">--</div>
+<table>
+<thead><tr><th>Subsystem</th><th>Avg &micro;s</th><th>Time %</th><th>Worst ms</th><th>When</th><th>Stalls</th></tr></thead>
+<tbody id="prof-body"></tbody>
+</table>
+<button class="btn-d" id="prof-reset">Reset Counters</button>
+</div>
+</details>
+
+<details id="log-sec">
+<summary>Device Log</summary>
+<div class="panel">
+<div class="meta" id="log-info">--</div>
+<label>Level</label>
+<select id="log-level">
+<option value="error">Error</option>
+<option value="warn">Warn</option>
+<option value="info">Info</option>
+<option value="debug">Debug</option>
+</select>
+<label><input type="checkbox" id="log-spill"> Keep on flash (survives reboot)</label>
+<pre id="log-out" style="max-height:300px;overflow-y:auto"></pre>
+<button class="btn-d" id="log-flash">Show Flash Log</button>
+</div>
+</details>
+
+<details id="trace-sec">
+<summary>UART Trace</summary>
+<div class="panel">
+<div class="meta" id="trace-info">--</div>
+<label><input type="checkbox" id="trace-on"> Record raw UART traffic to flash</label>
+<button class="btn-p" id="trace-get">Download Trace</button>
+<button class="btn-d" id="trace-clear">Clear</button>
+</div>
+</details>
+
+<details id="load-sec">
+<summary>Load Test</summary>
+<div class="panel">
+<div class="meta" id="load-info">Feeds synthetic 920i dumps through capture, queue and upload</div>
+<form id="load-form">
+<label>Rows per dump</label>
+<input type="number" id="load-rows" value="1400" min="1">
+<label>Dumps</label>
+<input type="number" id="load-count" value="5" min="1" max="50">
+<label>Gap between dumps (ms)</label>
+<input type="number" id="load-interval" value="1000" min="0">
+<label>Byte rate (B/s, 0 = unthrottled)</label>
+<input type="number" id="load-rate" value="0" min="0">
+<button type="submit" class="btn-p">Start</button>
+<button type="button" class="btn-d" id="load-stop">Stop</button>
+</form>
+<table>
+<thead><tr><th>#</th><th>Bytes</th><th>Feed ms</th><th>Close ms</th><th>Submit ms</th><th>Result</th></tr></thead>
+<tbody id="load-body"></tbody>
+</table>
+</div>
+</details>
+
 <details>
 <summary>WiFi Configuration</summary>
 <div class="panel">
 <form action="/save" method="POST">
 <label>SSID</label>
+<select id="scan-list" style="display:none"></select>
 <input type="text" name="ssid" id="ssid-in">
 <label>Password</label>
 <input type="password" name="pass">
 <button type="submit" class="btn-p">Connect</button>
 </form>
+<button class="btn-p" id="scan-btn">Scan for Networks</button>
+<div class="meta" id="scan-info"></div>
 <form action="/api/clear-wifi" method="POST">
 <button type="submit" class="btn-d">Forget Network</button>
 </form>
@@ -100,6 +234,19 @@ No receiver URL configured &mdash; dumps will be queued locally until a URL is s
 <script>
 const $=id=>document.getElementById(id);
 let urlEdited=false;
+let es=null;
+
+function liveConnect(port){
+  if(es)return;
+  es=new EventSource('http://'+location.hostname+':'+port+'/');
+  es.onmessage=e=>{$('live-val').textContent=e.data;};
+  es.onerror=()=>{$('live-val').className='live wn';};
+  es.onopen=()=>{$('live-val').className='live';};
+}
+
+function liveClose(){
+  if(es){es.close();es=null;}
+}
 
 function fmt(s){
   const h=Math.floor(s/3600),m=Math.floor((s%3600)/60);
@@ -116,21 +263,51 @@ async function refresh(){
 
     $('uptime').textContent=fmt(d.uptime);
     $('dumps').textContent=d.dump_count;
+    $('dumps').title=d.channels?d.channels.map(c=>'ch '+c.channel+': '+c.dumps+' ('+c.baud+' baud, '+c.mode+')').join('\n'):'';
     $('uploaded').textContent=d.upload_success;
 
     const f=d.upload_failed;
     $('failed').textContent=f;
-    $('failed').className='vl'+(f>0?' er':'');
+    $('failed').className='vl'+(f>0?(d.queue_depth>0?' er':' wn'):'');
 
     const q=d.queue_depth;
     $('queued').textContent=q;
     $('queued').className='vl'+(q>0?' wn':' ok');
+    $('queued').title=d.queue_ram+' in RAM, '+(q-d.queue_ram)+' on flash \u2014 '+d.flash_writes_avoided+' flash writes avoided';
+
+    const lk=d.link;
+    $('link-info').textContent=!lk.rssi?'':'Link '+lk.rssi+' dBm'
+      +(lk.samples?', '+(lk.throughput?(lk.throughput/1024).toFixed(1)+' KB/s, ':'')+lk.rtt_ms+' ms RTT':'')
+      +' \u2014 timeouts '+(lk.connect_timeout_ms/1000).toFixed(1)+'/'+(lk.response_timeout_ms/1000).toFixed(1)+' s'
+      +(lk.deferring?' \u2014 weak, '+lk.deferred+' upload(s) deferred':'');
+    $('cap-mode').value=d.capture_mode;
+    const fl=d.flow;
+    $('flow-mode').value=fl.mode;
+    $('flow-info').textContent=fl.mode==='none'?'':(fl.throttled?'Holding off the 920i \u2014 ':'')
+      +'held off '+fl.throttles+'\u00d7, '+(fl.throttled_ms/1000).toFixed(1)+' s total, '+fl.splits+' dump(s) split';
+    if(d.live){
+      $('live-sec').style.display='block';
+      $('live-info').textContent=d.live.readings+' readings \u2014 '+d.live.clients+' viewer(s), '+d.live.coalesced+' coalesced';
+      liveConnect(d.live.port);
+    }else{
+      $('live-sec').style.display='none';
+      liveClose();
+    }
+
+    const ue=d.uart_errors,ut=ue.framing+ue.parity+ue.overflow+ue.break;
+    $('uart-err').textContent=ut;
+    $('uart-err').className='vl'+(ut>0?' wn':'');
+    $('uart-err').title='framing '+ue.framing+', parity '+ue.parity+', overflow '+ue.overflow+', break '+ue.break
+      +(d.queue_corrupt>0?' \u2014 '+d.queue_corrupt+' queued dump(s) failed CRC':'');
 
     const noUrl=!d.receiver_url||d.receiver_url.length===0;
-    $('url-warning').style.display=noUrl?'block':'none';
+    $('url-warning').style.display=noUrl&&!d.pull_active?'block':'none';
 
     if(d.last_dump&&d.last_dump.id>0){
-      $('dump-info').textContent=d.last_dump.timestamp+' \u2014 '+(d.last_dump.size/1024).toFixed(1)+' KB';
+      const sm=d.last_dump.summary;
+      $('dump-info').textContent=(d.channels?'Ch '+d.last_dump.channel+' \u2014 ':'')+d.last_dump.timestamp+' \u2014 '+(d.last_dump.size/1024).toFixed(1)+' KB, crc '+d.last_dump.crc
+        +(sm&&sm.records>0?' \u2014 '+sm.records+' records (#'+sm.first_id+'\u2013#'+sm.last_id+'), net '+sm.net.total.toFixed(1)+' '+sm.unit
+          +' (min '+sm.net.min.toFixed(1)+', max '+sm.net.max.toFixed(1)+')':'');
       if(d.last_dump.uploaded){
         $('dump-badge').innerHTML='<span class="badge ok">Uploaded</span>';
       }else if(q>0){
@@ -165,6 +342,246 @@ $('url-form').addEventListener('submit',async e=>{
 
 $('recv-url').addEventListener('input',()=>urlEdited=true);
 
+let schedEdited=false;
+
+async function refreshCmds(){
+  if(!$('cmd-sec').open)return;
+  try{
+    const c=await fetch('/api/commands').then(r=>r.json());
+    if(!schedEdited)$('sched-in').value=c.schedule;
+    let t='';
+    for(const s of c.schedules)
+      t+=s.cmd+' \u2192 '+(s.last_reply||'--')+(s.age_s!==undefined?' ('+s.age_s+'s ago)':'')+'\n';
+    if(c.schedules.length)t+='\n';
+    for(const h of c.history)
+      t+='#'+h.id+' '+h.cmd+' \u2192 '+(h.status==='done'?(h.reply||'sent'):'TIMEOUT')
+        +(h.latency_ms!==undefined?' '+h.latency_ms+'ms':'')+'\n';
+    $('cmd-log').textContent=t||'No commands yet';
+  }catch(e){}
+}
+
+$('cmd-form').addEventListener('submit',async e=>{
+  e.preventDefault();
+  await fetch('/api/command',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:'cmd='+encodeURIComponent($('cmd-in').value)
+  });
+  setTimeout(refreshCmds,1500);
+});
+
+$('sched-form').addEventListener('submit',async e=>{
+  e.preventDefault();
+  const res=await fetch('/api/command-schedule',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:'sched='+encodeURIComponent($('sched-in').value)
+  });
+  $('sched-status').innerHTML=res.ok?'<span class="saved">Saved!</span>':'<span class="er">'+await res.text()+'</span>';
+  setTimeout(()=>$('sched-status').innerHTML='',3000);
+  schedEdited=false;
+  refreshCmds();
+});
+
+$('sched-in').addEventListener('input',()=>schedEdited=true);
+$('cmd-sec').addEventListener('toggle',refreshCmds);
+setInterval(refreshCmds,5000);
+
+async function refreshFilter(){
+  if(!$('filter-sec').open)return;
+  try{
+    const [f,d]=await Promise.all([fetch('/api/filter').then(r=>r.json()),fetch('/api/status').then(r=>r.json())]);
+    $('filter-drop').value=f.drop;
+    $('filter-cols').value=f.columns;
+    $('filter-blank').checked=f.blank;
+    $('filter-raw').checked=f.raw;
+    const s=d.filter;
+    $('filter-info').textContent=s.bytes_in?(s.bytes_in/1024).toFixed(1)+' KB captured, '+(s.bytes_out/1024).toFixed(1)
+      +' KB kept ('+(100-100*s.bytes_out/s.bytes_in).toFixed(0)+'% saved), '+s.lines_dropped+' lines dropped'
+      :(s.active?'No dumps filtered yet':'Off \u2014 dumps are uploaded as received');
+    $('filter-raw-list').innerHTML=f.raw_dumps.length?'Raw dumps: '+f.raw_dumps.map(id=>'<a href="/api/raw?id='+id+'">#'+id+'</a>').join(' '):'';
+  }catch(e){}
+}
+
+$('filter-form').addEventListener('submit',async e=>{
+  e.preventDefault();
+  const res=await fetch('/api/filter',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:'drop='+encodeURIComponent($('filter-drop').value)+'&columns='+encodeURIComponent($('filter-cols').value)
+      +'&blank='+($('filter-blank').checked?1:0)+'&raw='+($('filter-raw').checked?1:0)
+  });
+  $('filter-status').innerHTML=res.ok?'<span class="saved">Saved!</span>':'<span class="er">'+await res.text()+'</span>';
+  setTimeout(()=>$('filter-status').innerHTML='',3000);
+  refreshFilter();
+});
+
+$('filter-sec').addEventListener('toggle',refreshFilter);
+
+async function refreshProfile(){
+  if(!$('prof-sec').open)return;
+  try{
+    const p=await fetch('/api/profile').then(r=>r.json());
+    const ago=s=>s<1?'now':fmt(s)+' ago';
+    $('prof-info').textContent=p.loops+' loops in '+fmt(p.window_s)+' \u2014 avg '+p.loop_avg_us+' \u00b5s, worst '
+      +(p.loop_max_us/1000).toFixed(1)+' ms ('+ago(p.loop_max_age_s)+'), '+p.loop_stalls
+      +' stalls > '+(p.stall_us/1000).toFixed(0)+' ms';
+    const total=p.sections.reduce((a,s)=>a+s.total_ms,0)||1;
+    $('prof-body').innerHTML=p.sections.map(s=>'<tr><td>'+s.name+'</td><td>'+s.avg_us+'</td><td>'
+      +(100*s.total_ms/total).toFixed(1)+'</td><td'+(s.max_us>=p.stall_us?' class="er"':'')+'>'
+      +(s.max_us/1000).toFixed(1)+'</td><td>'+(s.calls?ago(s.max_age_s):'--')+'</td><td'
+      +(s.stalls>0?' class="wn"':'')+'>'+s.stalls+'</td></tr>').join('');
+  }catch(e){}
+}
+
+$('prof-reset').addEventListener('click',async()=>{
+  await fetch('/api/profile-reset',{method:'POST'});
+  refreshProfile();
+});
+$('prof-sec').addEventListener('toggle',refreshProfile);
+setInterval(refreshProfile,5000);
+
+let logNext=0;
+async function refreshLog(){
+  if(!$('log-sec').open)return;
+  try{
+    const res=await fetch('/api/logs?since='+logNext);
+    const t=await res.text();
+    logNext=+res.headers.get('X-Log-Next')||logNext;
+    const out=$('log-out');
+    out.textContent=(out.textContent+t).slice(-20000);
+    out.scrollTop=out.scrollHeight;
+  }catch(e){}
+}
+
+async function refreshLogConfig(){
+  if(!$('log-sec').open)return;
+  try{
+    const c=await fetch('/api/log-config').then(r=>r.json());
+    $('log-level').value=c.levels.main;
+    $('log-spill').checked=c.spill;
+    $('log-info').innerHTML=c.dropped?'<span class="wn">'+c.dropped+' records dropped</span> (ring full)':'No records dropped';
+  }catch(e){}
+}
+
+async function postLogConfig(body){
+  await fetch('/api/log-config',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:body
+  });
+  refreshLogConfig();
+}
+
+$('log-level').addEventListener('change',e=>postLogConfig('level='+e.target.value));
+$('log-spill').addEventListener('change',e=>postLogConfig('spill='+(e.target.checked?1:0)));
+$('log-flash').addEventListener('click',async()=>{
+  try{$('log-out').textContent=await fetch('/api/logs?flash=1').then(r=>r.text())||'Flash log is empty';}catch(e){}
+});
+$('log-sec').addEventListener('toggle',()=>{refreshLogConfig();refreshLog();});
+setInterval(refreshLog,2000);
+
+async function refreshTrace(){
+  if(!$('trace-sec').open)return;
+  try{
+    const t=(await fetch('/api/status').then(r=>r.json())).trace;
+    $('trace-on').checked=t.on;
+    $('trace-info').innerHTML=(t.bytes?(t.bytes/1024).toFixed(1)+' KB on flash':'Nothing recorded')
+      +(t.on?', '+t.records+' records this session':'')
+      +(t.dropped?', <span class="wn">'+t.dropped+' bytes lost (flash full)</span>':'');
+  }catch(e){}
+}
+
+async function postTrace(body){
+  await fetch('/api/trace',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:body
+  });
+  refreshTrace();
+}
+
+$('trace-on').addEventListener('change',e=>postTrace('on='+(e.target.checked?1:0)));
+$('trace-get').addEventListener('click',()=>location.href='/api/trace');
+$('trace-clear').addEventListener('click',()=>postTrace('clear=1'));
+$('trace-sec').addEventListener('toggle',refreshTrace);
+setInterval(refreshTrace,5000);
+
+function showLoad(l){
+  const up=l.results.filter(r=>r.uploaded).length;
+  $('load-info').innerHTML=(l.running?'<span class="wn">Running</span> \u2014 ':'')
+    +l.results.length+'/'+l.count+' dumps of '+l.rows+' rows on ch '+l.channel+', '+up+' uploaded';
+  $('load-body').innerHTML=l.results.map((r,i)=>'<tr><td>'+(i+1)+'</td><td>'+r.bytes+'</td><td>'+r.feed_ms
+    +'</td><td>'+r.close_ms+'</td><td>'+r.submit_ms+'</td><td>'
+    +(r.uploaded?'<span class="ok">Uploaded</span>':'<span class="wn">Queued</span>')+'</td></tr>').join('');
+  return l.running;
+}
+
+async function refreshLoad(){
+  if(!$('load-sec').open)return;
+  try{
+    if(showLoad(await fetch('/api/test-dump').then(r=>r.json())))setTimeout(refreshLoad,1000);
+  }catch(e){}
+}
+
+$('load-form').addEventListener('submit',async e=>{
+  e.preventDefault();
+  const res=await fetch('/api/test-dump',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:'rows='+$('load-rows').value+'&count='+$('load-count').value
+      +'&interval='+$('load-interval').value+'&rate='+$('load-rate').value
+  });
+  if(!res.ok){$('load-info').innerHTML='<span class="er">'+await res.text()+'</span>';return;}
+  showLoad(await res.json());
+  setTimeout(refreshLoad,1000);
+});
+$('load-stop').addEventListener('click',async()=>{
+  try{showLoad(await fetch('/api/test-dump-stop',{method:'POST'}).then(r=>r.json()));}catch(e){}
+});
+$('load-sec').addEventListener('toggle',refreshLoad);
+
+$('cap-mode').addEventListener('change',async e=>{
+  await fetch('/api/set-capture-mode',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:'mode='+e.target.value
+  });
+  refresh();
+});
+
+$('flow-mode').addEventListener('change',async e=>{
+  const res=await fetch('/api/set-flow-control',{
+    method:'POST',
+    headers:{'Content-Type':'application/x-www-form-urlencoded'},
+    body:'mode='+e.target.value
+  });
+  if(!res.ok){$('flow-info').textContent=await res.text();return;}
+  refresh();
+});
+
+async function showScan(){
+  try{
+    const s=await fetch('/api/scan').then(r=>r.json());
+    const sel=$('scan-list');
+    if(s.networks.length){
+      sel.innerHTML='';
+      sel.add(new Option('Pick a network (scanned '+fmt(s.age_s)+' ago)',''));
+      for(const n of s.networks)
+        sel.add(new Option(n.ssid+' \u2014 '+n.rssi+' dBm, ch'+n.channel+(n.auth==='open'?', open':''),n.ssid));
+      sel.style.display='';
+    }
+    $('scan-info').textContent=s.scanning?'Scanning...':s.networks.length?'':'No networks found';
+    if(s.scanning)setTimeout(showScan,1000);
+  }catch(e){}
+}
+
+$('scan-btn').addEventListener('click',async()=>{
+  await fetch('/api/scan',{method:'POST'});
+  showScan();
+});
+$('scan-list').addEventListener('change',e=>{if(e.target.value)$('ssid-in').value=e.target.value;});
+
 refresh();
 setInterval(refresh,5000);
 </script>
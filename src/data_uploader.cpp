@@ -1,54 +1,95 @@
 #include "data_uploader.h"
 #include "config.h"
+#include "logger.h"
+#include "http_transport.h"
+#include "mqtt_transport.h"
+#include "crc32.h"
+#include "device_id.h"
+#include "queue_record.h"
+#include "persistent_state.h"
 #include <LittleFS.h>
-#include <HTTPClient.h>
-#include <WiFi.h>
+#include <esp_system.h>
+#include <ArduinoJson.h>
+#include <algorithm>
+
+// Instance flushed by the shutdown handler (there is only one uploader)
+static DataUploader* s_shutdownUploader = nullptr;
 
 DataUploader::DataUploader()
-    : _nextFileId(1)
-    , _lastRetryTime(0)
+    : _lastRetryTime(0)
     , _retryInterval(UPLOAD_RETRY_INTERVAL_MS)
     , _consecutiveFailures(0)
-    , _isConnected(nullptr) {
+    , _lastStatusPublish(0)
+    , _lastSummaryTry(0)
+    , _summaryInterval(SUMMARY_RETRY_INTERVAL_MS)
+    , _summaryFailures(0)
+    , _isConnected(nullptr)
+    , _statusProvider(nullptr)
+    , _ramBytes(0) {
 }
 
 void DataUploader::begin() {
     if (!LittleFS.begin(true)) {
-        Serial.println("[Uploader] LittleFS mount failed!");
+        Log.error(LogModule::UPLOADER, "LittleFS mount failed!");
         return;
     }
 
     if (!LittleFS.exists(QUEUE_DIR)) {
         LittleFS.mkdir(QUEUE_DIR);
     }
+    _delta.begin();
+
+    _stats.receiverUrl = State.getString("uploader", "url", DEFAULT_RECEIVER_URL);
+    _stats.totalSuccess = State.getUInt("uploader", "ok_total");
+    _stats.totalFailed = State.getUInt("uploader", "fail_total");
 
-    _prefs.begin("uploader", false);
-    _stats.receiverUrl = _prefs.getString("url", DEFAULT_RECEIVER_URL);
-    _nextFileId = _prefs.getUInt("next_id", 1);
-    _prefs.end();
+    _createTransport();
+    _updateDepth();
 
-    _stats.queueDepth = _countQueue();
+    s_shutdownUploader = this;
+    esp_register_shutdown_handler(_onShutdown);
 
-    Serial.printf("[Uploader] Ready. Queue: %u pending\n", _stats.queueDepth);
+    Log.info(LogModule::UPLOADER, "Ready. Queue: %u pending", _stats.queueDepth);
     if (_stats.receiverUrl.length() > 0) {
-        Serial.printf("[Uploader] URL: %s\n", _stats.receiverUrl.c_str());
+        Log.info(LogModule::UPLOADER, "URL: %s (%s)",
+                 _stats.receiverUrl.c_str(), _stats.transport.c_str());
     } else {
-        Serial.println("[Uploader] No receiver URL configured — set via dashboard");
+        Log.info(LogModule::UPLOADER, "No receiver URL configured — set via dashboard");
     }
 }
 
 void DataUploader::update() {
-    if (_stats.queueDepth == 0) return;
+    // Dwell time and heap pressure apply whether or not we're online
+    _flushRam(false);
+
     if (_isConnected && !_isConnected()) return;
-    if (_stats.receiverUrl.length() == 0) return;
+    if (!_transport) return;
+
+    _transport->update();
+    _link.update();
+
+    if (_statusProvider && millis() - _lastStatusPublish >= MQTT_STATUS_INTERVAL_MS) {
+        _lastStatusPublish = millis();
+        _transport->publishStatus(_statusProvider());
+    }
+
+    // Summaries retry on their own backoff, ahead of the queue
+    if (!_summaries.empty() && millis() - _lastSummaryTry >= _summaryInterval) {
+        _sendSummaries();
+    }
+
+    if (_stats.queueDepth == 0) return;
+    if (_link.deferBulk()) return;   // Not a failure; no backoff
     if (millis() - _lastRetryTime < _retryInterval) return;
 
     _lastRetryTime = millis();
-    Serial.printf("[Uploader] Retrying queue (%u pending, next in %lus)...\n",
-                  _stats.queueDepth, _retryInterval / 1000);
+    Log.info(LogModule::UPLOADER, "Retrying queue (%u pending, next in %lus)...",
+             _stats.queueDepth, _retryInterval / 1000);
 
-    if (_retryOldest()) {
-        _stats.queueDepth = _countQueue();
+    // Flash holds the older dumps (the RAM tier spills oldest first)
+    bool ok = (_stats.queueDepth > _stats.ramQueued) ? _retryOldest() : _retryRam();
+    _updateDepth();
+    if (ok) {
         _consecutiveFailures = 0;
         _retryInterval = UPLOAD_RETRY_INTERVAL_MS;
     } else {
@@ -59,67 +100,143 @@ void DataUploader::update() {
     }
 }
 
-void DataUploader::submitDump(const String& data, size_t length, const String& timestamp) {
-    uint32_t id = _nextFileId++;
+void DataUploader::submitDump(const String& data, size_t length, const String& timestamp, uint32_t crc,
+                              uint8_t channel, const DumpSummary& summary) {
+    uint32_t id = _beginDump(length, timestamp, crc, channel, summary);
+    _lastDump.preview = dumpPreview(data);
+
+    bool uploaded = _uploadNow(id, length, timestamp, [&]() {
+        return _attemptUpload(data, timestamp, id, crc, channel);
+    });
+    if (!uploaded) {
+        _queueDump(data, id, timestamp, crc, channel);
+    }
+}
+
+void DataUploader::submitFile(const String& path, size_t length, const String& timestamp, uint32_t crc,
+                              uint8_t channel, const DumpSummary& summary) {
+    uint32_t id = _beginDump(length, timestamp, crc, channel, summary);
+
+    File f = LittleFS.open(path, "r");
+    if (f) {
+        uint8_t head[512];
+        size_t n = f.read(head, sizeof(head));
+        f.close();
+        String start;
+        start.concat((const char*)head, n);
+        _lastDump.preview = dumpPreview(start);
+    }
+
+    // Already on flash: a failure goes straight to the flash queue, the
+    // RAM tier would have to read it whole
+    bool uploaded = _uploadNow(id, length, timestamp, [&]() {
+        return _attemptFileUpload(path, length, timestamp, id, crc, channel);
+    });
+    if (!uploaded) {
+        _saveFileToDisk(path, length, id, timestamp, crc, channel);
+        _updateDepth();
+    }
+}
 
-    _prefs.begin("uploader", false);
-    _prefs.putUInt("next_id", _nextFileId);
-    _prefs.end();
+uint32_t DataUploader::_beginDump(size_t length, const String& timestamp, uint32_t crc,
+                                  uint8_t channel, const DumpSummary& summary) {
+    uint32_t id = State.nextId("uploader", "next_id");
 
     _lastDump.id = id;
     _lastDump.timestamp = timestamp;
     _lastDump.size = length;
+    _lastDump.crc = crc;
+    _lastDump.channel = channel;
+    _lastDump.summary = summary;
     _lastDump.uploaded = false;
-    _lastDump.preview = _extractPreview(data);
+    _lastDump.preview = "";
+
+    // The summary goes first: a few hundred bytes that get through long
+    // before the body on a weak link. Pull mode has nowhere to send it.
+    // While the last try failed it waits for its backoff in update()
+    // instead of holding up the dump.
+    if (_transport) {
+        _queueSummary(summary, id, timestamp, crc, channel);
+        if (_summaryFailures == 0) _sendSummaries();
+    }
+    return id;
+}
 
+bool DataUploader::_uploadNow(uint32_t id, size_t length, const String& timestamp,
+                              std::function<bool()> attempt) {
     if (_stats.receiverUrl.length() == 0) {
-        Serial.printf("[Uploader] Dump #%u: no receiver URL configured, queuing\n", id);
-        _stats.totalFailed++;
-        _saveToDisk(data, id, timestamp);
-        _stats.queueDepth = _countQueue();
-        return;
+        // Pull mode: the dump waits in the queue for a receiver to collect it
+        Log.info(LogModule::UPLOADER, "Dump #%u: no receiver URL, queued for pull", id);
+        return false;
     }
 
-    // Try up to 3 times immediately before queuing
+    // Weak signal: the summary has gone, the body waits for it to recover
+    _link.update();
+    if (length >= UPLOAD_BULK_BYTES && _link.deferBulk()) {
+        _stats.deferred++;
+        Log.info(LogModule::UPLOADER, "Dump #%u: weak link (%d dBm), queued", id, _link.getRssi());
+        return false;
+    }
+
+    // A few immediate tries before queuing — one if the link is failing
+    uint8_t attempts = _link.attempts();
     bool uploaded = false;
-    for (int attempt = 1; attempt <= 3; attempt++) {
-        if (_attemptUpload(data, timestamp, id)) {
+    for (uint8_t n = 1; n <= attempts; n++) {
+        if (attempt()) {
             uploaded = true;
             break;
         }
-        if (attempt < 3) {
-            Serial.printf("[Uploader] Dump #%u attempt %d failed, retrying...\n", id, attempt);
-            delay(500);
+        if (n < attempts) {
+            Log.warn(LogModule::UPLOADER, "Dump #%u attempt %u failed, retrying...", id, n);
+            delay(_link.retryDelay());
         }
     }
 
     if (uploaded) {
         _lastDump.uploaded = true;
-        _stats.totalSuccess++;
+        _countUpload(true);
         _stats.lastUploadTime = timestamp;
-        Serial.printf("[Uploader] Dump #%u uploaded OK\n", id);
+        Log.info(LogModule::UPLOADER, "Dump #%u uploaded OK", id);
+    } else {
+        _countUpload(false);
+        Log.info(LogModule::UPLOADER, "Dump #%u queued after %u attempt(s)", id, attempts);
+    }
+    return uploaded;
+}
+
+void DataUploader::_countUpload(bool ok) {
+    // Saved with the next coalesced commit, not per dump
+    if (ok) {
+        State.setUInt("uploader", "ok_total", ++_stats.totalSuccess);
     } else {
-        _stats.totalFailed++;
-        _saveToDisk(data, id, timestamp);
-        _stats.queueDepth = _countQueue();
-        Serial.printf("[Uploader] Dump #%u queued after 3 attempts\n", id);
+        State.setUInt("uploader", "fail_total", ++_stats.totalFailed);
     }
 }
 
+void DataUploader::flushToDisk() {
+    _flushRam(true);
+    _updateDepth();
+}
+
 void DataUploader::setConnectivityCheck(ConnectivityCheck check) {
     _isConnected = check;
 }
 
+void DataUploader::setStatusProvider(StatusProvider provider) {
+    _statusProvider = provider;
+}
+
 void DataUploader::setReceiverUrl(const String& url) {
     _stats.receiverUrl = url;
-    _prefs.begin("uploader", false);
-    _prefs.putString("url", url);
-    _prefs.end();
+    State.setString("uploader", "url", url);
+    State.commit();
+    _createTransport();
     // Reset backoff so new URL gets tried quickly
     _consecutiveFailures = 0;
     _retryInterval = UPLOAD_RETRY_INTERVAL_MS;
     _lastRetryTime = 0;
-    Serial.printf("[Uploader] Receiver URL set: %s\n", url.c_str());
+    _lastStatusPublish = 0;
+    Log.info(LogModule::UPLOADER, "Receiver URL set: %s (%s)", url.c_str(), _stats.transport.c_str());
 }
 
 String DataUploader::getReceiverUrl() const {
@@ -134,54 +251,370 @@ const DumpRecord& DataUploader::getLastDump() const {
     return _lastDump;
 }
 
-bool DataUploader::_attemptUpload(const String& data, const String& timestamp, uint32_t id) {
-    Serial.printf("[Uploader] POST %u bytes to %s\n", data.length(), _stats.receiverUrl.c_str());
+const DeltaEncoder& DataUploader::getDelta() const {
+    return _delta;
+}
 
-    WiFiClient client;
-    client.setTimeout(3);  // 3 second connect timeout
+const LinkQuality& DataUploader::getLink() const {
+    return _link;
+}
 
-    HTTPClient http;
-    if (!http.begin(client, _stats.receiverUrl)) {
-        Serial.println("[Uploader] HTTP begin failed (bad URL?)");
-        return false;
+std::vector<QueuedDump> DataUploader::listQueued(uint32_t after, size_t limit) {
+    _stats.lastPullAt = millis();
+
+    std::vector<QueuedDump> out;
+    for (const RamEntry& e : _ram) {
+        if (e.id <= after) continue;
+        QueuedDump d;
+        d.id = e.id;
+        d.timestamp = e.timestamp;
+        d.size = e.data.length();
+        d.crc = e.crc;
+        d.channel = e.channel;
+        d.inRam = true;
+        out.push_back(d);
     }
 
-    http.setTimeout(5000);  // 5 second response timeout
-    http.addHeader("Content-Type", "text/tab-separated-values");
-    http.addHeader("X-Device-Name", DEVICE_NAME);
-    http.addHeader("X-Timestamp", timestamp);
-    http.addHeader("X-Dump-Id", String(id));
+    File dir = LittleFS.open(QUEUE_DIR);
+    if (dir && dir.isDirectory()) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            String name = String(entry.name());
+            if (name.endsWith(".tsv")) {
+                int lastSlash = name.lastIndexOf('/');
+                uint32_t id = name.substring(lastSlash + 1).toInt();
+                QueuedDump d;
+                if (id > after && _readQueuedMeta(_queuePath(id), id, d)) {
+                    out.push_back(d);
+                }
+            }
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
 
-    int code = http.POST((uint8_t*)data.c_str(), data.length());
-    http.end();
+    std::sort(out.begin(), out.end(),
+              [](const QueuedDump& a, const QueuedDump& b) { return a.id < b.id; });
+    if (out.size() > limit) out.resize(limit);
+    return out;
+}
 
-    if (code >= 200 && code < 300) {
+bool DataUploader::findQueued(uint32_t id, QueuedDump& out) {
+    for (const RamEntry& e : _ram) {
+        if (e.id != id) continue;
+        out.id = e.id;
+        out.timestamp = e.timestamp;
+        out.size = e.data.length();
+        out.crc = e.crc;
+        out.channel = e.channel;
+        out.inRam = true;
         return true;
     }
+    return _readQueuedMeta(_queuePath(id), id, out);
+}
+
+bool DataUploader::writeQueued(uint32_t id, Print& out) {
+    for (const RamEntry& e : _ram) {
+        if (e.id == id) {
+            return out.write((const uint8_t*)e.data.c_str(), e.data.length()) == e.data.length();
+        }
+    }
+
+    File f = LittleFS.open(_queuePath(id), "r");
+    if (!f) return false;
+    f.readStringUntil('\n');   // Metadata line
+
+    uint8_t chunk[STREAM_CHUNK];
+    bool ok = true;
+    size_t n;
+    while (ok && (n = f.read(chunk, sizeof(chunk))) > 0) {
+        ok = out.write(chunk, n) == n;
+    }
+    f.close();
+    return ok;
+}
+
+bool DataUploader::ackQueued(uint32_t id) {
+    QueuedDump d;
+    if (!findQueued(id, d)) return false;
+
+    if (d.inRam) {
+        for (size_t i = 0; i < _ram.size(); i++) {
+            if (_ram[i].id != id) continue;
+            _ramBytes -= _ram[i].data.length();
+            _ram.erase(_ram.begin() + i);
+            break;
+        }
+        _stats.flashWritesAvoided++;
+    } else {
+        LittleFS.remove(_queuePath(id));
+    }
+
+    _countUpload(true);
+    _stats.pulled++;
+    _stats.lastUploadTime = d.timestamp;
+    if (_lastDump.id == id) _lastDump.uploaded = true;
+    _updateDepth();
+    Log.info(LogModule::UPLOADER, "Dump #%u collected by receiver", id);
+    return true;
+}
+
+void DataUploader::rejectQueued(uint32_t id) {
+    String path = _queuePath(id);
+    File f = LittleFS.open(path, "r");
+    if (!f) {
+        // A RAM copy was never written anywhere; the damage was in
+        // transit, so keep it for the next pull
+        Log.warn(LogModule::UPLOADER, "Receiver rejected #%u (CRC), keeping it", id);
+        return;
+    }
+
+    String metaLine = f.readStringUntil('\n');
+    String timestamp;
+    uint32_t stored;
+    bool hasCrc;
+    uint8_t channel;
+    parseQueueMeta(metaLine, timestamp, stored, hasCrc, channel);
+
+    uint32_t crc = CRC32_INIT;
+    uint8_t chunk[STREAM_CHUNK];
+    size_t n;
+    while ((n = f.read(chunk, sizeof(chunk))) > 0) {
+        crc = crc32Update(crc, chunk, n);
+    }
+    crc = crc32Final(crc);
+    f.close();
+
+    if (hasCrc && stored != crc) {
+        _quarantine(path, id, stored, crc);
+    } else {
+        Log.warn(LogModule::UPLOADER, "Receiver rejected #%u (CRC) but the flash copy is good, keeping it", id);
+    }
+}
+
+void DataUploader::_createTransport() {
+    _transport.reset();
+    _stats.transport = "";
+    if (_stats.receiverUrl.length() == 0) return;
+
+    if (_stats.receiverUrl.startsWith("mqtt://")) {
+        _transport.reset(new MqttTransport(_stats.receiverUrl));
+    } else {
+        _transport.reset(new HttpTransport(_stats.receiverUrl, _link));
+    }
+    _stats.transport = _transport->name();
+}
+
+void DataUploader::_queueSummary(const DumpSummary& summary, uint32_t id, const String& timestamp,
+                                 uint32_t crc, uint8_t channel) {
+    if (_summaries.size() >= SUMMARY_QUEUE_MAX) {
+        Log.warn(LogModule::UPLOADER, "Summary queue full, dropping #%u", _summaries.front().id);
+        _summaries.erase(_summaries.begin());
+    }
+
+    JsonDocument doc;
+    doc["device"] = DEVICE_NAME;
+    doc["device_id"] = deviceId();
+    doc["id"] = id;
+    doc["timestamp"] = timestamp;
+    doc["channel"] = channel;
+    char crcHex[9];
+    snprintf(crcHex, sizeof(crcHex), "%08x", crc);
+    doc["crc32"] = crcHex;
+    summary.toJson(doc.as<JsonObject>());
+
+    PendingSummary p;
+    p.id = id;
+    serializeJson(doc, p.json);
+    p.timestamp = timestamp;
+    p.crc = crc;
+    p.channel = channel;
+    _summaries.push_back(p);
+    _stats.summariesPending = _summaries.size();
+}
 
-    Serial.printf("[Uploader] POST failed: %d\n", code);
+void DataUploader::_sendSummaries() {
+    _lastSummaryTry = millis();
+    if (!_transport) return;
+
+    // Oldest first; stop at the first failure and leave the rest for
+    // the next try
+    while (!_summaries.empty()) {
+        const PendingSummary& p = _summaries.front();
+        if (!_transport->sendSummary(p.json, p.timestamp, p.id, p.crc, p.channel)) break;
+        _summaries.erase(_summaries.begin());
+        _stats.summariesSent++;
+    }
+    _stats.summariesPending = _summaries.size();
+
+    if (_summaries.empty()) {
+        _summaryFailures = 0;
+        _summaryInterval = SUMMARY_RETRY_INTERVAL_MS;
+    } else {
+        if (_summaryFailures < 16) _summaryFailures++;
+        _summaryInterval = min((unsigned long)SUMMARY_RETRY_INTERVAL_MS << _summaryFailures,
+                               (unsigned long)SUMMARY_RETRY_MAX_MS);
+    }
+}
+
+bool DataUploader::_attemptUpload(const String& data, const String& timestamp, uint32_t id, uint32_t crc,
+                                  uint8_t channel) {
+    if (!_transport) return false;
+
+    // Cumulative reports: send only lines the receiver hasn't seen. A
+    // slow link takes a delta that saves less.
+    bool useDelta = _transport->supportsDelta();
+    uint32_t baseId;
+    String delta;
+    if (useDelta && _delta.encode(data, channel, baseId, delta, _link.deltaRatioPct())) {
+        DeltaResult r = _transport->sendDelta(delta, timestamp, id, crc, channel, baseId);
+        if (r == DeltaResult::OK) {
+            _delta.recordSaving(data.length(), delta.length());
+            _delta.commit(data, channel, id);
+            return true;
+        }
+        if (r == DeltaResult::FAILED) return false;
+        if (r == DeltaResult::NEED_FULL) {
+            Log.warn(LogModule::UPLOADER, "Receiver can't apply delta on #%u, sending full", baseId);
+            _delta.forget(data, channel);
+        }
+    }
+
+    if (_transport->send(data, timestamp, id, crc, channel)) {
+        if (useDelta) _delta.commit(data, channel, id);
+        return true;
+    }
     return false;
 }
 
-void DataUploader::_saveToDisk(const String& data, uint32_t id, const String& timestamp) {
+bool DataUploader::_attemptFileUpload(const String& path, size_t length, const String& timestamp,
+                                      uint32_t id, uint32_t crc, uint8_t channel) {
+    if (!_transport) return false;
+
+    // No delta: the encoder needs the whole dump in RAM
+    File f = LittleFS.open(path, "r");
+    if (!f) {
+        Log.warn(LogModule::UPLOADER, "Can't open %s", path.c_str());
+        return false;
+    }
+    bool ok = _transport->sendFile(f, length, timestamp, id, crc, channel);
+    f.close();
+    return ok;
+}
+
+void DataUploader::_queueDump(const String& data, uint32_t id, const String& timestamp, uint32_t crc,
+                              uint8_t channel) {
+    RamEntry e;
+    e.id = id;
+    e.data = data;
+    e.timestamp = timestamp;
+    e.crc = crc;
+    e.channel = channel;
+    e.queuedAt = millis();
+
+    // Copy failed (out of heap) — straight to flash
+    if (e.data.length() != data.length()) {
+        _saveToDisk(data, id, timestamp, crc, channel);
+        _updateDepth();
+        return;
+    }
+
+    _ramBytes += e.data.length();
+    _ram.push_back(e);
+    _flushRam(false);   // Enforce the count/size/heap limits
+    _updateDepth();
+}
+
+void DataUploader::_flushRam(bool all) {
+    while (!_ram.empty()) {
+        const RamEntry& e = _ram.front();
+        bool due = all
+            || millis() - e.queuedAt >= RAM_QUEUE_DWELL_MS
+            || _ram.size() > RAM_QUEUE_MAX_DUMPS
+            || _ramBytes > RAM_QUEUE_MAX_BYTES
+            || esp_get_free_heap_size() < RAM_QUEUE_MIN_FREE_HEAP;
+        if (!due) break;
+
+        Log.info(LogModule::UPLOADER, "Dump #%u: moving from RAM to flash queue", e.id);
+        _saveToDisk(e.data, e.id, e.timestamp, e.crc, e.channel);
+        _ramBytes -= e.data.length();
+        _ram.erase(_ram.begin());
+        _updateDepth();
+    }
+}
+
+bool DataUploader::_retryRam() {
+    if (_stats.receiverUrl.length() == 0 || _ram.empty()) return false;
+
+    const RamEntry& e = _ram.front();
+    if (!_attemptUpload(e.data, e.timestamp, e.id, e.crc, e.channel)) return false;
+
+    Log.info(LogModule::UPLOADER, "Retry #%u succeeded from RAM", e.id);
+    _ramBytes -= e.data.length();
+    _ram.erase(_ram.begin());
+    _countUpload(true);
+    _stats.flashWritesAvoided++;
+    return true;
+}
+
+void DataUploader::_updateDepth() {
+    _stats.ramQueued = _ram.size();
+    _stats.queueDepth = _countQueue() + _ram.size();
+}
+
+void DataUploader::_onShutdown() {
+    if (s_shutdownUploader) {
+        s_shutdownUploader->_flushRam(true);
+    }
+}
+
+void DataUploader::_saveToDisk(const String& data, uint32_t id, const String& timestamp, uint32_t crc,
+                              uint8_t channel) {
     if (_countQueue() >= MAX_QUEUED_DUMPS) {
-        Serial.println("[Uploader] Queue full, dropping dump");
+        Log.warn(LogModule::UPLOADER, "Queue full, dropping dump");
         return;
     }
 
-    String path = String(QUEUE_DIR) + "/" + String(id) + ".tsv";
-    File f = LittleFS.open(path, "w");
-    if (!f) {
-        Serial.printf("[Uploader] Failed to write %s\n", path.c_str());
+    String path = _queuePath(id);
+    if (!writeQueueRecord(path, data, id, timestamp, crc, channel)) {
+        Log.warn(LogModule::UPLOADER, "Failed to write %s", path.c_str());
         return;
     }
 
-    // Metadata header line — stripped before retry upload
-    f.printf("# id=%u ts=%s sz=%u\n", id, timestamp.c_str(), data.length());
-    f.print(data);
-    f.close();
+    Log.info(LogModule::UPLOADER, "Saved to %s", path.c_str());
+}
 
-    Serial.printf("[Uploader] Saved to %s\n", path.c_str());
+void DataUploader::_saveFileToDisk(const String& src, size_t length, uint32_t id,
+                                   const String& timestamp, uint32_t crc, uint8_t channel) {
+    if (_countQueue() >= MAX_QUEUED_DUMPS) {
+        Log.warn(LogModule::UPLOADER, "Queue full, dropping dump");
+        return;
+    }
+
+    String path = _queuePath(id);
+    File in = LittleFS.open(src, "r");
+    File out = LittleFS.open(path, "w");
+    bool ok = in && out;
+    if (ok) {
+        out.printf("# id=%u ts=%s sz=%u crc=%08x ch=%u\n", id, timestamp.c_str(), length, crc, channel);
+        uint8_t chunk[STREAM_CHUNK];
+        size_t left = length;
+        while (ok && left > 0) {
+            size_t n = in.read(chunk, min(left, sizeof(chunk)));
+            ok = n > 0 && out.write(chunk, n) == n;
+            left -= n;
+        }
+    }
+    in.close();
+    out.close();
+
+    if (!ok) {
+        // A partial record would only fail its CRC later
+        LittleFS.remove(path);
+        Log.warn(LogModule::UPLOADER, "Failed to write %s (flash full?)", path.c_str());
+        return;
+    }
+    Log.info(LogModule::UPLOADER, "Saved to %s", path.c_str());
 }
 
 bool DataUploader::_retryOldest() {
@@ -218,34 +651,115 @@ bool DataUploader::_retryOldest() {
         path = String(QUEUE_DIR) + "/" + path;
     }
 
-    File f = LittleFS.open(path, "r");
-    if (!f) return false;
-
-    // First line is metadata comment — parse timestamp from it
-    String metaLine = f.readStringUntil('\n');
-    String data = f.readString();
-    f.close();
+    // Spilled dumps are checked and sent from flash, never read whole
+    File probe = LittleFS.open(path, "r");
+    size_t size = probe ? probe.size() : 0;
+    probe.close();
+    if (size > SPILL_RAM_WATERMARK) {
+        return _retryFromFile(path, lowestId);
+    }
 
-    // Parse timestamp from "# id=N ts=YYYY-MM-DDTHH:MM:SS sz=NNNNN"
-    String timestamp = "retried";
-    int tsIdx = metaLine.indexOf("ts=");
-    if (tsIdx >= 0) {
-        int spaceIdx = metaLine.indexOf(' ', tsIdx + 3);
-        timestamp = (spaceIdx >= 0)
-            ? metaLine.substring(tsIdx + 3, spaceIdx)
-            : metaLine.substring(tsIdx + 3);
+    String data;
+    String timestamp;
+    uint32_t stored;
+    uint8_t channel;
+    if (!readQueueRecord(path, data, timestamp, stored, channel)) return false;
+
+    // Verify against the capture-time CRC
+    uint32_t crc = crc32Of(data);
+    if (stored != crc) {
+        _quarantine(path, lowestId, stored, crc);
+        return _retryOldest();
     }
 
-    if (_attemptUpload(data, timestamp, lowestId)) {
+    if (_attemptUpload(data, timestamp, lowestId, crc, channel)) {
         LittleFS.remove(path);
-        _stats.totalSuccess++;
-        Serial.printf("[Uploader] Retry #%u succeeded, removed from queue\n", lowestId);
+        _countUpload(true);
+        Log.info(LogModule::UPLOADER, "Retry #%u succeeded, removed from queue", lowestId);
         return true;
     }
 
     return false;
 }
 
+bool DataUploader::_retryFromFile(const String& path, uint32_t id) {
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+
+    String metaLine = f.readStringUntil('\n');
+    size_t start = f.position();
+    size_t length = f.size() - start;
+    String timestamp;
+    uint32_t stored;
+    bool hasCrc;
+    uint8_t channel;
+    parseQueueMeta(metaLine, timestamp, stored, hasCrc, channel);
+
+    // CRC pass over the record, then the upload reads it again
+    uint32_t crc = CRC32_INIT;
+    uint8_t chunk[STREAM_CHUNK];
+    size_t n;
+    while ((n = f.read(chunk, sizeof(chunk))) > 0) {
+        crc = crc32Update(crc, chunk, n);
+    }
+    crc = crc32Final(crc);
+    if (hasCrc && stored != crc) {
+        f.close();
+        _quarantine(path, id, stored, crc);
+        return _retryOldest();
+    }
+
+    f.seek(start);
+    bool ok = _transport && _transport->sendFile(f, length, timestamp, id, crc, channel);
+    f.close();
+    if (!ok) return false;
+
+    LittleFS.remove(path);
+    _countUpload(true);
+    Log.info(LogModule::UPLOADER, "Retry #%u succeeded (%u bytes from flash), removed from queue",
+             id, length);
+    return true;
+}
+
+void DataUploader::_quarantine(const String& path, uint32_t id, uint32_t stored, uint32_t crc) {
+    // Keep the file for inspection but take it out of the queue
+    String bad = path.substring(0, path.length() - 4) + ".bad";
+    LittleFS.rename(path, bad);
+    _stats.corruptQueued++;
+    _updateDepth();
+    Log.warn(LogModule::UPLOADER, "Queued #%u failed CRC (stored %08x, read %08x), moved to %s",
+             id, stored, crc, bad.c_str());
+}
+
+String DataUploader::_queuePath(uint32_t id) {
+    return String(QUEUE_DIR) + "/" + String(id) + ".tsv";
+}
+
+bool DataUploader::_readQueuedMeta(const String& path, uint32_t id, QueuedDump& out) {
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+
+    String metaLine = f.readStringUntil('\n');
+    bool hasCrc;
+    parseQueueMeta(metaLine, out.timestamp, out.crc, hasCrc, out.channel);
+    out.id = id;
+    out.size = f.size() - f.position();
+    out.inRam = false;
+
+    // Older records have no CRC; the receiver still wants one
+    if (!hasCrc) {
+        uint32_t crc = CRC32_INIT;
+        uint8_t chunk[STREAM_CHUNK];
+        size_t n;
+        while ((n = f.read(chunk, sizeof(chunk))) > 0) {
+            crc = crc32Update(crc, chunk, n);
+        }
+        out.crc = crc32Final(crc);
+    }
+    f.close();
+    return true;
+}
+
 uint32_t DataUploader::_countQueue() {
     File dir = LittleFS.open(QUEUE_DIR);
     if (!dir || !dir.isDirectory()) return 0;
@@ -260,19 +774,3 @@ uint32_t DataUploader::_countQueue() {
     dir.close();
     return count;
 }
-
-String DataUploader::_extractPreview(const String& data) {
-    String preview;
-    int pos = 0;
-    for (int i = 0; i < DUMP_PREVIEW_LINES; i++) {
-        int nl = data.indexOf('\n', pos);
-        if (nl < 0) {
-            preview += data.substring(pos);
-            break;
-        }
-        if (i > 0) preview += '\n';
-        preview += data.substring(pos, nl);
-        pos = nl + 1;
-    }
-    return preview;
-}
@@ -2,15 +2,29 @@
 #define DATA_UPLOADER_H
 
 #include <Arduino.h>
-#include <Preferences.h>
 #include <functional>
+#include <memory>
+#include <vector>
+#include "upload_transport.h"
+#include "delta_encoder.h"
+#include "dump_summary.h"
+#include "link_quality.h"
 
 struct UploadStats {
-    uint32_t totalSuccess = 0;
+    uint32_t totalSuccess = 0;   // Lifetime, kept across reboots
     uint32_t totalFailed = 0;
-    uint32_t queueDepth = 0;
+    uint32_t queueDepth = 0;     // RAM and flash
+    uint32_t ramQueued = 0;      // Of queueDepth, dumps still in RAM
+    uint32_t flashWritesAvoided = 0;  // Delivered from RAM, never written
+    uint32_t corruptQueued = 0;  // Queue records that failed CRC on read-back
+    uint32_t summariesSent = 0;
+    uint32_t summariesPending = 0;
+    uint32_t deferred = 0;       // Held back by a weak link (UPLOAD_DEFER_RSSI)
+    uint32_t pulled = 0;         // Collected by a receiver through /api/dumps
+    unsigned long lastPullAt = 0;  // millis() of the last /api/dumps listing
     String lastUploadTime;
     String receiverUrl;
+    String transport;
 };
 
 struct DumpRecord {
@@ -18,10 +32,24 @@ struct DumpRecord {
     String timestamp;
     String preview;
     size_t size = 0;
+    uint32_t crc = 0;
+    uint8_t channel = 1;
+    DumpSummary summary;
     bool uploaded = false;
 };
 
+// A dump waiting in the queue, as the pull feed lists it
+struct QueuedDump {
+    uint32_t id = 0;
+    String timestamp;
+    size_t size = 0;
+    uint32_t crc = 0;
+    uint8_t channel = 1;
+    bool inRam = false;
+};
+
 using ConnectivityCheck = std::function<bool()>;
+using StatusProvider = std::function<String()>;
 
 class DataUploader {
 public:
@@ -33,35 +61,124 @@ public:
     // Call from loop() — drives retry logic
     void update();
 
-    // Called from onDumpReceived — tries upload, queues on failure
-    void submitDump(const String& data, size_t length, const String& timestamp);
+    // Called from onDumpReceived — sends the summary, then tries the
+    // upload and queues on failure. crc is the CRC-32 computed during
+    // capture; channel is the capture channel, carried through the queue
+    // to the receiver.
+    void submitDump(const String& data, size_t length, const String& timestamp, uint32_t crc,
+                    uint8_t channel, const DumpSummary& summary);
+
+    // As submitDump(), for a dump that spilled to flash (DumpMeta::spillPath).
+    // It is uploaded, or copied into the queue, STREAM_CHUNK at a time;
+    // the file itself is left for the caller to remove.
+    void submitFile(const String& path, size_t length, const String& timestamp, uint32_t crc,
+                    uint8_t channel, const DumpSummary& summary);
+
+    // Commit RAM-queued dumps to flash now. Runs as an ESP-IDF shutdown
+    // handler, so esp_restart() doesn't lose them.
+    void flushToDisk();
 
     // Set a function that returns true when WiFi is connected
     void setConnectivityCheck(ConnectivityCheck check);
 
+    // Set a function that builds the status JSON (published by transports
+    // that support it, e.g. MQTT retained status)
+    void setStatusProvider(StatusProvider provider);
+
     // Receiver URL management (persisted to NVS)
+    // The scheme picks the transport: http:// or mqtt://
     void setReceiverUrl(const String& url);
     String getReceiverUrl() const;
 
+    // Pull feed (/api/dumps): a receiver run with --pull lists the queue,
+    // fetches each dump and acks it. Works alongside push; with no
+    // receiver URL set it is the only way dumps leave the device.
+    // Queued dumps with id > after, oldest first, at most limit
+    std::vector<QueuedDump> listQueued(uint32_t after, size_t limit);
+    bool findQueued(uint32_t id, QueuedDump& out);
+    // Copy a queued dump's bytes to out
+    bool writeQueued(uint32_t id, Print& out);
+    // The receiver stored it: drop it from the queue
+    bool ackQueued(uint32_t id);
+    // The receiver got a CRC mismatch: quarantine the flash copy if it
+    // is the one that's corrupt
+    void rejectQueued(uint32_t id);
+
     // Status accessors for dashboard
     const UploadStats& getStats() const;
     const DumpRecord& getLastDump() const;
+    const DeltaEncoder& getDelta() const;
+    const LinkQuality& getLink() const;
 
 private:
+    // Summary waiting for delivery; kept in RAM only — the dump itself is
+    // on the persistent queue, and carries the same numbers
+    struct PendingSummary {
+        uint32_t id;
+        String json;
+        String timestamp;
+        uint32_t crc;
+        uint8_t channel;
+    };
+
+    // Failed dump waiting in the RAM tier
+    struct RamEntry {
+        uint32_t id;
+        String data;
+        String timestamp;
+        uint32_t crc;
+        uint8_t channel;
+        unsigned long queuedAt;
+    };
+
     UploadStats _stats;
     DumpRecord _lastDump;
-    Preferences _prefs;
-    uint32_t _nextFileId;
     unsigned long _lastRetryTime;
     unsigned long _retryInterval;
     uint8_t _consecutiveFailures;
+    unsigned long _lastStatusPublish;
+    unsigned long _lastSummaryTry;
+    unsigned long _summaryInterval;
+    uint8_t _summaryFailures;
     ConnectivityCheck _isConnected;
+    StatusProvider _statusProvider;
+    std::unique_ptr<UploadTransport> _transport;
+    DeltaEncoder _delta;
+    LinkQuality _link;
+    std::vector<PendingSummary> _summaries;
+    std::vector<RamEntry> _ram;    // Oldest first
+    size_t _ramBytes;
 
-    bool _attemptUpload(const String& data, const String& timestamp, uint32_t id);
-    void _saveToDisk(const String& data, uint32_t id, const String& timestamp);
+    void _createTransport();
+    uint32_t _beginDump(size_t length, const String& timestamp, uint32_t crc, uint8_t channel,
+                        const DumpSummary& summary);
+    bool _uploadNow(uint32_t id, size_t length, const String& timestamp,
+                    std::function<bool()> attempt);
+    void _countUpload(bool ok);
+    void _queueSummary(const DumpSummary& summary, uint32_t id, const String& timestamp,
+                       uint32_t crc, uint8_t channel);
+    void _sendSummaries();
+    bool _attemptUpload(const String& data, const String& timestamp, uint32_t id, uint32_t crc,
+                        uint8_t channel);
+    bool _attemptFileUpload(const String& path, size_t length, const String& timestamp,
+                            uint32_t id, uint32_t crc, uint8_t channel);
+    void _queueDump(const String& data, uint32_t id, const String& timestamp, uint32_t crc,
+                    uint8_t channel);
+    void _flushRam(bool all);
+    bool _retryRam();
+    void _updateDepth();
+    static void _onShutdown();
+    void _saveToDisk(const String& data, uint32_t id, const String& timestamp, uint32_t crc,
+                     uint8_t channel);
+    void _saveFileToDisk(const String& src, size_t length, uint32_t id, const String& timestamp,
+                         uint32_t crc, uint8_t channel);
     bool _retryOldest();
+    bool _retryFromFile(const String& path, uint32_t id);
+    void _quarantine(const String& path, uint32_t id, uint32_t stored, uint32_t crc);
+    static String _queuePath(uint32_t id);
+    static bool _readQueuedMeta(const String& path, uint32_t id, QueuedDump& out);
+
     uint32_t _countQueue();
-    String _extractPreview(const String& data);
 };
 
 #endif // DATA_UPLOADER_H
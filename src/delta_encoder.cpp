@@ -0,0 +1,216 @@
+#include "delta_encoder.h"
+#include "config.h"
+#include "crc32.h"
+#include <LittleFS.h>
+#include <unordered_map>
+
+static const uint32_t FINGERPRINT_MAGIC = 0x31444D42;  // "BMD1"
+
+DeltaEncoder::DeltaEncoder()
+    : _bytesSaved(0)
+    , _deltaCount(0) {
+}
+
+void DeltaEncoder::begin() {
+    if (!LittleFS.exists(DELTA_DIR)) {
+        LittleFS.mkdir(DELTA_DIR);
+    }
+}
+
+bool DeltaEncoder::encode(const String& data, uint8_t channel, uint32_t& baseId, String& delta,
+                          uint8_t maxRatioPct) {
+    uint32_t type = _reportType(data, channel);
+    if (type == 0) return false;
+
+    std::vector<uint32_t> base;
+    if (!_loadBase(type, baseId, base)) return false;
+
+    std::vector<uint32_t> lines;
+    _hashLines(data, lines);
+    if (lines.size() < DELTA_MIN_LINES) return false;
+
+    // First occurrence of each base line
+    std::unordered_map<uint32_t, uint32_t> index;
+    index.reserve(base.size());
+    for (uint32_t i = 0; i < base.size(); i++) {
+        index.insert(std::make_pair(base[i], i));
+    }
+
+    delta = "";
+    delta.reserve(data.length() / 4);
+    delta += "#delta base=" + String(baseId) + " lines=" + String((uint32_t)lines.size()) + "\n";
+
+    uint32_t runStart = 0;
+    uint32_t runLen = 0;
+    int pos = 0;
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        int nl = data.indexOf('\n', pos);
+        int end = (nl >= 0) ? nl : data.length();
+
+        // Extend the current copy run if the next base line matches
+        if (runLen > 0 && runStart + runLen < base.size() && base[runStart + runLen] == lines[i]) {
+            runLen++;
+        } else {
+            if (runLen > 0) {
+                delta += "=" + String(runStart) + "," + String(runLen) + "\n";
+                runLen = 0;
+            }
+            auto it = index.find(lines[i]);
+            if (it != index.end()) {
+                runStart = it->second;
+                runLen = 1;
+            } else {
+                delta += '+';
+                delta.concat(data.c_str() + pos, end - pos);
+                delta += '\n';
+            }
+        }
+
+        pos = end + 1;
+        // Stop early once the delta is clearly not going to pay off
+        if (delta.length() > data.length() * maxRatioPct / 100) return false;
+    }
+    if (runLen > 0) {
+        delta += "=" + String(runStart) + "," + String(runLen) + "\n";
+    }
+
+    return delta.length() <= data.length() * maxRatioPct / 100;
+}
+
+void DeltaEncoder::commit(const String& data, uint8_t channel, uint32_t id) {
+    uint32_t type = _reportType(data, channel);
+    if (type == 0) return;
+
+    // A queued older dump finishing late must not replace a newer base
+    uint32_t currentId;
+    std::vector<uint32_t> current;
+    bool exists = _loadBase(type, currentId, current);
+    if (exists && currentId > id) return;
+
+    std::vector<uint32_t> lines;
+    _hashLines(data, lines);
+    if (lines.size() < DELTA_MIN_LINES) return;
+
+    if (!exists) _pruneBases();
+
+    File f = LittleFS.open(_path(type), "w");
+    if (!f) return;
+    uint32_t header[3] = { FINGERPRINT_MAGIC, id, (uint32_t)lines.size() };
+    f.write((const uint8_t*)header, sizeof(header));
+    f.write((const uint8_t*)lines.data(), lines.size() * sizeof(uint32_t));
+    f.close();
+}
+
+void DeltaEncoder::forget(const String& data, uint8_t channel) {
+    uint32_t type = _reportType(data, channel);
+    if (type != 0) {
+        LittleFS.remove(_path(type));
+    }
+}
+
+uint32_t DeltaEncoder::getBytesSaved() const {
+    return _bytesSaved;
+}
+
+uint32_t DeltaEncoder::getDeltaCount() const {
+    return _deltaCount;
+}
+
+void DeltaEncoder::recordSaving(size_t fullSize, size_t deltaSize) {
+    _deltaCount++;
+    if (fullSize > deltaSize) {
+        _bytesSaved += fullSize - deltaSize;
+    }
+}
+
+uint32_t DeltaEncoder::_reportType(const String& data, uint8_t channel) {
+    // The column header ("ID\tGross\tTare...") is the first tab-separated
+    // line; banner lines above it carry dates and change every print.
+    int pos = 0;
+    for (int i = 0; i < 20 && pos < (int)data.length(); i++) {
+        int nl = data.indexOf('\n', pos);
+        int end = (nl >= 0) ? nl : data.length();
+        int tab = data.indexOf('\t', pos);
+        if (tab >= 0 && tab < end) {
+            uint32_t crc = crc32Update(CRC32_INIT, (const uint8_t*)data.c_str() + pos, end - pos);
+            // Channel 1 hashes the header alone, so bases saved before
+            // multi-channel capture stay valid
+            if (channel > 1) crc = crc32Update(crc, channel);
+            uint32_t type = crc32Final(crc);
+            return type != 0 ? type : 1;
+        }
+        if (nl < 0) break;
+        pos = nl + 1;
+    }
+    return 0;
+}
+
+void DeltaEncoder::_hashLines(const String& data, std::vector<uint32_t>& hashes) {
+    hashes.clear();
+    const uint8_t* p = (const uint8_t*)data.c_str();
+    size_t len = data.length();
+    size_t start = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i == len || p[i] == '\n') {
+            hashes.push_back(crc32Of(p + start, i - start));
+            start = i + 1;
+        }
+    }
+}
+
+String DeltaEncoder::_path(uint32_t type) {
+    char name[24];
+    snprintf(name, sizeof(name), "/%08x.fp", type);
+    return String(DELTA_DIR) + name;
+}
+
+bool DeltaEncoder::_loadBase(uint32_t type, uint32_t& baseId, std::vector<uint32_t>& hashes) {
+    File f = LittleFS.open(_path(type), "r");
+    if (!f) return false;
+
+    uint32_t header[3];
+    bool ok = f.read((uint8_t*)header, sizeof(header)) == sizeof(header)
+           && header[0] == FINGERPRINT_MAGIC
+           && header[2] <= DUMP_BUFFER_SIZE;
+    if (ok) {
+        baseId = header[1];
+        hashes.resize(header[2]);
+        size_t bytes = header[2] * sizeof(uint32_t);
+        ok = f.read((uint8_t*)hashes.data(), bytes) == bytes;
+    }
+    f.close();
+    return ok;
+}
+
+void DeltaEncoder::_pruneBases() {
+    // Keep at most DELTA_MAX_TYPES fingerprints; evict the oldest base
+    File dir = LittleFS.open(DELTA_DIR);
+    if (!dir || !dir.isDirectory()) return;
+
+    uint32_t count = 0;
+    uint32_t oldestId = UINT32_MAX;
+    String oldestName;
+
+    File entry = dir.openNextFile();
+    while (entry) {
+        String name = String(entry.name());
+        if (name.endsWith(".fp")) {
+            count++;
+            uint32_t header[3];
+            if (entry.read((uint8_t*)header, sizeof(header)) == sizeof(header)
+                && header[1] < oldestId) {
+                oldestId = header[1];
+                oldestName = name;
+            }
+        }
+        entry = dir.openNextFile();
+    }
+    dir.close();
+
+    if (count >= DELTA_MAX_TYPES && oldestName.length() > 0) {
+        int lastSlash = oldestName.lastIndexOf('/');
+        String file = (lastSlash >= 0) ? oldestName.substring(lastSlash + 1) : oldestName;
+        LittleFS.remove(String(DELTA_DIR) + "/" + file);
+    }
+}
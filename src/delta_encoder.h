@@ -0,0 +1,63 @@
+#ifndef DELTA_ENCODER_H
+#define DELTA_ENCODER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+
+// Line-level delta encoding for cumulative 920i reports, which re-print
+// the whole accumulated table every time.
+//
+// For each report type (identified by its column header line and the
+// capture channel, so two scales printing the same report don't keep
+// replacing each other's base) we keep a
+// fingerprint of the last dump the receiver confirmed: one CRC-32 per
+// line, stored in DELTA_DIR. A new dump of the same type is then encoded
+// against it as a list of operations, one per line:
+//
+//   #delta base=<id> lines=<n>
+//   =<start>,<count>      copy <count> lines from the base, starting at <start>
+//   +<text>               literal line
+//
+// Lines are split on '\n' only, so a CR stays part of the line and the
+// receiver reproduces the dump byte for byte. The full-dump CRC is still
+// sent, which also catches the rare line-hash collision.
+class DeltaEncoder {
+public:
+    DeltaEncoder();
+
+    // Create the fingerprint directory (LittleFS must be mounted)
+    void begin();
+
+    // Encode data against the stored base for its report type. Returns
+    // false when there is no base or the delta would be over maxRatioPct
+    // of the dump; the dump should then be sent in full.
+    bool encode(const String& data, uint8_t channel, uint32_t& baseId, String& delta,
+                uint8_t maxRatioPct = DELTA_MAX_RATIO_PCT);
+
+    // Record data (dump id) as delivered — it becomes the new base for its
+    // report type unless a newer base is already stored.
+    void commit(const String& data, uint8_t channel, uint32_t id);
+
+    // Drop the base for data's report type (receiver no longer has it)
+    void forget(const String& data, uint8_t channel);
+
+    // Bytes saved by delta uploads this session
+    uint32_t getBytesSaved() const;
+    uint32_t getDeltaCount() const;
+
+    // Called after a successful delta upload of a dump of fullSize bytes
+    void recordSaving(size_t fullSize, size_t deltaSize);
+
+private:
+    uint32_t _bytesSaved;
+    uint32_t _deltaCount;
+
+    static uint32_t _reportType(const String& data, uint8_t channel);
+    static void _hashLines(const String& data, std::vector<uint32_t>& hashes);
+    static String _path(uint32_t type);
+    bool _loadBase(uint32_t type, uint32_t& baseId, std::vector<uint32_t>& hashes);
+    void _pruneBases();
+};
+
+#endif // DELTA_ENCODER_H
@@ -0,0 +1,14 @@
+#include "device_id.h"
+#include "config.h"
+#include <esp_system.h>
+
+const char* deviceId() {
+    // The station MAC is the factory base MAC, readable before WiFi starts
+    static char id[32] = "";
+    if (id[0] == '\0') {
+        uint8_t mac[6];
+        esp_efuse_mac_get_default(mac);
+        snprintf(id, sizeof(id), "%s-%02x%02x%02x", DEVICE_HOSTNAME, mac[3], mac[4], mac[5]);
+    }
+    return id;
+}
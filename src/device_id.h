@@ -0,0 +1,11 @@
+#ifndef DEVICE_ID_H
+#define DEVICE_ID_H
+
+#include <Arduino.h>
+
+// Name unique to this unit: DEVICE_HOSTNAME and the last three bytes of
+// the factory MAC, e.g. "brakemachine-a1b2c3". DEVICE_NAME is the same
+// on every unit; the receiver keys its per-device state on this.
+const char* deviceId();
+
+#endif // DEVICE_ID_H
@@ -0,0 +1,216 @@
+#include "dump_filter.h"
+#include "persistent_state.h"
+
+// Field order of a 920i print with no header line
+static const char* const DEFAULT_COLUMNS[] = { "ID", "Gross", "Tare", "Net", "Unit" };
+
+// "a; b;;c" -> {"a", "b", "c"}
+static std::vector<String> splitList(const String& s, char sep) {
+    std::vector<String> out;
+    int pos = 0;
+    while (pos <= (int)s.length()) {
+        int next = s.indexOf(sep, pos);
+        if (next < 0) next = s.length();
+        String item = s.substring(pos, next);
+        item.trim();
+        if (item.length() > 0) out.push_back(item);
+        pos = next + 1;
+    }
+    return out;
+}
+
+static bool isNumber(const String& s) {
+    for (size_t i = 0; i < s.length(); i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+    }
+    return s.length() > 0;
+}
+
+// Field equals name, ignoring case and surrounding spaces
+static bool fieldIs(const char* f, size_t len, const String& name) {
+    while (len > 0 && *f == ' ') {
+        f++;
+        len--;
+    }
+    while (len > 0 && f[len - 1] == ' ') len--;
+    return len == name.length() && strncasecmp(f, name.c_str(), len) == 0;
+}
+
+bool FilterRules::active() const {
+    return drop.length() > 0 || blank || columns.length() > 0;
+}
+
+void FilterRules::load() {
+    drop = State.getString("filter", "drop");
+    blank = State.getBool("filter", "blank");
+    columns = State.getString("filter", "cols");
+    raw = State.getBool("filter", "raw");
+}
+
+void FilterRules::save() const {
+    State.setString("filter", "drop", drop);
+    State.setBool("filter", "blank", blank);
+    State.setString("filter", "cols", columns);
+    State.setBool("filter", "raw", raw);
+    State.commit();
+}
+
+bool FilterRules::validate(const String& drop, const String& columns, String& error) {
+    if (splitList(drop, ';').size() > FILTER_MAX_PATTERNS) {
+        error = "At most " + String(FILTER_MAX_PATTERNS) + " drop patterns";
+        return false;
+    }
+
+    std::vector<String> cols = splitList(columns, ',');
+    if (cols.size() > FILTER_MAX_COLUMNS) {
+        error = "At most " + String(FILTER_MAX_COLUMNS) + " columns";
+        return false;
+    }
+    for (size_t i = 0; i < cols.size(); i++) {
+        if (isNumber(cols[i]) && (cols[i].toInt() < 1 || cols[i].toInt() > FILTER_MAX_FIELDS)) {
+            error = "Column numbers run 1-" + String(FILTER_MAX_FIELDS);
+            return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (cols[i].equalsIgnoreCase(cols[j])) {
+                error = "Column " + cols[i] + " listed twice";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+DumpFilter::DumpFilter()
+    : _blank(false)
+    , _colCount(0)
+    , _headerSeen(false)
+    , _dropped(0) {
+}
+
+void DumpFilter::begin(const FilterRules& rules) {
+    _patterns = splitList(rules.drop, ';');
+    _blank = rules.blank;
+    _names = splitList(rules.columns, ',');
+    _colCount = min(_names.size(), (size_t)FILTER_MAX_COLUMNS);
+    _dropped = 0;
+
+    // Numbers are final; names start at their default position
+    _headerSeen = true;
+    for (uint8_t i = 0; i < _colCount; i++) {
+        _cols[i] = -1;
+        if (isNumber(_names[i])) {
+            _cols[i] = _names[i].toInt() - 1;
+            continue;
+        }
+        _headerSeen = false;
+        for (size_t d = 0; d < sizeof(DEFAULT_COLUMNS) / sizeof(DEFAULT_COLUMNS[0]); d++) {
+            if (_names[i].equalsIgnoreCase(DEFAULT_COLUMNS[d])) _cols[i] = d;
+        }
+    }
+}
+
+bool DumpFilter::active() const {
+    return !_patterns.empty() || _blank || _colCount > 0;
+}
+
+bool DumpFilter::drops(const char* line, size_t len) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+
+    bool drop = (len == 0) && _blank;
+    for (size_t i = 0; !drop && i < _patterns.size(); i++) {
+        drop = _glob(_patterns[i].c_str(), line, line + len);
+    }
+    if (drop) _dropped++;
+    return drop;
+}
+
+size_t DumpFilter::project(const char* line, size_t len, char* out) {
+    size_t body = len;
+    while (body > 0 && (line[body - 1] == '\n' || line[body - 1] == '\r')) body--;
+
+    // Banners and other untabbed lines pass through whole
+    if (_colCount == 0 || body > FILTER_MAX_LINE || !memchr(line, '\t', body)) {
+        memmove(out, line, len);
+        return len;
+    }
+
+    const char* fields[FILTER_MAX_FIELDS];
+    size_t lens[FILTER_MAX_FIELDS];
+    int count = 0;
+    const char* p = line;
+    const char* end = line + body;
+    while (count < FILTER_MAX_FIELDS) {
+        const char* tab = (const char*)memchr(p, '\t', end - p);
+        fields[count] = p;
+        lens[count] = (tab ? tab : end) - p;
+        count++;
+        if (!tab) break;
+        p = tab + 1;
+    }
+    if (!_headerSeen) _resolve(fields, lens, count);
+
+    // Missing fields stay empty, so the columns line up
+    char tmp[FILTER_MAX_LINE];
+    size_t n = 0;
+    for (uint8_t i = 0; i < _colCount; i++) {
+        size_t add = (i > 0 ? 1 : 0) + ((_cols[i] >= 0 && _cols[i] < count) ? lens[_cols[i]] : 0);
+        if (n + add > body) {
+            // Projection would grow the line (e.g. padding a short one)
+            memmove(out, line, len);
+            return len;
+        }
+        if (i > 0) tmp[n++] = '\t';
+        if (_cols[i] >= 0 && _cols[i] < count) {
+            memcpy(tmp + n, fields[_cols[i]], lens[_cols[i]]);
+            n += lens[_cols[i]];
+        }
+    }
+
+    // n <= body, so neither copy overwrites bytes it still has to read
+    memmove(out, tmp, n);
+    memmove(out + n, line + body, len - body);
+    return n + len - body;
+}
+
+uint32_t DumpFilter::linesDropped() const {
+    return _dropped;
+}
+
+void DumpFilter::_resolve(const char* fields[], const size_t lens[], int count) {
+    // The header is the first line that names every named column
+    int8_t found[FILTER_MAX_COLUMNS];
+    for (uint8_t i = 0; i < _colCount; i++) {
+        found[i] = _cols[i];
+        if (isNumber(_names[i])) continue;
+        found[i] = -1;
+        for (int f = 0; f < count && found[i] < 0; f++) {
+            if (fieldIs(fields[f], lens[f], _names[i])) found[i] = f;
+        }
+        if (found[i] < 0) return;
+    }
+    memcpy(_cols, found, _colCount);
+    _headerSeen = true;
+}
+
+bool DumpFilter::_glob(const char* pat, const char* s, const char* end) {
+    // Iterative match with backtracking to the last '*'
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (s < end) {
+        if (*pat == '?' || (*pat != '\0' && *pat != '*' && *pat == *s)) {
+            pat++;
+            s++;
+        } else if (*pat == '*') {
+            star = pat++;
+            resume = s;
+        } else if (star) {
+            pat = star + 1;
+            s = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == '*') pat++;
+    return *pat == '\0';
+}
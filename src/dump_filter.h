@@ -0,0 +1,68 @@
+#ifndef DUMP_FILTER_H
+#define DUMP_FILTER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+
+// What the capture path strips from a dump before it is queued and
+// uploaded. Stored in NVS ("filter") and shared by all channels.
+//
+//   drop    — glob patterns (* and ?) matched against whole lines without
+//             their CR/LF, separated by ';': "920i Print*;Date:*"
+//   blank   — drop empty lines
+//   columns — tab-separated fields to keep, in order, by header name or
+//             1-based number, separated by ',': "ID,Gross,Net".
+//             Empty keeps every field.
+//   raw     — also keep the unfiltered dump on flash (RAW_DIR) for audit
+struct FilterRules {
+    String drop;
+    bool blank = false;
+    String columns;
+    bool raw = false;
+
+    // Anything to strip at all
+    bool active() const;
+
+    void load();
+    void save() const;
+
+    // Checks the drop and columns syntax; sets error if invalid
+    static bool validate(const String& drop, const String& columns, String& error);
+};
+
+// Applies FilterRules to one dump a line at a time, as it is captured, so
+// the dump is never rescanned. Named columns are resolved from the dump's
+// header line (the first line that has all of them); until then the
+// 920i's default order ID, Gross, Tare, Net, Unit is assumed.
+class DumpFilter {
+public:
+    DumpFilter();
+
+    // Start a new dump with a snapshot of the rules
+    void begin(const FilterRules& rules);
+    bool active() const;
+
+    // True if the line (with or without its CR/LF) is dropped
+    bool drops(const char* line, size_t len);
+
+    // Write the kept columns of a line, with its CR/LF, to out (room for
+    // len bytes; may overlap line). Returns the bytes written.
+    size_t project(const char* line, size_t len, char* out);
+
+    uint32_t linesDropped() const;
+
+private:
+    std::vector<String> _patterns;
+    bool _blank;
+    std::vector<String> _names;          // Columns as configured
+    int8_t _cols[FILTER_MAX_COLUMNS];    // Field index per kept column, -1 = not found
+    uint8_t _colCount;
+    bool _headerSeen;
+    uint32_t _dropped;
+
+    void _resolve(const char* fields[], const size_t lens[], int count);
+    static bool _glob(const char* pat, const char* s, const char* end);
+};
+
+#endif // DUMP_FILTER_H
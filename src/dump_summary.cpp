@@ -0,0 +1,150 @@
+#include "dump_summary.h"
+
+static const int MAX_FIELDS = 8;
+static const size_t MAX_LINE = 128;   // Records are ~30 bytes; longer lines aren't records
+
+void ColumnStats::add(double v, bool first) {
+    total += v;
+    if (first || v < min) min = v;
+    if (first || v > max) max = v;
+}
+
+// Whole field is a number (strtod alone accepts "12abc")
+static bool parseNumber(const char* s, double& v) {
+    if (*s == '\0') return false;
+    char* end;
+    v = strtod(s, &end);
+    while (*end == ' ') end++;
+    return *end == '\0';
+}
+
+static bool isWholeNumber(const char* s) {
+    while (*s == ' ') s++;
+    if (*s < '0' || *s > '9') return false;
+    while (*s >= '0' && *s <= '9') s++;
+    while (*s == ' ') s++;
+    return *s == '\0';
+}
+
+static void copyField(char* dst, size_t cap, const char* src) {
+    while (*src == ' ') src++;
+    strncpy(dst, src, cap - 1);
+    dst[cap - 1] = '\0';
+}
+
+DumpSummary::DumpSummary() {
+    reset();
+}
+
+void DumpSummary::reset() {
+    records = 0;
+    bytes = 0;
+    gross = ColumnStats();
+    tare = ColumnStats();
+    net = ColumnStats();
+    firstId[0] = '\0';
+    lastId[0] = '\0';
+    unit[0] = '\0';
+    _grossCol = 1;
+    _tareCol = 2;
+    _netCol = 3;
+    _unitCol = 4;
+}
+
+void DumpSummary::addLine(const char* line, size_t len) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+    if (len == 0 || len >= MAX_LINE) return;
+
+    char buf[MAX_LINE];
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+
+    // Split on tabs in place
+    const char* fields[MAX_FIELDS];
+    int count = 0;
+    char* p = buf;
+    while (count < MAX_FIELDS) {
+        fields[count] = p;
+        char* tab = strchr(p, '\t');
+        if (tab) *tab = '\0';
+        count++;
+        if (!tab) break;
+        p = tab + 1;
+    }
+    if (count < 2) return;
+
+    if (!isWholeNumber(fields[0])) {
+        _parseHeader(fields, count);
+        return;
+    }
+
+    double g, t, n;
+    if (_grossCol >= count || _tareCol >= count || _netCol >= count) return;
+    if (!parseNumber(fields[_grossCol], g) || !parseNumber(fields[_tareCol], t)
+        || !parseNumber(fields[_netCol], n)) return;
+
+    bool first = (records == 0);
+    gross.add(g, first);
+    tare.add(t, first);
+    net.add(n, first);
+    if (first) {
+        copyField(firstId, sizeof(firstId), fields[0]);
+        if (_unitCol >= 0 && _unitCol < count) {
+            copyField(unit, sizeof(unit), fields[_unitCol]);
+        }
+    }
+    copyField(lastId, sizeof(lastId), fields[0]);
+    records++;
+}
+
+bool DumpSummary::_parseHeader(const char* fields[], int count) {
+    int8_t g = -1, t = -1, n = -1, u = -1;
+    for (int i = 0; i < count; i++) {
+        const char* f = fields[i];
+        while (*f == ' ') f++;
+        if (strncasecmp(f, "Gross", 5) == 0) g = i;
+        else if (strncasecmp(f, "Tare", 4) == 0) t = i;
+        else if (strncasecmp(f, "Net", 3) == 0) n = i;
+        else if (strncasecmp(f, "Unit", 4) == 0) u = i;
+    }
+    if (g < 0 || t < 0 || n < 0) return false;
+
+    _grossCol = g;
+    _tareCol = t;
+    _netCol = n;
+    _unitCol = u;
+    return true;
+}
+
+DumpSummary DumpSummary::of(const String& data) {
+    DumpSummary s;
+    const char* p = data.c_str();
+    const char* end = p + data.length();
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        const char* lineEnd = nl ? nl : end;
+        s.addLine(p, lineEnd - p);
+        p = lineEnd + 1;
+    }
+    s.bytes = data.length();
+    return s;
+}
+
+void DumpSummary::toJson(JsonObject out) const {
+    out["records"] = records;
+    out["bytes"] = bytes;
+    if (records > 0) {
+        out["first_id"] = firstId;
+        out["last_id"] = lastId;
+        out["unit"] = unit;
+
+        const ColumnStats* cols[] = { &gross, &tare, &net };
+        const char* names[] = { "gross", "tare", "net" };
+        for (int i = 0; i < 3; i++) {
+            JsonObject c = out[names[i]].to<JsonObject>();
+            c["total"] = cols[i]->total;
+            c["min"] = cols[i]->min;
+            c["max"] = cols[i]->max;
+        }
+    }
+}
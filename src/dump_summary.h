@@ -0,0 +1,62 @@
+#ifndef DUMP_SUMMARY_H
+#define DUMP_SUMMARY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Running total / min / max of one weight column
+struct ColumnStats {
+    double total = 0;
+    double min = 0;
+    double max = 0;
+
+    void add(double v, bool first);
+};
+
+// Per-dump statistics, built line by line while the dump is captured so
+// it is ready the moment the dump completes. It is uploaded ahead of the
+// dump itself (see DataUploader) — a few hundred bytes that get through
+// on a weak link long before a 40 KB body does.
+//
+// A record is a tab-separated line whose first field is a whole number
+// (the 920i ID column) followed by numeric Gross, Tare and Net fields.
+// The column order is taken from the header line if one is seen
+// ("ID\tGross\tTare\tNet\tUnit"), otherwise assumed to be that. Banner
+// and footer lines are ignored.
+class DumpSummary {
+public:
+    DumpSummary();
+
+    // Start a new dump
+    void reset();
+
+    // Feed one line (without or with its CR/LF)
+    void addLine(const char* line, size_t len);
+
+    // Summarize a complete dump in one go (test dumps, queue records)
+    static DumpSummary of(const String& data);
+
+    uint32_t records;
+    uint32_t bytes;          // Dump size, set by the capture path
+    ColumnStats gross;
+    ColumnStats tare;
+    ColumnStats net;
+    char firstId[12];
+    char lastId[12];
+    char unit[8];            // Unit of the first record ("lb", "kg")
+
+    // Adds "records", "bytes", "first_id", "last_id", "unit" and
+    // "gross"/"tare"/"net": {"total", "min", "max"} to out
+    void toJson(JsonObject out) const;
+
+private:
+    // Field index of each column; -1 for unit means "not present"
+    int8_t _grossCol;
+    int8_t _tareCol;
+    int8_t _netCol;
+    int8_t _unitCol;
+
+    bool _parseHeader(const char* fields[], int count);
+};
+
+#endif // DUMP_SUMMARY_H
@@ -0,0 +1,308 @@
+#include "http_transport.h"
+#include "config.h"
+#include "logger.h"
+#include "device_id.h"
+
+HttpTransport::HttpTransport(const String& url, LinkQuality& link)
+    : _link(link)
+    , _url(url)
+    , _port(80)
+    , _resolved(false)
+    , _resolvedAt(0)
+    , _lastUse(0)
+    , _sent(0) {
+    _parseUrl(url);
+}
+
+HttpTransport::~HttpTransport() {
+    _client.stop();
+}
+
+void HttpTransport::update() {
+    // Close an idle connection ourselves rather than have the receiver
+    // time it out just as the next upload starts
+    if (_client.connected() && millis() - _lastUse >= HTTP_IDLE_CLOSE_MS) {
+        _client.stop();
+    }
+}
+
+bool HttpTransport::send(const String& data, const String& timestamp, uint32_t id, uint32_t crc,
+                         uint8_t channel) {
+    Log.info(LogModule::UPLOADER, "POST %u bytes to %s", data.length(), _url.c_str());
+
+    Body body = { (const uint8_t*)data.c_str(), nullptr, data.length() };
+    int code = _post(body, "text/tab-separated-values", timestamp, id, crc, channel, 0);
+    if (code >= 200 && code < 300) {
+        return true;
+    }
+
+    Log.warn(LogModule::UPLOADER, "POST failed: %d", code);
+    return false;
+}
+
+bool HttpTransport::sendFile(File& in, size_t length, const String& timestamp, uint32_t id,
+                             uint32_t crc, uint8_t channel) {
+    Log.info(LogModule::UPLOADER, "POST %u bytes from flash to %s", length, _url.c_str());
+
+    Body body = { nullptr, &in, length };
+    int code = _post(body, "text/tab-separated-values", timestamp, id, crc, channel, 0);
+    if (code >= 200 && code < 300) {
+        return true;
+    }
+
+    Log.warn(LogModule::UPLOADER, "POST failed: %d", code);
+    return false;
+}
+
+bool HttpTransport::sendSummary(const String& json, const String& timestamp, uint32_t id, uint32_t crc,
+                                uint8_t channel) {
+    Body body = { (const uint8_t*)json.c_str(), nullptr, json.length() };
+    int code = _post(body, "application/x-brakemachine-summary+json", timestamp, id, crc, channel, 0);
+    if (code >= 200 && code < 300) {
+        Log.info(LogModule::UPLOADER, "Summary #%u delivered", id);
+        return true;
+    }
+
+    // An older receiver.py treats the body as a dump: it fails the CRC
+    // check (400) rather than being stored. Nothing to gain by retrying.
+    if (code == 400 || code == 404 || code == 415) {
+        Log.warn(LogModule::UPLOADER, "Receiver doesn't take summaries (%d), skipping #%u", code, id);
+        return true;
+    }
+
+    Log.warn(LogModule::UPLOADER, "Summary POST failed: %d", code);
+    return false;
+}
+
+DeltaResult HttpTransport::sendDelta(const String& delta, const String& timestamp, uint32_t id,
+                                     uint32_t crc, uint8_t channel, uint32_t baseId) {
+    Log.info(LogModule::UPLOADER, "POST delta %u bytes (base #%u) to %s",
+             delta.length(), baseId, _url.c_str());
+
+    Body body = { (const uint8_t*)delta.c_str(), nullptr, delta.length() };
+    int code = _post(body, "text/x-brakemachine-delta", timestamp, id, crc, channel, baseId);
+    if (code >= 200 && code < 300) {
+        return DeltaResult::OK;
+    }
+
+    Log.warn(LogModule::UPLOADER, "Delta POST failed: %d", code);
+    // 409: receiver lacks the base or the rebuild failed its CRC.
+    // 415: an older receiver.py that doesn't understand deltas.
+    if (code == 409 || code == 415) {
+        return DeltaResult::NEED_FULL;
+    }
+    return DeltaResult::FAILED;
+}
+
+void HttpTransport::_parseUrl(const String& url) {
+    // http://host[:port][/path]
+    String rest = url;
+    int scheme = rest.indexOf("://");
+    if (scheme >= 0) rest = rest.substring(scheme + 3);
+
+    int slash = rest.indexOf('/');
+    _path = (slash >= 0) ? rest.substring(slash) : String("/");
+    if (slash >= 0) rest = rest.substring(0, slash);
+
+    int colon = rest.lastIndexOf(':');
+    if (colon >= 0) {
+        _host = rest.substring(0, colon);
+        _port = rest.substring(colon + 1).toInt();
+        if (_port == 0) _port = 80;
+    } else {
+        _host = rest;
+    }
+}
+
+bool HttpTransport::_connect() {
+    // Cached address; a failed connect drops it in case the receiver moved
+    if (!_resolved || millis() - _resolvedAt >= HTTP_DNS_TTL_MS) {
+        if (!WiFi.hostByName(_host.c_str(), _addr)) {
+            Log.warn(LogModule::UPLOADER, "Can't resolve %s", _host.c_str());
+            _resolved = false;
+            return false;
+        }
+        _resolved = true;
+        _resolvedAt = millis();
+    }
+
+    // Whole seconds; it also bounds each socket write
+    unsigned long timeout = _link.connectTimeout();
+    _client.setTimeout((timeout + 999) / 1000);
+    unsigned long start = millis();
+    if (!_client.connect(_addr, _port)) {
+        Log.warn(LogModule::UPLOADER, "TCP connect to %s:%u failed", _host.c_str(), _port);
+        _resolved = false;
+        return false;
+    }
+    _link.connected(millis() - start);
+    _client.setNoDelay(true);
+    return true;
+}
+
+int HttpTransport::_post(const Body& body, const char* contentType, const String& timestamp,
+                         uint32_t id, uint32_t crc, uint8_t channel, uint32_t baseId) {
+    bool reused = _client.connected();
+    if (!reused && !_connect()) {
+        _link.failed();
+        return -1;
+    }
+
+    size_t start = body.in ? body.in->position() : 0;
+    int code = _request(body, contentType, timestamp, id, crc, channel, baseId);
+    if (code < 0 && reused) {
+        // The receiver closed the kept-alive connection meanwhile
+        Log.debug(LogModule::UPLOADER, "Reused connection failed, reconnecting");
+        _client.stop();
+        if (!_connect()) {
+            _link.failed();
+            return -1;
+        }
+        if (body.in) body.in->seek(start);
+        code = _request(body, contentType, timestamp, id, crc, channel, baseId);
+    }
+    if (code < 0) _link.failed();
+    _lastUse = millis();
+    return code;
+}
+
+int HttpTransport::_request(const Body& body, const char* contentType, const String& timestamp,
+                            uint32_t id, uint32_t crc, uint8_t channel, uint32_t baseId) {
+    int n = snprintf(_header, sizeof(_header),
+                     "POST %s HTTP/1.1\r\n"
+                     "Host: %s:%u\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %u\r\n"
+                     "X-Device-Name: %s\r\n"
+                     "X-Device-Id: %s\r\n"
+                     "X-Timestamp: %s\r\n"
+                     "X-Dump-Id: %u\r\n"
+                     "X-Channel: %u\r\n"
+                     "X-Content-CRC32: %08x\r\n",
+                     _path.c_str(), _host.c_str(), _port, contentType, body.length,
+                     DEVICE_NAME, deviceId(), timestamp.c_str(), id, channel, crc);
+    if (baseId > 0 && n > 0 && n < (int)sizeof(_header)) {
+        n += snprintf(_header + n, sizeof(_header) - n, "X-Delta-Base: %u\r\n", baseId);
+    }
+    if (n > 0 && n < (int)sizeof(_header)) {
+        n += snprintf(_header + n, sizeof(_header) - n, "\r\n");
+    }
+    if (n <= 0 || n >= (int)sizeof(_header)) {
+        Log.warn(LogModule::UPLOADER, "HTTP header too long");
+        return -1;
+    }
+
+    // The body gets the time it should take at the measured rate. One
+    // that runs out of time still tells us what the link managed.
+    unsigned long start = millis();
+    unsigned long deadline = start + _link.writeTimeout(n + body.length);
+    _sent = 0;
+    if (!_writeAll((const uint8_t*)_header, n, deadline) || !_writeBody(body, deadline)) {
+        if ((long)(deadline - millis()) <= 0) _link.stalled(_sent, millis() - start);
+        _client.stop();
+        return -1;
+    }
+
+    // Status line, then headers up to the blank line. The response
+    // buffer is reused for both — nothing past them is kept.
+    unsigned long written = millis();
+    deadline = written + _link.responseTimeout();
+    char* line = _header;
+    if (!_readLine(line, sizeof(_header), deadline) || strncmp(line, "HTTP/1.", 7) != 0) {
+        _client.stop();
+        return -1;
+    }
+    _link.transferred(body.length, written - start, millis() - written);
+    bool keepAlive = (line[7] == '1');   // HTTP/1.0 closes by default
+    int code = atoi(line + 9);
+
+    long contentLength = -1;
+    while (true) {
+        if (!_readLine(line, sizeof(_header), deadline)) {
+            _client.stop();
+            return -1;
+        }
+        if (line[0] == '\0') break;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            contentLength = atol(line + 15);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char* v = line + 11;
+            while (*v == ' ') v++;
+            if (strncasecmp(v, "close", 5) == 0) keepAlive = false;
+            else if (strncasecmp(v, "keep-alive", 10) == 0) keepAlive = true;
+        }
+    }
+
+    // Drain the body so the connection is clean for the next request
+    if (contentLength < 0) keepAlive = false;   // Body runs to EOF
+    long left = contentLength;
+    while (left > 0 && (long)(deadline - millis()) > 0) {
+        if (_client.available()) {
+            _client.read();
+            left--;
+        } else if (!_client.connected()) {
+            break;
+        } else {
+            delay(1);
+        }
+    }
+
+    if (!keepAlive || left > 0) {
+        _client.stop();
+    }
+    return code;
+}
+
+bool HttpTransport::_readLine(char* buf, size_t cap, unsigned long deadline) {
+    size_t len = 0;
+    while ((long)(deadline - millis()) > 0) {
+        if (!_client.available()) {
+            if (!_client.connected()) return false;
+            delay(1);
+            continue;
+        }
+        int c = _client.read();
+        if (c < 0) continue;
+        if (c == '\n') {
+            if (len > 0 && buf[len - 1] == '\r') len--;
+            buf[len] = '\0';
+            return true;
+        }
+        if (len < cap - 1) buf[len++] = c;   // Overlong header lines are truncated
+    }
+    return false;
+}
+
+bool HttpTransport::_writeBody(const Body& body, unsigned long deadline) {
+    if (!body.in) return _writeAll(body.data, body.length, deadline);
+
+    uint8_t chunk[STREAM_CHUNK];
+    size_t size = _link.chunkSize();
+    size_t left = body.length;
+    while (left > 0) {
+        size_t n = body.in->read(chunk, min(left, size));
+        if (n == 0) {
+            Log.warn(LogModule::UPLOADER, "Short read from %s", body.in->path());
+            return false;
+        }
+        if (!_writeAll(chunk, n, deadline)) return false;
+        left -= n;
+    }
+    return true;
+}
+
+bool HttpTransport::_writeAll(const uint8_t* data, size_t len, unsigned long deadline) {
+    size_t size = _link.chunkSize();
+    size_t sent = 0;
+    while (sent < len) {
+        if ((long)(deadline - millis()) <= 0) {
+            Log.warn(LogModule::UPLOADER, "Write timed out, %u of %u bytes sent", sent, len);
+            return false;
+        }
+        size_t n = _client.write(data + sent, min(len - sent, size));
+        if (n == 0) return false;
+        sent += n;
+        _sent += n;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include "upload_transport.h"
+#include "config.h"
+#include "link_quality.h"
+#include <WiFi.h>
+
+// One HTTP POST per dump; any 2xx response counts as delivered.
+//
+// The transport is a session that lives across uploads: the receiver's
+// address is resolved once per HTTP_DNS_TTL_MS, the TCP connection is
+// kept open (HTTP/1.1 keep-alive) and the request header is built into a
+// fixed buffer. Back-to-back uploads then cost one round trip each
+// instead of DNS + handshake + request. A request that fails on a reused
+// connection (the receiver closed it meanwhile) is retried once on a
+// fresh one.
+//
+// Timeouts and the write chunk size come from link, which each request
+// also feeds: connect time, body throughput and time to the response.
+//
+// URL form: http://host[:port][/path]
+class HttpTransport : public UploadTransport {
+public:
+    HttpTransport(const String& url, LinkQuality& link);
+    ~HttpTransport() override;
+
+    const char* name() const override { return "http"; }
+    void update() override;
+    bool send(const String& data, const String& timestamp, uint32_t id, uint32_t crc,
+              uint8_t channel) override;
+    bool sendFile(File& in, size_t length, const String& timestamp, uint32_t id, uint32_t crc,
+                  uint8_t channel) override;
+    bool sendSummary(const String& json, const String& timestamp, uint32_t id, uint32_t crc,
+                     uint8_t channel) override;
+    bool supportsDelta() const override { return true; }
+    DeltaResult sendDelta(const String& delta, const String& timestamp, uint32_t id,
+                          uint32_t crc, uint8_t channel, uint32_t baseId) override;
+
+private:
+    WiFiClient _client;
+    LinkQuality& _link;
+    String _url;
+    String _host;
+    uint16_t _port;
+    String _path;
+    IPAddress _addr;
+    bool _resolved;
+    unsigned long _resolvedAt;
+    unsigned long _lastUse;
+    size_t _sent;             // Bytes of the current request written so far
+    char _header[HTTP_HEADER_BUF];
+
+    void _parseUrl(const String& url);
+    bool _connect();
+    // Request body: in memory, or length bytes read from a file
+    struct Body {
+        const uint8_t* data;
+        File* in;
+        size_t length;
+    };
+
+    int _post(const Body& body, const char* contentType, const String& timestamp,
+              uint32_t id, uint32_t crc, uint8_t channel, uint32_t baseId);
+    int _request(const Body& body, const char* contentType, const String& timestamp,
+                 uint32_t id, uint32_t crc, uint8_t channel, uint32_t baseId);
+    bool _writeBody(const Body& body, unsigned long deadline);
+    bool _readLine(char* buf, size_t cap, unsigned long deadline);
+    bool _writeAll(const uint8_t* data, size_t len, unsigned long deadline);
+};
+
+#endif // HTTP_TRANSPORT_H
@@ -0,0 +1,149 @@
+#include "link_quality.h"
+#include "config.h"
+#include "logger.h"
+#include <WiFi.h>
+
+static unsigned long clampMs(unsigned long ms, unsigned long lo, unsigned long hi) {
+    return ms < lo ? lo : (ms > hi ? hi : ms);
+}
+
+LinkQuality::LinkQuality()
+    : _rssi(0)
+    , _bps(0)
+    , _rtt(0)
+    , _connect(0)
+    , _samples(0)
+    , _failures(0)
+    , _weak(false)
+    , _weakSince(0)
+    , _lastRssi(0) {
+}
+
+void LinkQuality::update() {
+    if (_lastRssi != 0 && millis() - _lastRssi < LINK_RSSI_SAMPLE_MS) return;
+    _lastRssi = millis();
+
+    int rssi = WiFi.RSSI();
+    if (rssi == 0) return;   // Not associated
+    _rssi = (_rssi == 0) ? rssi
+        : (_rssi * (100 - LINK_EWMA_WEIGHT_PCT) + rssi * LINK_EWMA_WEIGHT_PCT) / 100;
+
+    // Hysteresis, so a signal hovering at the threshold doesn't flap
+    if (!_weak && _rssi < UPLOAD_DEFER_RSSI) {
+        _weak = true;
+        _weakSince = millis();
+        Log.warn(LogModule::UPLOADER, "Weak link (%d dBm), deferring bulk uploads", (int)_rssi);
+    } else if (_weak && _rssi >= UPLOAD_DEFER_RSSI + UPLOAD_DEFER_HYSTERESIS_DB) {
+        _weak = false;
+        Log.info(LogModule::UPLOADER, "Link recovered (%d dBm)", (int)_rssi);
+    }
+}
+
+void LinkQuality::connected(unsigned long ms) {
+    _connect = _smooth(_connect, max(ms, 1UL));
+}
+
+void LinkQuality::transferred(size_t bytes, unsigned long writeMs, unsigned long rttMs) {
+    _failures = 0;
+    _samples++;
+    _rtt = _smooth(_rtt, max(rttMs, 1UL));
+
+    // A small body goes straight into the socket buffer, so its write
+    // time says nothing about the link. The RTT is counted in, which
+    // errs low — the safe side for timeouts.
+    if (bytes >= LINK_SAMPLE_MIN_BYTES) {
+        _bps = _smooth(_bps, (uint32_t)((uint64_t)bytes * 1000 / (writeMs + rttMs + 1)));
+    }
+}
+
+void LinkQuality::stalled(size_t bytes, unsigned long ms) {
+    _bps = _smooth(_bps, max((uint32_t)((uint64_t)bytes * 1000 / (ms + 1)), (uint32_t)1));
+}
+
+void LinkQuality::failed() {
+    if (_failures < 255) _failures++;
+}
+
+unsigned long LinkQuality::connectTimeout() const {
+    if (_connect == 0) return _widen(HTTP_CONNECT_TIMEOUT_MS);
+    return _widen(clampMs(_connect * LINK_TIMEOUT_FACTOR + 1000, LINK_CONNECT_MIN_MS, LINK_CONNECT_MAX_MS));
+}
+
+unsigned long LinkQuality::writeTimeout(size_t bytes) const {
+    // Not capped: a large spilled dump on a slow link needs the time
+    uint32_t bps = _bps ? _bps : LINK_DEFAULT_BPS;
+    return _widen((unsigned long)((uint64_t)bytes * 1000 * LINK_TIMEOUT_FACTOR / bps) + LINK_RESPONSE_MIN_MS);
+}
+
+unsigned long LinkQuality::responseTimeout() const {
+    if (_rtt == 0) return _widen(HTTP_RESPONSE_TIMEOUT_MS);
+    return _widen(clampMs(_rtt * LINK_TIMEOUT_FACTOR + 1000, LINK_RESPONSE_MIN_MS, LINK_RESPONSE_MAX_MS));
+}
+
+size_t LinkQuality::chunkSize() const {
+    // About LINK_CHUNK_TARGET_MS of data per write, so a stalled link
+    // is noticed between writes rather than after the whole buffer
+    if (_bps == 0) return STREAM_CHUNK;
+    size_t n = (size_t)_bps * LINK_CHUNK_TARGET_MS / 1000;
+    return n < LINK_CHUNK_MIN ? LINK_CHUNK_MIN : (n > STREAM_CHUNK ? STREAM_CHUNK : n);
+}
+
+uint8_t LinkQuality::deltaRatioPct() const {
+    // On a slow link every byte saved counts
+    bool slow = _weak || (_bps != 0 && _bps < LINK_SLOW_BPS);
+    return slow ? LINK_SLOW_DELTA_RATIO_PCT : DELTA_MAX_RATIO_PCT;
+}
+
+uint8_t LinkQuality::attempts() const {
+    // On a link that is already failing, more tries in a row only hold
+    // up the loop; the queue's backoff takes it from here
+    return (_weak || _failures >= 2) ? 1 : UPLOAD_ATTEMPTS;
+}
+
+unsigned long LinkQuality::retryDelay() const {
+    if (_connect == 0) return 500;
+    return clampMs(_connect * 2, 250, 2000);
+}
+
+bool LinkQuality::deferBulk() const {
+    return _weak && millis() - _weakSince < UPLOAD_DEFER_MAX_MS;
+}
+
+int LinkQuality::getRssi() const {
+    return _rssi;
+}
+
+uint32_t LinkQuality::getThroughput() const {
+    return _bps;
+}
+
+uint32_t LinkQuality::getRtt() const {
+    return _rtt;
+}
+
+uint32_t LinkQuality::getConnectTime() const {
+    return _connect;
+}
+
+uint32_t LinkQuality::getSamples() const {
+    return _samples;
+}
+
+uint8_t LinkQuality::getFailures() const {
+    return _failures;
+}
+
+bool LinkQuality::isWeak() const {
+    return _weak;
+}
+
+unsigned long LinkQuality::_widen(unsigned long ms) const {
+    // A link that keeps failing may just be slower than measured; the
+    // next try gets more time rather than failing the same way
+    return ms << min(_failures, (uint8_t)LINK_FAILURE_WIDEN_MAX);
+}
+
+uint32_t LinkQuality::_smooth(uint32_t avg, uint32_t sample) {
+    if (avg == 0) return sample;
+    return (uint32_t)(((uint64_t)avg * (100 - LINK_EWMA_WEIGHT_PCT) + (uint64_t)sample * LINK_EWMA_WEIGHT_PCT) / 100);
+}
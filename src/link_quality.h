@@ -0,0 +1,74 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <Arduino.h>
+
+// Running estimate of the upload link, from what uploads actually
+// achieved: throughput, round-trip time, connect time and signal
+// strength, each smoothed with an EWMA (LINK_EWMA_WEIGHT_PCT per sample).
+//
+// The uploader asks it how to send rather than using fixed numbers:
+// timeouts sized to the body at the measured rate, the write chunk size,
+// whether a delta is worth sending, how many immediate attempts to make,
+// and whether bulk uploads should wait for the signal to recover.
+// Until a sample is in, the tuning falls back to the old fixed values.
+class LinkQuality {
+public:
+    LinkQuality();
+
+    // Call from loop() while connected — samples RSSI
+    void update();
+
+    // A TCP connect that took ms
+    void connected(unsigned long ms);
+
+    // A request that got a response: bytes of body written in writeMs,
+    // then rttMs until the status line
+    void transferred(size_t bytes, unsigned long writeMs, unsigned long rttMs);
+
+    // A request whose write timed out after bytes in ms: the rate it
+    // managed is a throughput sample, however small
+    void stalled(size_t bytes, unsigned long ms);
+
+    // A connect or request that got no response. Each one in a row
+    // doubles the timeouts, up to LINK_FAILURE_WIDEN_MAX times.
+    void failed();
+
+    // Tuning
+    unsigned long connectTimeout() const;
+    unsigned long writeTimeout(size_t bytes) const;   // Header and body
+    unsigned long responseTimeout() const;            // After the body
+    size_t chunkSize() const;                         // At most STREAM_CHUNK
+    uint8_t deltaRatioPct() const;                    // See DeltaEncoder::encode
+    uint8_t attempts() const;                         // Before queuing
+    unsigned long retryDelay() const;
+
+    // True while RSSI is below UPLOAD_DEFER_RSSI, for at most
+    // UPLOAD_DEFER_MAX_MS: bulk uploads should wait in the queue
+    bool deferBulk() const;
+
+    // Measurements for /api/status; 0 = no sample yet
+    int getRssi() const;
+    uint32_t getThroughput() const;   // Bytes/s
+    uint32_t getRtt() const;          // ms
+    uint32_t getConnectTime() const;  // ms
+    uint32_t getSamples() const;
+    uint8_t getFailures() const;      // In a row
+    bool isWeak() const;
+
+private:
+    int32_t _rssi;
+    uint32_t _bps;
+    uint32_t _rtt;
+    uint32_t _connect;
+    uint32_t _samples;
+    uint8_t _failures;
+    bool _weak;
+    unsigned long _weakSince;
+    unsigned long _lastRssi;
+
+    unsigned long _widen(unsigned long ms) const;
+    static uint32_t _smooth(uint32_t avg, uint32_t sample);
+};
+
+#endif // LINK_QUALITY_H
@@ -0,0 +1,139 @@
+#include "live_stream.h"
+#include "device_id.h"
+#include "logger.h"
+#include <lwip/sockets.h>
+
+LiveStream::LiveStream()
+    : _server(LIVE_STREAM_PORT)
+    , _hasPending(false)
+    , _seq(0)
+    , _lastFlush(0)
+    , _lastKeepalive(0) {
+}
+
+void LiveStream::begin() {
+    _server.begin();
+    _server.setNoDelay(true);
+    Log.info(LogModule::LIVE, "SSE stream on port %d", LIVE_STREAM_PORT);
+}
+
+void LiveStream::update() {
+    _acceptClients();
+
+    unsigned long now = millis();
+    if (_hasPending && now - _lastFlush >= LIVE_STREAM_MIN_INTERVAL_MS) {
+        _flush();
+    }
+
+    // SSE comment line keeps proxies from timing out idle streams and
+    // lets us notice clients that went away.
+    if (now - _lastKeepalive >= LIVE_STREAM_KEEPALIVE_MS) {
+        _lastKeepalive = now;
+        _writeAll(": ping\n\n", 8);
+    }
+}
+
+void LiveStream::publish(const String& reading) {
+    if (_hasPending) _stats.coalesced++;
+    _pending = reading;
+    _hasPending = true;
+    _stats.published++;
+
+    // Flush immediately when not rate-limited — this is the common case
+    // and keeps latency to one loop() pass.
+    if (millis() - _lastFlush >= LIVE_STREAM_MIN_INTERVAL_MS) {
+        _flush();
+    }
+}
+
+void LiveStream::setTarget(const String& receiverUrl) {
+    _udpHost = "";
+    if (!receiverUrl.startsWith("http://")) return;
+
+    String rest = receiverUrl.substring(7);
+    int end = rest.length();
+    int colon = rest.indexOf(':');
+    int slash = rest.indexOf('/');
+    if (colon >= 0 && colon < end) end = colon;
+    if (slash >= 0 && slash < end) end = slash;
+    _udpHost = rest.substring(0, end);
+}
+
+const LiveStreamStats& LiveStream::getStats() const {
+    return _stats;
+}
+
+void LiveStream::_acceptClients() {
+    WiFiClient incoming = _server.available();
+    if (!incoming) return;
+
+    int slot = -1;
+    for (int i = 0; i < LIVE_STREAM_MAX_CLIENTS; i++) {
+        if (!_clients[i].connected()) {
+            _clients[i].stop();
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        incoming.print("HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n");
+        incoming.stop();
+        return;
+    }
+
+    // The request itself doesn't matter — every path is the stream.
+    // Discard whatever the browser has sent so far.
+    while (incoming.available()) incoming.read();
+
+    incoming.setNoDelay(true);
+    incoming.print("HTTP/1.1 200 OK\r\n"
+                   "Content-Type: text/event-stream\r\n"
+                   "Cache-Control: no-cache\r\n"
+                   "Access-Control-Allow-Origin: *\r\n"
+                   "Connection: keep-alive\r\n\r\n");
+    _clients[slot] = incoming;
+    Log.info(LogModule::LIVE, "Client %s connected (slot %d)",
+             incoming.remoteIP().toString().c_str(), slot);
+}
+
+void LiveStream::_flush() {
+    _hasPending = false;
+    _lastFlush = millis();
+    _seq++;
+    _stats.sent++;
+
+    char msg[STREAM_MAX_LINE + 32];
+    int len = snprintf(msg, sizeof(msg), "id: %u\ndata: %s\n\n", _seq, _pending.c_str());
+    _writeAll(msg, len);
+
+    if (_udpHost.length() > 0) {
+        // <device id>\t<seq>\t<uptime ms>\t<reading>
+        len = snprintf(msg, sizeof(msg), "%s\t%u\t%lu\t%s",
+                       deviceId(), _seq, _lastFlush, _pending.c_str());
+        if (_udp.beginPacket(_udpHost.c_str(), LIVE_STREAM_UDP_PORT)) {
+            _udp.write((const uint8_t*)msg, len);
+            _udp.endPacket();
+        }
+    }
+}
+
+void LiveStream::_writeAll(const char* data, size_t len) {
+    uint8_t count = 0;
+    for (int i = 0; i < LIVE_STREAM_MAX_CLIENTS; i++) {
+        WiFiClient& c = _clients[i];
+        if (!c.connected()) continue;
+        count++;
+
+        // Non-blocking send: a client whose socket buffer is full just
+        // misses this event and picks up the next reading, instead of
+        // stalling the loop the way WiFiClient::write() would.
+        int n = send(c.fd(), data, len, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        if (n != (int)len) {
+            // Error or torn event — drop the client; EventSource reconnects
+            c.stop();
+            count--;
+        }
+    }
+    _stats.clients = count;
+}
@@ -0,0 +1,58 @@
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "config.h"
+
+struct LiveStreamStats {
+    uint32_t published = 0;   // Readings handed to publish()
+    uint32_t sent = 0;        // Readings actually flushed to the network
+    uint32_t coalesced = 0;   // Readings replaced by a newer one before flush
+    uint8_t clients = 0;      // Connected SSE clients
+};
+
+// Pushes live readings to Server-Sent Events clients (port LIVE_STREAM_PORT)
+// and as UDP datagrams to the receiver host.
+//
+// Only the newest reading is held: if readings arrive faster than
+// LIVE_STREAM_MIN_INTERVAL_MS, or a client's socket can't take the next
+// event, older readings are dropped rather than queued, so a slow link
+// never adds latency to what the display shows.
+class LiveStream {
+public:
+    LiveStream();
+
+    // Start listening for SSE clients
+    void begin();
+
+    // Call from loop() — accepts clients and flushes the pending reading
+    void update();
+
+    // Offer a new reading; replaces any reading not yet flushed
+    void publish(const String& reading);
+
+    // Derive the UDP target from the receiver URL (http:// only)
+    void setTarget(const String& receiverUrl);
+
+    const LiveStreamStats& getStats() const;
+
+private:
+    WiFiServer _server;
+    WiFiClient _clients[LIVE_STREAM_MAX_CLIENTS];
+    WiFiUDP _udp;
+    String _udpHost;
+    String _pending;
+    bool _hasPending;
+    uint32_t _seq;
+    unsigned long _lastFlush;
+    unsigned long _lastKeepalive;
+    LiveStreamStats _stats;
+
+    void _acceptClients();
+    void _flush();
+    void _writeAll(const char* data, size_t len);
+};
+
+#endif // LIVE_STREAM_H
@@ -0,0 +1,215 @@
+#include "load_generator.h"
+#include "logger.h"
+
+static const char BANNER[] =
+    "920i Print Output\r\n"
+    "Date: 2026-02-18\r\n"
+    "Time: 10:30:00\r\n"
+    "\r\n"
+    "ID\tGross\tTare\tNet\tUnit\r\n";
+
+SyntheticDump::SyntheticDump(uint32_t rows, uint32_t seed)
+    : _rows(rows)
+    , _row(0)
+    , _x(seed)
+    , _lineLen(0)
+    , _linePos(0) {
+    _nextLine();
+}
+
+size_t SyntheticDump::read(uint8_t* buf, size_t cap) {
+    size_t n = 0;
+    while (n < cap) {
+        if (_linePos == _lineLen && !_nextLine()) break;
+        size_t take = min(cap - n, _lineLen - _linePos);
+        memcpy(buf + n, _line + _linePos, take);
+        _linePos += take;
+        n += take;
+    }
+    return n;
+}
+
+bool SyntheticDump::done() const {
+    return _linePos == _lineLen && _row > _rows;
+}
+
+uint32_t SyntheticDump::rowsForSize(uint32_t bytes) {
+    // Rows run 25-29 bytes, ~28 on average
+    uint32_t body = bytes > sizeof(BANNER) ? bytes - (sizeof(BANNER) - 1) : 0;
+    return max(body / 28, (uint32_t)1);
+}
+
+bool SyntheticDump::_nextLine() {
+    _linePos = 0;
+    if (_row == 0) {
+        memcpy(_line, BANNER, sizeof(BANNER) - 1);
+        _lineLen = sizeof(BANNER) - 1;
+        _row = 1;
+        return true;
+    }
+    if (_row > _rows) {
+        _lineLen = 0;
+        return false;
+    }
+
+    // Deterministic weights (LCG) so runs are comparable
+    _x = _x * 1664525 + 1013904223;
+    uint32_t gross = 5000 + (_x >> 16) % 30000;   // tenths of a lb
+    int n = snprintf(_line, sizeof(_line), "%u\t%u.%u\t120.0\t%u.%u\tlb\r\n",
+                     _row, gross / 10, gross % 10, (gross - 1200) / 10, (gross - 1200) % 10);
+    _lineLen = min((size_t)max(n, 0), sizeof(_line) - 1);
+    _row++;
+    return true;
+}
+
+LoadGenerator::LoadGenerator()
+    : _phase(Phase::IDLE)
+    , _target(nullptr)
+    , _dumpIndex(0)
+    , _feedStart(0)
+    , _lastByteAt(0)
+    , _capturedAt(0)
+    , _gapStart(0) {
+}
+
+bool LoadGenerator::start(SerialComm* target, const LoadGenParams& params, String& error) {
+    if (_phase != Phase::IDLE) {
+        error = "A load run is already in progress";
+        return false;
+    }
+    if (target->getMode() != CaptureMode::DUMP) {
+        error = "Channel is in stream mode";
+        return false;
+    }
+    if (target->getState() == CaptureState::RECEIVING) {
+        error = "Channel is receiving from the 920i";
+        return false;
+    }
+    if (params.rows == 0 || params.count == 0 || params.count > LOADGEN_MAX_DUMPS) {
+        error = "rows must be > 0 and count 1-" + String(LOADGEN_MAX_DUMPS);
+        return false;
+    }
+
+    _target = target;
+    _params = params;
+    _results.clear();
+    _results.reserve(params.count);
+    _dumpIndex = 0;
+
+    Log.info(LogModule::MAIN, "Load run: %u dump(s) of %u rows on ch %u, gap %u ms, %u B/s",
+             params.count, params.rows, target->getChannel(), params.intervalMs, params.rate);
+    _startDump();
+    return true;
+}
+
+void LoadGenerator::stop() {
+    if (_phase == Phase::IDLE) return;
+    Log.info(LogModule::MAIN, "Load run stopped after %u dump(s)", _results.size());
+    _phase = Phase::IDLE;
+}
+
+void LoadGenerator::update() {
+    switch (_phase) {
+        case Phase::FEEDING:
+            _feed();
+            break;
+        case Phase::GAP:
+            if (millis() - _gapStart >= _params.intervalMs) {
+                _startDump();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool LoadGenerator::isCapturing(uint8_t channel) const {
+    return _phase == Phase::CAPTURING && _target->getChannel() == channel;
+}
+
+void LoadGenerator::dumpCaptured() {
+    _capturedAt = millis();
+    _current.closeMs = _capturedAt - _lastByteAt;
+    _phase = Phase::SUBMITTING;
+}
+
+void LoadGenerator::dumpSubmitted(bool uploaded) {
+    if (_phase != Phase::SUBMITTING) return;
+    _current.submitMs = millis() - _capturedAt;
+    _current.uploaded = uploaded;
+    _results.push_back(_current);
+
+    if (++_dumpIndex >= _params.count) {
+        uint32_t ok = 0;
+        for (const LoadGenResult& r : _results) {
+            if (r.uploaded) ok++;
+        }
+        Log.info(LogModule::MAIN, "Load run done: %u/%u uploaded", ok, _results.size());
+        _phase = Phase::IDLE;
+        return;
+    }
+    _gapStart = millis();
+    _phase = Phase::GAP;
+}
+
+bool LoadGenerator::isRunning() const {
+    return _phase != Phase::IDLE;
+}
+
+const LoadGenParams& LoadGenerator::getParams() const {
+    return _params;
+}
+
+const std::vector<LoadGenResult>& LoadGenerator::getResults() const {
+    return _results;
+}
+
+uint8_t LoadGenerator::getChannel() const {
+    return _target ? _target->getChannel() : 0;
+}
+
+void LoadGenerator::_startDump() {
+    // A real print may have started during the gap; wait for it
+    if (_target->getState() == CaptureState::RECEIVING) {
+        _gapStart = millis();
+        _phase = Phase::GAP;
+        return;
+    }
+
+    // Seed per dump, so consecutive dumps differ like real prints do
+    _source = SyntheticDump(_params.rows, _params.seed + _dumpIndex);
+    _current = LoadGenResult();
+    _feedStart = millis();
+    _phase = Phase::FEEDING;
+    _feed();
+}
+
+void LoadGenerator::_feed() {
+    // Byte budget: everything due at the requested rate so far, or a
+    // fixed number of driver-sized chunks per loop when unthrottled
+    size_t budget;
+    if (_params.rate > 0) {
+        uint64_t due = (uint64_t)_params.rate * (millis() - _feedStart) / 1000;
+        budget = due > _current.bytes ? (size_t)(due - _current.bytes) : 0;
+        budget = min(budget, (size_t)UART_READ_CHUNK * LOADGEN_CHUNKS_PER_LOOP);
+    } else {
+        budget = (size_t)UART_READ_CHUNK * LOADGEN_CHUNKS_PER_LOOP;
+    }
+
+    // Bytes arrive in UART_READ_CHUNK reads, as from the driver
+    uint8_t chunk[UART_READ_CHUNK];
+    while (budget > 0) {
+        size_t n = _source.read(chunk, min(budget, sizeof(chunk)));
+        if (n == 0) break;
+        _target->inject(chunk, n);
+        _current.bytes += n;
+        budget -= n;
+    }
+
+    if (_source.done()) {
+        // The capture closes the dump on its idle timeout, as for a real print
+        _lastByteAt = millis();
+        _current.feedMs = _lastByteAt - _feedStart;
+        _phase = Phase::CAPTURING;
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "serial_comm.h"
+
+// A 920i-style print (banner, column header, then rows of deterministic
+// weights), produced a few bytes at a time so a 40 KB dump never has to
+// exist in RAM twice.
+class SyntheticDump {
+public:
+    SyntheticDump(uint32_t rows = 0, uint32_t seed = 1);
+
+    // Copy up to cap bytes of the dump into buf; 0 once it's all out
+    size_t read(uint8_t* buf, size_t cap);
+    bool done() const;
+
+    // Rows that make a dump of roughly this many bytes
+    static uint32_t rowsForSize(uint32_t bytes);
+
+private:
+    uint32_t _rows;
+    uint32_t _row;     // 0 = banner, then 1.._rows
+    uint32_t _x;       // LCG state
+    char _line[96];
+    size_t _lineLen;
+    size_t _linePos;
+
+    bool _nextLine();
+};
+
+struct LoadGenParams {
+    uint32_t rows = LOADGEN_DEFAULT_ROWS;
+    uint32_t count = 1;
+    uint32_t intervalMs = 0;   // Quiet gap after each dump is handled
+    uint32_t rate = 0;         // Bytes/s into the capture path, 0 = unthrottled
+    uint32_t seed = 1;
+};
+
+// Pipeline timings of one synthetic dump
+struct LoadGenResult {
+    uint32_t bytes = 0;
+    uint32_t feedMs = 0;      // First to last byte into the capture path
+    uint32_t closeMs = 0;     // Last byte to dump complete (idle timeout)
+    uint32_t submitMs = 0;    // Summary + upload attempts, or queueing
+    bool uploaded = false;
+};
+
+// On-device load generator behind /api/test-dump. Synthetic dumps are
+// fed into a capture channel with SerialComm::inject(), so they go
+// through the same ingest, CRC, summary, idle-timeout, upload and queue
+// path as bytes off the UART — without the scale. Runs from loop(), a
+// chunk at a time, optionally throttled to a byte rate.
+//
+// main.cpp reports back through dumpCaptured()/dumpSubmitted() from the
+// dump callback, which is where the capture and submit times come from.
+class LoadGenerator {
+public:
+    LoadGenerator();
+
+    // Start a run on target. Fails (with a reason) if a run is in
+    // progress, the channel isn't in dump mode or is receiving.
+    bool start(SerialComm* target, const LoadGenParams& params, String& error);
+
+    // Abandon the run; results so far are kept
+    void stop();
+
+    // Call from loop() — feeds bytes and paces the dumps
+    void update();
+
+    // True while a synthetic dump is between its last byte and the
+    // dump callback, i.e. the next dump completed on channel is ours
+    bool isCapturing(uint8_t channel) const;
+
+    void dumpCaptured();
+    void dumpSubmitted(bool uploaded);
+
+    bool isRunning() const;
+    const LoadGenParams& getParams() const;
+    const std::vector<LoadGenResult>& getResults() const;
+    uint8_t getChannel() const;
+
+private:
+    enum class Phase { IDLE, FEEDING, CAPTURING, SUBMITTING, GAP };
+
+    Phase _phase;
+    SerialComm* _target;
+    LoadGenParams _params;
+    std::vector<LoadGenResult> _results;
+    SyntheticDump _source;
+    LoadGenResult _current;
+    uint32_t _dumpIndex;
+    unsigned long _feedStart;
+    unsigned long _lastByteAt;
+    unsigned long _capturedAt;
+    unsigned long _gapStart;
+
+    void _startDump();
+    void _feed();
+};
+
+#endif // LOAD_GENERATOR_H
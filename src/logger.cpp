@@ -0,0 +1,433 @@
+#include "logger.h"
+#include "crc32.h"
+#include "persistent_state.h"
+#include <LittleFS.h>
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include <esp_app_desc.h>
+#else
+#include <esp_ota_ops.h>
+#endif
+
+Logger Log;
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint32_t SPILL_MAGIC = 0x314C4D42;  // "BML1"
+
+// Fixed part of every record; the encoded arguments follow it
+struct LogRecordHeader {
+    uint16_t len;        // Whole record, header included
+    uint8_t level;
+    uint8_t module;
+    uint32_t ms;
+    const char* fmt;
+};
+
+static const size_t LOG_MAX_RECORD = sizeof(LogRecordHeader) + LOG_MAX_ARGS;
+
+static const char* const MODULE_NAMES[] = {
+    "main", "SerialComm", "SerialComm2", "WiFi", "Uploader", "MQTT",
+    "Cmd", "Live", "Web", "Profile", "Log", "State"
+};
+
+static const char* const LEVEL_NAMES[] = { "error", "warn", "info", "debug" };
+
+void LogArgs::put(const char* s) {
+    if (!s) s = "(null)";
+    size_t n = strlen(s);
+    if (n > LOG_MAX_STRING) n = LOG_MAX_STRING;
+    if (_len + 2 + n > LOG_MAX_ARGS) {
+        if (_len + 2 >= LOG_MAX_ARGS) return;
+        n = LOG_MAX_ARGS - _len - 2;
+    }
+    _buf[_len++] = 's';
+    _buf[_len++] = (uint8_t)n;
+    memcpy(_buf + _len, s, n);
+    _len += n;
+}
+
+void LogArgs::_put(char tag, const void* v, size_t n) {
+    // Out of room: the argument is dropped and formats as "?"
+    if (_len + 1 + n > LOG_MAX_ARGS) return;
+    _buf[_len++] = tag;
+    memcpy(_buf + _len, v, n);
+    _len += n;
+}
+
+Logger::Logger()
+    : _head(0)
+    , _tail(0)
+    , _used(0)
+    , _firstSeq(0)
+    , _nextSeq(0)
+    , _dropped(0)
+    , _spill(false)
+    , _buildId(0)
+    , _lastSpill(0) {
+    memset(_levels, (uint8_t)LOG_DEFAULT_LEVEL, sizeof(_levels));
+    _console.seq = 0;
+    _console.offset = 0;
+    _spilled = _console;
+}
+
+void Logger::begin() {
+    // Saved by older firmware with fewer modules: the new ones keep the default
+    State.getBytes("log", "levels", _levels, sizeof(_levels));
+    _spill = State.getBool("log", "spill", false);
+
+    _buildId = _computeBuildId();
+    if (_spill && !LittleFS.exists(LOG_DIR)) {
+        LittleFS.mkdir(LOG_DIR);
+    }
+    info(LogModule::LOG, "Ready. %u B ring, spill %s, build %08x",
+         LOG_RING_SIZE, _spill ? "on" : "off", _buildId);
+}
+
+void Logger::update() {
+    // Console echo: format only what the TX buffer takes right now, so
+    // logging never stalls the loop (or piles up with no USB host)
+    if (Serial) {
+        uint8_t rec[LOG_MAX_RECORD];
+        char line[LOG_MAX_LINE];
+        for (int i = 0; i < 8; i++) {
+            Cursor c = _console;
+            if (!_next(c, rec)) break;
+            size_t n = _format(rec, line, sizeof(line));
+            if (Serial.availableForWrite() < (int)n) break;
+            Serial.write((const uint8_t*)line, n);
+            _console = c;
+        }
+    }
+
+    if (_spill && millis() - _lastSpill >= LOG_SPILL_INTERVAL_MS) {
+        _lastSpill = millis();
+        _spillPending();
+    }
+}
+
+void Logger::setLevel(LogLevel level) {
+    memset(_levels, (uint8_t)level, sizeof(_levels));
+    _saveLevels();
+}
+
+void Logger::setLevel(LogModule m, LogLevel level) {
+    _levels[(uint8_t)m] = (uint8_t)level;
+    _saveLevels();
+}
+
+LogLevel Logger::getLevel(LogModule m) const {
+    return (LogLevel)_levels[(uint8_t)m];
+}
+
+void Logger::setSpill(bool enabled) {
+    _spill = enabled;
+    State.setBool("log", "spill", enabled);
+    State.commit();
+
+    if (enabled) {
+        if (!LittleFS.exists(LOG_DIR)) LittleFS.mkdir(LOG_DIR);
+        // Start from what is still in RAM
+        portENTER_CRITICAL(&s_mux);
+        _spilled.seq = _firstSeq;
+        _spilled.offset = _tail;
+        portEXIT_CRITICAL(&s_mux);
+    }
+    info(LogModule::LOG, "Flash spill %s", enabled ? "on" : "off");
+}
+
+bool Logger::getSpill() const {
+    return _spill;
+}
+
+uint32_t Logger::readText(uint32_t since, String& out, LogLevel maxLevel) {
+    Cursor c;
+    portENTER_CRITICAL(&s_mux);
+    c.seq = _firstSeq;
+    c.offset = _tail;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (since < c.seq && since > 0) {
+        out += "... ";
+        out += String(c.seq - since);
+        out += " older record(s) dropped\n";
+    }
+
+    uint8_t rec[LOG_MAX_RECORD];
+    char line[LOG_MAX_LINE];
+    while (_next(c, rec)) {
+        uint32_t seq = c.seq - 1;
+        if (seq < since) continue;
+        if (rec[2] > (uint8_t)maxLevel) continue;
+        size_t n = _format(rec, line, sizeof(line));
+        out.concat(line, n);
+    }
+    return c.seq;
+}
+
+void Logger::readSpill(String& out) {
+    const char* files[] = { LOG_DIR "/log.1.bin", LOG_DIR "/log.bin" };
+    uint8_t rec[LOG_MAX_RECORD];
+    char line[LOG_MAX_LINE];
+
+    for (const char* path : files) {
+        File f = LittleFS.open(path, "r");
+        if (!f) continue;
+
+        uint32_t header[2];
+        if (f.read((uint8_t*)header, sizeof(header)) != sizeof(header)
+            || header[0] != SPILL_MAGIC || header[1] != _buildId) {
+            // Format pointers are only meaningful to the build that wrote them
+            out += String("(") + path + ": written by another firmware build, skipped)\n";
+            f.close();
+            continue;
+        }
+
+        while (f.available() >= (int)sizeof(LogRecordHeader)) {
+            uint16_t len;
+            if (f.read((uint8_t*)&len, sizeof(len)) != sizeof(len)) break;
+            if (len < sizeof(LogRecordHeader) || len > LOG_MAX_RECORD) break;
+            memcpy(rec, &len, sizeof(len));
+            size_t rest = len - sizeof(len);
+            if (f.read(rec + sizeof(len), rest) != rest) break;
+            size_t n = _format(rec, line, sizeof(line));
+            out.concat(line, n);
+        }
+        f.close();
+    }
+}
+
+uint32_t Logger::getDropped() const {
+    return _dropped;
+}
+
+uint32_t Logger::getNextSeq() const {
+    return _nextSeq;
+}
+
+const char* Logger::name(LogModule m) {
+    return (uint8_t)m < (uint8_t)LogModule::COUNT ? MODULE_NAMES[(uint8_t)m] : "?";
+}
+
+const char* Logger::name(LogLevel level) {
+    return (uint8_t)level < (uint8_t)LogLevel::COUNT ? LEVEL_NAMES[(uint8_t)level] : "?";
+}
+
+bool Logger::parseLevel(const String& s, LogLevel& level) {
+    for (uint8_t i = 0; i < (uint8_t)LogLevel::COUNT; i++) {
+        if (s.equalsIgnoreCase(LEVEL_NAMES[i])) {
+            level = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Logger::parseModule(const String& s, LogModule& m) {
+    for (uint8_t i = 0; i < (uint8_t)LogModule::COUNT; i++) {
+        if (s.equalsIgnoreCase(MODULE_NAMES[i])) {
+            m = (LogModule)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Logger::_push(LogLevel level, LogModule m, const char* fmt, const LogArgs& args) {
+    LogRecordHeader h;
+    h.len = sizeof(h) + args.length();
+    h.level = (uint8_t)level;
+    h.module = (uint8_t)m;
+    h.ms = millis();
+    h.fmt = fmt;
+
+    const uint8_t* parts[2] = { (const uint8_t*)&h, args.data() };
+    size_t sizes[2] = { sizeof(h), args.length() };
+
+    portENTER_CRITICAL(&s_mux);
+    // Make room by dropping the oldest records
+    while (LOG_RING_SIZE - _used < h.len) {
+        uint16_t oldLen;
+        _copyOut(_tail, (uint8_t*)&oldLen, sizeof(oldLen));
+        _tail = (_tail + oldLen) % LOG_RING_SIZE;
+        _used -= oldLen;
+        _firstSeq++;
+        _dropped++;
+    }
+    for (int p = 0; p < 2; p++) {
+        for (size_t i = 0; i < sizes[p]; i++) {
+            _ring[_head] = parts[p][i];
+            _head = (_head + 1) % LOG_RING_SIZE;
+        }
+    }
+    _used += h.len;
+    _nextSeq++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool Logger::_next(Cursor& c, uint8_t* rec) {
+    bool ok = false;
+    portENTER_CRITICAL(&s_mux);
+    // Records under the cursor were overwritten — resume at the oldest
+    if (c.seq < _firstSeq) {
+        c.seq = _firstSeq;
+        c.offset = _tail;
+    }
+    if (c.seq < _nextSeq) {
+        uint16_t len;
+        _copyOut(c.offset, (uint8_t*)&len, sizeof(len));
+        _copyOut(c.offset, rec, len);
+        c.offset = (c.offset + len) % LOG_RING_SIZE;
+        c.seq++;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+void Logger::_copyOut(uint32_t offset, uint8_t* dst, size_t n) const {
+    size_t first = min(n, (size_t)(LOG_RING_SIZE - offset));
+    memcpy(dst, _ring + offset, first);
+    memcpy(dst + first, _ring, n - first);
+}
+
+void Logger::_saveLevels() {
+    State.setBytes("log", "levels", _levels, sizeof(_levels));
+    State.commit();
+}
+
+void Logger::_spillPending() {
+    if (_spilled.seq >= _nextSeq) return;
+
+    String path = String(LOG_DIR) + "/log.bin";
+    File f = LittleFS.open(path, "a");
+    if (!f) return;
+    if (f.size() == 0) {
+        uint32_t header[2] = { SPILL_MAGIC, _buildId };
+        f.write((const uint8_t*)header, sizeof(header));
+    }
+
+    uint8_t rec[LOG_MAX_RECORD];
+    while (_next(_spilled, rec)) {
+        uint16_t len;
+        memcpy(&len, rec, sizeof(len));
+        f.write(rec, len);
+    }
+    size_t size = f.size();
+    f.close();
+
+    if (size >= LOG_SPILL_MAX_BYTES) {
+        String old = String(LOG_DIR) + "/log.1.bin";
+        LittleFS.remove(old);
+        LittleFS.rename(path, old);
+    }
+}
+
+size_t Logger::_format(const uint8_t* rec, char* out, size_t cap) {
+    LogRecordHeader h;
+    memcpy(&h, rec, sizeof(h));
+    const uint8_t* p = rec + sizeof(h);
+    const uint8_t* end = rec + h.len;
+
+    char level = "EWID"[h.level < (uint8_t)LogLevel::COUNT ? h.level : 0];
+    int r = snprintf(out, cap, "%6lu.%03lu %c [%s] ", (unsigned long)(h.ms / 1000),
+                     (unsigned long)(h.ms % 1000), level, name((LogModule)h.module));
+    size_t n = min((size_t)max(r, 0), cap - 1);
+
+    const char* f = h.fmt;
+    while (*f && n < cap - 2) {
+        if (*f != '%') {
+            if (*f != '\n') out[n++] = *f;
+            f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[n++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // Rebuild the conversion without its length modifier; the stored
+        // argument type decides how it is passed to snprintf
+        char spec[16];
+        size_t sl = 0;
+        spec[sl++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && sl < sizeof(spec) - 4) spec[sl++] = *f++;
+        while (*f && strchr("hlLqjzt", *f)) f++;
+        char conv = *f;
+        if (!conv) break;
+        f++;
+
+        bool isFloat = strchr("fFeEgGaA", conv) != nullptr;
+        char tag = (p < end) ? (char)*p++ : 0;
+        char suffix[4] = { conv, 0, 0, 0 };
+        r = -1;  // Stays -1 for a missing or mismatched argument
+
+        if (tag == 'i' || tag == 'u') {
+            int32_t v;
+            memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            if (isFloat) {
+                r = _formatSpec(out + n, cap - n, spec, sl, suffix, (double)v);
+            } else if (conv != 's') {
+                if (conv == 'p') suffix[0] = 'x';
+                r = (tag == 'i') ? _formatSpec(out + n, cap - n, spec, sl, suffix, (int)v)
+                                 : _formatSpec(out + n, cap - n, spec, sl, suffix, (unsigned)v);
+            }
+        } else if (tag == 'I' || tag == 'U') {
+            int64_t v;
+            memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            if (!isFloat && conv != 's') {
+                suffix[0] = 'l';
+                suffix[1] = 'l';
+                suffix[2] = conv;
+                r = (tag == 'I') ? _formatSpec(out + n, cap - n, spec, sl, suffix, (long long)v)
+                                 : _formatSpec(out + n, cap - n, spec, sl, suffix, (unsigned long long)v);
+            }
+        } else if (tag == 'f') {
+            double v;
+            memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            if (!isFloat) suffix[0] = 'g';
+            r = _formatSpec(out + n, cap - n, spec, sl, suffix, v);
+        } else if (tag == 's') {
+            size_t len = (p < end) ? *p++ : 0;
+            len = min(len, (size_t)(end - p));
+            char str[LOG_MAX_STRING + 1];
+            memcpy(str, p, len);
+            str[len] = 0;
+            p += len;
+            if (conv == 's') {
+                r = _formatSpec(out + n, cap - n, spec, sl, suffix, str);
+            }
+        }
+
+        if (r < 0) {
+            out[n++] = '?';
+        } else {
+            n = min(n + (size_t)r, cap - 2);
+        }
+    }
+    out[n++] = '\n';
+    return n;
+}
+
+int Logger::_formatSpec(char* out, size_t cap, char* spec, size_t specLen, const char* suffix, ...) {
+    strcpy(spec + specLen, suffix);
+    va_list ap;
+    va_start(ap, suffix);
+    int r = vsnprintf(out, cap, spec, ap);
+    va_end(ap);
+    return r;
+}
+
+uint32_t Logger::_computeBuildId() {
+    char sha[65] = {0};
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_app_get_elf_sha256(sha, sizeof(sha));
+#else
+    esp_ota_get_app_elf_sha256(sha, sizeof(sha));
+#endif
+    return crc32Of((const uint8_t*)sha, strlen(sha));
+}
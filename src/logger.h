@@ -0,0 +1,169 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum class LogLevel : uint8_t {
+    ERROR,
+    WARN,
+    INFO,
+    DEBUG,
+    COUNT
+};
+
+// Source of a log record; names are the familiar "[Tag]" prefixes
+enum class LogModule : uint8_t {
+    MAIN,
+    SERIAL_COMM,
+    SERIAL_COMM2,
+    WIFI,
+    UPLOADER,
+    MQTT,
+    COMMANDS,
+    LIVE,
+    WEB,
+    PROFILE,
+    LOG,
+    STATE,
+    COUNT
+};
+
+// Arguments of one record, encoded as a type tag plus raw value. Strings
+// are copied (truncated to LOG_MAX_STRING), everything else is stored as
+// is — nothing is formatted until the record is read.
+class LogArgs {
+public:
+    LogArgs() : _len(0) {}
+
+    void put(int v)                { _put('i', &v, sizeof(v)); }
+    void put(unsigned int v)       { _put('u', &v, sizeof(v)); }
+    void put(long v)               { int64_t x = v; _put('I', &x, sizeof(x)); }
+    void put(unsigned long v)      { uint64_t x = v; _put('U', &x, sizeof(x)); }
+    void put(long long v)          { _put('I', &v, sizeof(v)); }
+    void put(unsigned long long v) { _put('U', &v, sizeof(v)); }
+    void put(double v)             { _put('f', &v, sizeof(v)); }
+    void put(const char* s);
+    void put(const String& s)      { put(s.c_str()); }
+
+    const uint8_t* data() const { return _buf; }
+    size_t length() const { return _len; }
+
+private:
+    uint8_t _buf[LOG_MAX_ARGS];
+    size_t _len;
+
+    void _put(char tag, const void* v, size_t n);
+};
+
+inline void logEncode(LogArgs&) {}
+
+template <typename T, typename... Rest>
+void logEncode(LogArgs& a, const T& first, const Rest&... rest) {
+    a.put(first);
+    logEncode(a, rest...);
+}
+
+// Structured logger: the hot path only copies a compact binary record
+// (uptime, level, module, format pointer, arguments) into a RAM ring of
+// LOG_RING_SIZE bytes, dropping the oldest records when full. Formatting
+// happens later and only for records somebody reads:
+//   - update() echoes new records to the serial console, but only as much
+//     as the TX FIFO accepts without blocking;
+//   - /api/logs formats them on request;
+//   - with spill enabled, records are appended to LOG_DIR in batches so
+//     they survive a reboot.
+//
+// The format string must be a literal: only its address is stored. That
+// is also why spilled logs carry a build id and are only readable by the
+// same firmware build.
+//
+// Safe to call from other tasks (e.g. WiFi event handlers).
+class Logger {
+public:
+    Logger();
+
+    // Load levels/spill settings from NVS (LittleFS must be mounted for spill)
+    void begin();
+
+    // Call from loop() — console echo and flash spill
+    void update();
+
+    template <typename... Args>
+    void error(LogModule m, const char* fmt, const Args&... args) { _log(LogLevel::ERROR, m, fmt, args...); }
+    template <typename... Args>
+    void warn(LogModule m, const char* fmt, const Args&... args) { _log(LogLevel::WARN, m, fmt, args...); }
+    template <typename... Args>
+    void info(LogModule m, const char* fmt, const Args&... args) { _log(LogLevel::INFO, m, fmt, args...); }
+    template <typename... Args>
+    void debug(LogModule m, const char* fmt, const Args&... args) { _log(LogLevel::DEBUG, m, fmt, args...); }
+
+    bool enabled(LogLevel level, LogModule m) const {
+        return (uint8_t)level <= _levels[(uint8_t)m];
+    }
+
+    // Runtime levels (persisted to NVS)
+    void setLevel(LogLevel level);                 // All modules
+    void setLevel(LogModule m, LogLevel level);
+    LogLevel getLevel(LogModule m) const;
+
+    // Keep records on flash as well (persisted to NVS)
+    void setSpill(bool enabled);
+    bool getSpill() const;
+
+    // Append formatted records with sequence number >= since to out;
+    // returns the sequence number to ask for next time
+    uint32_t readText(uint32_t since, String& out, LogLevel maxLevel = LogLevel::DEBUG);
+
+    // Format the spilled records on flash (previous file first)
+    void readSpill(String& out);
+
+    uint32_t getDropped() const;
+    uint32_t getNextSeq() const;
+
+    static const char* name(LogModule m);
+    static const char* name(LogLevel level);
+    static bool parseLevel(const String& s, LogLevel& level);
+    static bool parseModule(const String& s, LogModule& m);
+
+private:
+    struct Cursor {
+        uint32_t seq;
+        uint32_t offset;
+    };
+
+    uint8_t _ring[LOG_RING_SIZE];
+    uint32_t _head;
+    uint32_t _tail;
+    uint32_t _used;
+    uint32_t _firstSeq;       // Sequence number of the record at _tail
+    uint32_t _nextSeq;
+    uint32_t _dropped;
+    uint8_t _levels[(uint8_t)LogModule::COUNT];
+    bool _spill;
+    uint32_t _buildId;
+    Cursor _console;
+    Cursor _spilled;
+    unsigned long _lastSpill;
+
+    template <typename... Args>
+    void _log(LogLevel level, LogModule m, const char* fmt, const Args&... args) {
+        if (!enabled(level, m)) return;
+        LogArgs a;
+        logEncode(a, args...);
+        _push(level, m, fmt, a);
+    }
+
+    void _push(LogLevel level, LogModule m, const char* fmt, const LogArgs& args);
+    bool _next(Cursor& c, uint8_t* rec);
+    void _copyOut(uint32_t offset, uint8_t* dst, size_t n) const;
+    void _saveLevels();
+    void _spillPending();
+    static size_t _format(const uint8_t* rec, char* out, size_t cap);
+    static int _formatSpec(char* out, size_t cap, char* spec, size_t specLen, const char* suffix, ...);
+    static uint32_t _computeBuildId();
+};
+
+extern Logger Log;
+
+#endif // LOGGER_H
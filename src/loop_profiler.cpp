@@ -0,0 +1,81 @@
+#include "loop_profiler.h"
+#include "config.h"
+#include "logger.h"
+
+static const char* const SECTION_NAMES[] = {
+    "loadgen",
+    "serial",
+    "commands",
+    "wifi",
+    "uploader",
+    "live",
+    "web",
+    "log",
+};
+
+LoopProfiler::LoopProfiler()
+    : _stallUs(0)
+    , _loopStart(0)
+    , _since(0) {
+    setBaud(RS232_BAUD);
+}
+
+void LoopProfiler::setBaud(uint32_t baud) {
+    // 10 bits per character (start + 8 data + stop)
+    _stallUs = (uint64_t)UART_FIFO_BYTES * 10 * 1000000UL / baud;
+}
+
+void LoopProfiler::beginLoop() {
+    _loopStart = micros();
+}
+
+void LoopProfiler::endLoop() {
+    _accumulate(_loop, micros() - _loopStart);
+}
+
+void LoopProfiler::reset() {
+    for (auto& s : _sections) s = SectionStats();
+    _loop = SectionStats();
+    _since = millis();
+}
+
+const char* LoopProfiler::name(LoopSection section) {
+    return SECTION_NAMES[(size_t)section];
+}
+
+const SectionStats& LoopProfiler::getSection(LoopSection section) const {
+    return _sections[(size_t)section];
+}
+
+const SectionStats& LoopProfiler::getLoop() const {
+    return _loop;
+}
+
+uint32_t LoopProfiler::getStallThresholdUs() const {
+    return _stallUs;
+}
+
+unsigned long LoopProfiler::getSince() const {
+    return _since;
+}
+
+void LoopProfiler::_record(LoopSection section, uint32_t us) {
+    SectionStats& s = _sections[(size_t)section];
+    _accumulate(s, us);
+    if (us >= _stallUs && s.stalls <= LOOP_STALL_LOG_LIMIT) {
+        Log.warn(LogModule::PROFILE, "%s stalled loop for %lu ms",
+                 name(section), (unsigned long)(us / 1000));
+    }
+}
+
+void LoopProfiler::_accumulate(SectionStats& s, uint32_t us) {
+    s.calls++;
+    s.totalUs += us;
+    if (us > s.maxUs) {
+        s.maxUs = us;
+        s.maxAt = millis();
+    }
+    if (us >= _stallUs) {
+        s.stalls++;
+    }
+}
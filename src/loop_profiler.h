@@ -0,0 +1,74 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+
+// Subsystems called from loop(), in call order
+enum class LoopSection : uint8_t {
+    LOAD_GEN,       // Synthetic capture bytes, kept out of SERIAL_COMM
+    SERIAL_COMM,
+    COMMANDS,
+    WIFI,
+    UPLOADER,
+    LIVE_STREAM,
+    WEB_SERVER,
+    LOG,
+    COUNT
+};
+
+struct SectionStats {
+    uint32_t calls = 0;
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;          // Worst single call
+    unsigned long maxAt = 0;     // millis() when the worst call ended
+    uint32_t stalls = 0;         // Calls longer than the stall threshold
+};
+
+// Accumulates time spent in each loop() subsystem so dropped bytes can be
+// pinned on a specific blocking call.
+//
+// A stall is anything longer than it takes one UART FIFO to fill at the
+// current baud rate — past that point the 920i's bytes are only safe if
+// the driver's ring buffer catches them.
+class LoopProfiler {
+public:
+    LoopProfiler();
+
+    // Set the baud rate the stall threshold is derived from: the fastest
+    // channel's, whose FIFO fills first
+    void setBaud(uint32_t baud);
+
+    // Bracket each pass through loop()
+    void beginLoop();
+    void endLoop();
+
+    // Time one subsystem call
+    template <typename F>
+    void run(LoopSection section, F fn) {
+        uint32_t start = micros();
+        fn();
+        _record(section, micros() - start);
+    }
+
+    // Clear all counters
+    void reset();
+
+    static const char* name(LoopSection section);
+
+    const SectionStats& getSection(LoopSection section) const;
+    const SectionStats& getLoop() const;
+    uint32_t getStallThresholdUs() const;
+    unsigned long getSince() const;
+
+private:
+    SectionStats _sections[(size_t)LoopSection::COUNT];
+    SectionStats _loop;          // Whole loop() passes
+    uint32_t _stallUs;
+    uint32_t _loopStart;
+    unsigned long _since;        // millis() of the last reset
+
+    void _record(LoopSection section, uint32_t us);
+    void _accumulate(SectionStats& s, uint32_t us);
+};
+
+#endif // LOOP_PROFILER_H
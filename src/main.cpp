@@ -1,32 +1,139 @@
 #include <Arduino.h>
 #include "config.h"
+#include "logger.h"
+#include "persistent_state.h"
+#include "device_id.h"
 #include "serial_comm.h"
+#include "dump_filter.h"
+#include "uart_trace.h"
 #include "wifi_manager.h"
 #include "data_uploader.h"
+#include "live_stream.h"
+#include "command_scheduler.h"
+#include "loop_profiler.h"
+#include "status_json.h"
+#include "load_generator.h"
 #include "dashboard.h"
 #include <WebServer.h>
 #include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <algorithm>
 
-SerialComm serialComm;
+// Channel 1 is the primary 920i port: commands and live streaming use it
+SerialComm serialComm(1, RS232_UART_NUM, RS232_RX_PIN, RS232_TX_PIN, RS232_BAUD, RS232_CONFIG,
+                      RS232_RTS_PIN, RS232_CTS_PIN);
+#if SERIAL_CHANNELS > 1
+SerialComm serialComm2(2, RS232_2_UART_NUM, RS232_2_RX_PIN, RS232_2_TX_PIN, RS232_2_BAUD, RS232_2_CONFIG,
+                       RS232_2_RTS_PIN, RS232_2_CTS_PIN);
+#endif
+SerialComm* const channels[SERIAL_CHANNELS] = {
+    &serialComm,
+#if SERIAL_CHANNELS > 1
+    &serialComm2,
+#endif
+};
 WiFiManager wifiMgr;
 DataUploader uploader;
+LiveStream liveStream;
+CommandScheduler commands(serialComm);
+LoopProfiler profiler;
+LoadGenerator loadGen;
+UartTrace uartTrace;
 WebServer server(WEB_SERVER_PORT);
 
-void onDumpReceived(const String& data, size_t length) {
-    Serial.printf("[main] Dump received: %u bytes\n", length);
+// One rule set for every channel (/api/filter)
+FilterRules filterRules;
+uint32_t filterBytesIn = 0;       // Since boot, before and after filtering
+uint32_t filterBytesOut = 0;
+uint32_t filterLinesDropped = 0;
+
+// Ids of the raw dumps in RAW_DIR, oldest first
+std::vector<uint32_t> listRawDumps() {
+    std::vector<uint32_t> ids;
+    File dir = LittleFS.open(RAW_DIR);
+    if (dir && dir.isDirectory()) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            String name = String(entry.name());
+            if (name.endsWith(".tsv")) {
+                uint32_t id = name.substring(name.lastIndexOf('/') + 1).toInt();
+                if (id > 0) ids.push_back(id);
+            }
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+String rawDumpPath(uint32_t id) {
+    return String(RAW_DIR) + "/" + String(id) + ".tsv";
+}
+
+// File the unfiltered copy under the id the dump was queued as
+void keepRawDump(const String& path, uint32_t id) {
+    if (!LittleFS.rename(path, rawDumpPath(id))) {
+        Log.warn(LogModule::MAIN, "Can't keep raw dump #%u", id);
+        return;
+    }
+    std::vector<uint32_t> ids = listRawDumps();
+    for (size_t i = 0; i + RAW_KEEP < ids.size(); i++) {
+        LittleFS.remove(rawDumpPath(ids[i]));
+    }
+}
+
+void onDumpReceived(const String& data, size_t length, const DumpMeta& meta) {
+    Log.info(LogModule::MAIN, "Dump received on channel %u: %u bytes", meta.channel, length);
 
     String ts = wifiMgr.isTimeSynced()
         ? wifiMgr.getTimestamp()
         : String("boot+") + String(millis() / 1000) + "s";
 
-    uploader.submitDump(data, length, ts);
+    // Pipeline timings for /api/test-dump runs
+    bool synthetic = loadGen.isCapturing(meta.channel);
+    if (synthetic) loadGen.dumpCaptured();
+
+    if (meta.spillPath.length() > 0) {
+        uploader.submitFile(meta.spillPath, length, ts, meta.crc32, meta.channel, meta.summary);
+    } else {
+        uploader.submitDump(data, length, ts, meta.crc32, meta.channel, meta.summary);
+    }
+
+    filterBytesIn += meta.rawBytes;
+    filterBytesOut += length;
+    filterLinesDropped += meta.linesDropped;
+    if (meta.rawPath.length() > 0) keepRawDump(meta.rawPath, uploader.getLastDump().id);
+
+    if (synthetic) loadGen.dumpSubmitted(uploader.getLastDump().uploaded);
+}
+
+void onReadingReceived(const String& reading) {
+    liveStream.publish(reading);
 }
 
 void handleRoot() {
     server.send_P(200, "text/html", DASHBOARD_HTML);
 }
 
-void handleStatus() {
+const char* flowName(FlowControl flow) {
+    switch (flow) {
+        case FlowControl::RTS_CTS:  return "rts";
+        case FlowControl::XON_XOFF: return "xon";
+        default:                    return "none";
+    }
+}
+
+void addFlowJson(JsonObject o, const SerialComm* ch) {
+    FlowStats fs = ch->getFlowStats();
+    o["mode"] = flowName(ch->getFlowControl());
+    o["throttled"] = ch->isThrottled();
+    o["throttles"] = fs.throttles;
+    o["throttled_ms"] = fs.throttledMs;
+    o["splits"] = fs.splits;
+}
+
+String buildStatusJson() {
     JsonDocument doc;
 
     const char* mode = "unknown";
@@ -37,33 +144,97 @@ void handleStatus() {
         case WiFiMode::DISCONNECTED: mode = "disconnected"; break;
     }
 
+    doc["device_id"] = deviceId();
     doc["wifi_mode"] = mode;
     doc["ip"] = wifiMgr.getIP();
     doc["ssid"] = wifiMgr.getSSID();
     doc["time_synced"] = wifiMgr.isTimeSynced();
     doc["uptime"] = millis() / 1000;
-    doc["dump_count"] = serialComm.getDumpCount();
 
-    const UploadStats& stats = uploader.getStats();
-    doc["upload_success"] = stats.totalSuccess;
-    doc["upload_failed"] = stats.totalFailed;
-    doc["queue_depth"] = stats.queueDepth;
-    doc["last_upload_time"] = stats.lastUploadTime;
-    doc["receiver_url"] = stats.receiverUrl;
-
-    const DumpRecord& ld = uploader.getLastDump();
-    if (ld.id > 0) {
-        JsonObject last = doc["last_dump"].to<JsonObject>();
-        last["id"] = ld.id;
-        last["timestamp"] = ld.timestamp;
-        last["size"] = ld.size;
-        last["uploaded"] = ld.uploaded;
-        last["preview"] = ld.preview;
+    // Totals across all channels; per-channel detail below
+    uint32_t dumps = 0;
+    UartErrorStats ue;
+    for (SerialComm* ch : channels) {
+        const UartErrorStats& e = ch->getUartErrors();
+        dumps += ch->getDumpCount();
+        ue.framing += e.framing;
+        ue.parity += e.parity;
+        ue.overflow += e.overflow;
+        ue.breaks += e.breaks;
+    }
+    doc["dump_count"] = dumps;
+    JsonObject uart = doc["uart_errors"].to<JsonObject>();
+    uart["framing"] = ue.framing;
+    uart["parity"] = ue.parity;
+    uart["overflow"] = ue.overflow;
+    uart["break"] = ue.breaks;
+
+    if (SERIAL_CHANNELS > 1) {
+        JsonArray chans = doc["channels"].to<JsonArray>();
+        for (SerialComm* ch : channels) {
+            JsonObject o = chans.add<JsonObject>();
+            o["channel"] = ch->getChannel();
+            o["baud"] = ch->getBaud();
+            o["mode"] = ch->getMode() == CaptureMode::STREAM ? "stream" : "dump";
+            o["dumps"] = ch->getDumpCount();
+            o["uart_errors"] = ch->getUartErrors().total();
+            o["receiving"] = ch->getState() == CaptureState::RECEIVING;
+            addFlowJson(o["flow"].to<JsonObject>(), ch);
+        }
+    }
+
+    doc["capture_mode"] = serialComm.getMode() == CaptureMode::STREAM ? "stream" : "dump";
+    addFlowJson(doc["flow"].to<JsonObject>(), &serialComm);
+
+    if (serialComm.getMode() == CaptureMode::STREAM) {
+        const LiveStreamStats& ls = liveStream.getStats();
+        JsonObject live = doc["live"].to<JsonObject>();
+        live["port"] = LIVE_STREAM_PORT;
+        live["readings"] = serialComm.getReadingCount();
+        live["last"] = serialComm.getLastReading();
+        live["sent"] = ls.sent;
+        live["coalesced"] = ls.coalesced;
+        live["clients"] = ls.clients;
     }
 
+    const UploadStats& stats = uploader.getStats();
+    addUploadStatus(doc, stats, uploader.getLastDump());
+    doc["nvs_commits"] = State.getCommits();
+    doc["nvs_writes"] = State.getWrites();
+    const LinkQuality& lq = uploader.getLink();
+    JsonObject link = doc["link"].to<JsonObject>();
+    link["rssi"] = lq.getRssi();
+    link["throughput"] = lq.getThroughput();
+    link["rtt_ms"] = lq.getRtt();
+    link["connect_ms"] = lq.getConnectTime();
+    link["samples"] = lq.getSamples();
+    link["failures"] = lq.getFailures();
+    link["weak"] = lq.isWeak();
+    link["deferring"] = lq.deferBulk();
+    link["deferred"] = stats.deferred;
+    link["connect_timeout_ms"] = lq.connectTimeout();
+    link["response_timeout_ms"] = lq.responseTimeout();
+    link["chunk"] = lq.chunkSize();
+    JsonObject trace = doc["trace"].to<JsonObject>();
+    trace["on"] = uartTrace.isEnabled();
+    trace["bytes"] = uartTrace.getSize();
+    trace["records"] = uartTrace.getRecords();
+    trace["dropped"] = uartTrace.getDropped();
+    JsonObject filter = doc["filter"].to<JsonObject>();
+    filter["active"] = filterRules.active();
+    filter["bytes_in"] = filterBytesIn;
+    filter["bytes_out"] = filterBytesOut;
+    filter["lines_dropped"] = filterLinesDropped;
+    doc["delta_uploads"] = uploader.getDelta().getDeltaCount();
+    doc["delta_bytes_saved"] = uploader.getDelta().getBytesSaved();
+
     String json;
     serializeJson(doc, json);
-    server.send(200, "application/json", json);
+    return json;
+}
+
+void handleStatus() {
+    server.send(200, "application/json", buildStatusJson());
 }
 
 void handleSave() {
@@ -85,12 +256,375 @@ void handleSave() {
 void handleSetReceiver() {
     if (server.hasArg("url")) {
         uploader.setReceiverUrl(server.arg("url"));
+        liveStream.setTarget(uploader.getReceiverUrl());
         server.send(200, "text/plain", "OK");
     } else {
         server.send(400, "text/plain", "Missing url");
     }
 }
 
+void handleSetCaptureMode() {
+    // Optional ch=<n> selects the capture channel; defaults to channel 1
+    int ch = server.hasArg("ch") ? server.arg("ch").toInt() : 1;
+    if (ch < 1 || ch > SERIAL_CHANNELS) {
+        server.send(400, "text/plain", "Unknown channel");
+        return;
+    }
+    SerialComm* target = channels[ch - 1];
+
+    String mode = server.arg("mode");
+    if (mode == "stream") {
+        // Only channel 1 feeds the live stream (onReading, /api/status live)
+        if (target != &serialComm) {
+            server.send(400, "text/plain", "Stream mode is only available on channel 1");
+            return;
+        }
+        target->setMode(CaptureMode::STREAM);
+    } else if (mode == "dump") {
+        target->setMode(CaptureMode::DUMP);
+    } else {
+        server.send(400, "text/plain", "mode must be dump or stream");
+        return;
+    }
+    server.send(200, "text/plain", "OK");
+}
+
+void handleSetFlowControl() {
+    int ch = server.hasArg("ch") ? server.arg("ch").toInt() : 1;
+    if (ch < 1 || ch > SERIAL_CHANNELS) {
+        server.send(400, "text/plain", "Unknown channel");
+        return;
+    }
+    SerialComm* target = channels[ch - 1];
+
+    String mode = server.arg("mode");
+    FlowControl flow;
+    if (mode == "none") {
+        flow = FlowControl::NONE;
+    } else if (mode == "rts") {
+        flow = FlowControl::RTS_CTS;
+    } else if (mode == "xon") {
+        flow = FlowControl::XON_XOFF;
+    } else {
+        server.send(400, "text/plain", "mode must be none, rts or xon");
+        return;
+    }
+    if (!target->setFlowControl(flow)) {
+        server.send(409, "text/plain", flow == FlowControl::RTS_CTS
+            ? "No RTS pin wired on this channel" : "Channel is receive-only");
+        return;
+    }
+    server.send(200, "text/plain", "OK");
+}
+
+// "3,4,7" -> {3, 4, 7}; zero and junk entries are skipped
+std::vector<uint32_t> parseIds(const String& list) {
+    std::vector<uint32_t> ids;
+    int pos = 0;
+    while (pos < (int)list.length()) {
+        int comma = list.indexOf(',', pos);
+        if (comma < 0) comma = list.length();
+        uint32_t id = strtoul(list.substring(pos, comma).c_str(), nullptr, 10);
+        if (id > 0) ids.push_back(id);
+        pos = comma + 1;
+    }
+    return ids;
+}
+
+void handleDumps() {
+    // ?after=<id> is the receiver's cursor; ?limit=<n> caps the page
+    uint32_t after = strtoul(server.arg("after").c_str(), nullptr, 10);
+    long limit = server.hasArg("limit") ? server.arg("limit").toInt() : PULL_LIST_MAX;
+    limit = constrain(limit, 1L, (long)PULL_LIST_MAX);
+
+    JsonDocument doc;
+    doc["device"] = DEVICE_NAME;
+    doc["device_id"] = deviceId();
+    doc["queue_depth"] = uploader.getStats().queueDepth;
+    JsonArray arr = doc["dumps"].to<JsonArray>();
+    for (const QueuedDump& d : uploader.listQueued(after, limit)) {
+        JsonObject o = arr.add<JsonObject>();
+        o["id"] = d.id;
+        o["timestamp"] = d.timestamp;
+        o["size"] = d.size;
+        o["channel"] = d.channel;
+        char crcHex[9];
+        snprintf(crcHex, sizeof(crcHex), "%08x", d.crc);
+        o["crc32"] = crcHex;
+    }
+
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+void handleDump() {
+    // Same headers as a pushed upload, so the receiver stores it the same way
+    uint32_t id = strtoul(server.arg("id").c_str(), nullptr, 10);
+    QueuedDump d;
+    if (id == 0 || !uploader.findQueued(id, d)) {
+        server.send(404, "text/plain", "Not queued");
+        return;
+    }
+
+    char crcHex[9];
+    snprintf(crcHex, sizeof(crcHex), "%08x", d.crc);
+    server.sendHeader("X-Device-Name", DEVICE_NAME);
+    server.sendHeader("X-Device-Id", deviceId());
+    server.sendHeader("X-Timestamp", d.timestamp);
+    server.sendHeader("X-Dump-Id", String(d.id));
+    server.sendHeader("X-Channel", String(d.channel));
+    server.sendHeader("X-Content-CRC32", crcHex);
+    server.setContentLength(d.size);
+    server.send(200, "text/tab-separated-values", "");
+    WiFiClient client = server.client();
+    if (!uploader.writeQueued(id, client)) {
+        Log.warn(LogModule::WEB, "Dump #%u: short write to puller", id);
+    }
+}
+
+void handleDumpsAck() {
+    // ids=<id,id,...> were stored; bad=<id,...> failed the receiver's CRC check
+    uint32_t acked = 0;
+    for (uint32_t id : parseIds(server.arg("ids"))) {
+        if (uploader.ackQueued(id)) acked++;
+    }
+    for (uint32_t id : parseIds(server.arg("bad"))) {
+        uploader.rejectQueued(id);
+    }
+
+    JsonDocument doc;
+    doc["acked"] = acked;
+    doc["queue_depth"] = uploader.getStats().queueDepth;
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+void handleFilter() {
+    JsonDocument doc;
+    doc["drop"] = filterRules.drop;
+    doc["blank"] = filterRules.blank;
+    doc["columns"] = filterRules.columns;
+    doc["raw"] = filterRules.raw;
+    JsonArray raw = doc["raw_dumps"].to<JsonArray>();
+    for (uint32_t id : listRawDumps()) raw.add(id);
+
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+void handleSetFilter() {
+    // Omitted fields keep their current value; takes effect on the next dump
+    FilterRules rules = filterRules;
+    if (server.hasArg("drop")) rules.drop = server.arg("drop");
+    if (server.hasArg("columns")) rules.columns = server.arg("columns");
+    if (server.hasArg("blank")) rules.blank = server.arg("blank") == "1";
+    if (server.hasArg("raw")) rules.raw = server.arg("raw") == "1";
+
+    String error;
+    if (!FilterRules::validate(rules.drop, rules.columns, error)) {
+        server.send(400, "text/plain", error);
+        return;
+    }
+    filterRules = rules;
+    filterRules.save();
+    Log.info(LogModule::MAIN, "Dump filter: drop \"%s\", columns \"%s\"%s%s",
+             rules.drop.c_str(), rules.columns.c_str(),
+             rules.blank ? ", no blank lines" : "", rules.raw ? ", raw kept" : "");
+    server.send(200, "text/plain", "OK");
+}
+
+void handleRawDump() {
+    uint32_t id = strtoul(server.arg("id").c_str(), nullptr, 10);
+    File f = LittleFS.open(rawDumpPath(id), "r");
+    if (id == 0 || !f) {
+        server.send(404, "text/plain", "No raw dump");
+        return;
+    }
+    server.sendHeader("X-Dump-Id", String(id));
+    server.streamFile(f, "text/tab-separated-values");
+    f.close();
+}
+
+void handleTrace() {
+    size_t size = uartTrace.flush();
+    if (size == 0) {
+        server.send(404, "text/plain", "No trace recorded");
+        return;
+    }
+    server.sendHeader("Content-Disposition", "attachment; filename=\"trace.bin\"");
+    server.setContentLength(size);
+    server.send(200, "application/octet-stream", "");
+    WiFiClient client = server.client();
+    if (uartTrace.write(client) != size) {
+        Log.warn(LogModule::WEB, "Trace download cut short");
+    }
+}
+
+void handleSetTrace() {
+    if (server.arg("clear") == "1") uartTrace.clear();
+    if (server.hasArg("on")) uartTrace.setEnabled(server.arg("on") == "1");
+    server.send(200, "text/plain", "OK");
+}
+
+void handleCommand() {
+    if (!server.hasArg("cmd")) {
+        server.send(400, "text/plain", "Missing cmd");
+        return;
+    }
+    bool expectReply = server.arg("reply") != "0";
+    uint32_t id = commands.submit(server.arg("cmd"), expectReply);
+    if (id == 0) {
+        server.send(503, "text/plain", "Command queue full");
+        return;
+    }
+    server.send(200, "application/json", String("{\"id\":") + String(id) + "}");
+}
+
+void handleCommands() {
+    JsonDocument doc;
+    unsigned long now = millis();
+
+    doc["queued"] = commands.getQueuedCount();
+    doc["in_flight"] = commands.getInFlightCount();
+    doc["timeouts"] = commands.getTimeoutCount();
+    doc["schedule"] = commands.getScheduleSpec();
+
+    JsonArray sched = doc["schedules"].to<JsonArray>();
+    for (const auto& s : commands.getSchedules()) {
+        JsonObject o = sched.add<JsonObject>();
+        o["cmd"] = s.command;
+        o["interval_ms"] = s.intervalMs;
+        o["last_reply"] = s.lastReply;
+        if (s.lastReplyAt > 0) o["age_s"] = (now - s.lastReplyAt) / 1000;
+    }
+
+    JsonArray hist = doc["history"].to<JsonArray>();
+    const auto& history = commands.getHistory();
+    for (auto it = history.rbegin(); it != history.rend(); ++it) {
+        JsonObject o = hist.add<JsonObject>();
+        o["id"] = it->id;
+        o["cmd"] = it->command;
+        o["status"] = it->status == CommandStatus::DONE ? "done" : "timeout";
+        o["reply"] = it->reply;
+        if (it->sentAt > 0) o["latency_ms"] = it->doneAt - it->sentAt;
+    }
+
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+void handleProfile() {
+    JsonDocument doc;
+    unsigned long now = millis();
+
+    const SectionStats& lp = profiler.getLoop();
+    doc["window_s"] = (now - profiler.getSince()) / 1000;
+    doc["stall_us"] = profiler.getStallThresholdUs();
+    doc["loops"] = lp.calls;
+    doc["loop_avg_us"] = lp.calls ? (uint32_t)(lp.totalUs / lp.calls) : 0;
+    doc["loop_max_us"] = lp.maxUs;
+    doc["loop_max_age_s"] = lp.calls ? (now - lp.maxAt) / 1000 : 0;
+    doc["loop_stalls"] = lp.stalls;
+
+    JsonArray sections = doc["sections"].to<JsonArray>();
+    for (uint8_t i = 0; i < (uint8_t)LoopSection::COUNT; i++) {
+        LoopSection sec = (LoopSection)i;
+        const SectionStats& s = profiler.getSection(sec);
+        JsonObject o = sections.add<JsonObject>();
+        o["name"] = LoopProfiler::name(sec);
+        o["calls"] = s.calls;
+        o["total_ms"] = (uint32_t)(s.totalUs / 1000);
+        o["avg_us"] = s.calls ? (uint32_t)(s.totalUs / s.calls) : 0;
+        o["max_us"] = s.maxUs;
+        o["max_age_s"] = s.calls ? (now - s.maxAt) / 1000 : 0;
+        o["stalls"] = s.stalls;
+    }
+
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+void handleProfileReset() {
+    profiler.reset();
+    server.send(200, "text/plain", "OK");
+}
+
+void handleLogs() {
+    // ?since=<seq> returns only newer records; ?flash=1 reads the spill files
+    String out;
+    if (server.arg("flash") == "1") {
+        Log.readSpill(out);
+        server.send(200, "text/plain", out);
+        return;
+    }
+
+    LogLevel maxLevel = LogLevel::DEBUG;
+    if (server.hasArg("level") && !Logger::parseLevel(server.arg("level"), maxLevel)) {
+        server.send(400, "text/plain", "level must be error, warn, info or debug");
+        return;
+    }
+    uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+    uint32_t next = Log.readText(since, out, maxLevel);
+    server.sendHeader("X-Log-Next", String(next));
+    server.send(200, "text/plain", out);
+}
+
+void handleLogConfig() {
+    JsonDocument doc;
+    doc["spill"] = Log.getSpill();
+    doc["dropped"] = Log.getDropped();
+    JsonObject levels = doc["levels"].to<JsonObject>();
+    for (uint8_t i = 0; i < (uint8_t)LogModule::COUNT; i++) {
+        LogModule m = (LogModule)i;
+        levels[Logger::name(m)] = Logger::name(Log.getLevel(m));
+    }
+
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+void handleSetLogConfig() {
+    if (server.hasArg("level")) {
+        LogLevel level;
+        if (!Logger::parseLevel(server.arg("level"), level)) {
+            server.send(400, "text/plain", "level must be error, warn, info or debug");
+            return;
+        }
+        if (server.hasArg("module")) {
+            LogModule m;
+            if (!Logger::parseModule(server.arg("module"), m)) {
+                server.send(400, "text/plain", "Unknown module");
+                return;
+            }
+            Log.setLevel(m, level);
+        } else {
+            Log.setLevel(level);
+        }
+    }
+    if (server.hasArg("spill")) {
+        Log.setSpill(server.arg("spill") == "1");
+    }
+    server.send(200, "text/plain", "OK");
+}
+
+void handleSetSchedule() {
+    if (!server.hasArg("sched")) {
+        server.send(400, "text/plain", "Missing sched");
+        return;
+    }
+    if (commands.setSchedules(server.arg("sched"))) {
+        server.send(200, "text/plain", "OK");
+    } else {
+        server.send(400, "text/plain", "Format: CMD@ms;CMD@ms (min 1000 ms, max 8)");
+    }
+}
+
 void handleClearWifi() {
     wifiMgr.clearCredentials();
     server.send(200, "text/html",
@@ -101,24 +635,111 @@ void handleClearWifi() {
         "</body></html>");
 }
 
+const char* authName(wifi_auth_mode_t auth) {
+    switch (auth) {
+        case WIFI_AUTH_OPEN:            return "open";
+        case WIFI_AUTH_WEP:             return "wep";
+        case WIFI_AUTH_WPA_PSK:         return "wpa";
+        case WIFI_AUTH_WPA2_PSK:        return "wpa2";
+        case WIFI_AUTH_WPA_WPA2_PSK:    return "wpa/wpa2";
+        case WIFI_AUTH_WPA2_ENTERPRISE: return "wpa2-enterprise";
+        case WIFI_AUTH_WPA3_PSK:        return "wpa3";
+        case WIFI_AUTH_WPA2_WPA3_PSK:   return "wpa2/wpa3";
+        default:                        return "other";
+    }
+}
+
+void handleScan() {
+    // Cached results; POST /api/scan refreshes them in the background
+    JsonDocument doc;
+    doc["scanning"] = wifiMgr.isScanning();
+    unsigned long at = wifiMgr.getScanTime();
+    if (at != 0) doc["age_s"] = (millis() - at) / 1000;
+    JsonArray arr = doc["networks"].to<JsonArray>();
+    for (const ScanResult& r : wifiMgr.getScanResults()) {
+        JsonObject o = arr.add<JsonObject>();
+        o["ssid"] = r.ssid;
+        o["rssi"] = r.rssi;
+        o["channel"] = r.channel;
+        o["auth"] = authName(r.auth);
+    }
+
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+void handleStartScan() {
+    unsigned long at = wifiMgr.getScanTime();
+    if (wifiMgr.startScan()) {
+        server.send(202, "text/plain", "Scanning");
+    } else if (at != 0 && millis() - at < WIFI_SCAN_MIN_INTERVAL_MS) {
+        server.send(200, "text/plain", "Recent results kept");
+    } else {
+        server.send(503, "text/plain", "Scan failed to start");
+    }
+}
+
+void sendLoadStatus(int code) {
+    JsonDocument doc;
+    const LoadGenParams& p = loadGen.getParams();
+    doc["running"] = loadGen.isRunning();
+    doc["channel"] = loadGen.getChannel();
+    doc["rows"] = p.rows;
+    doc["count"] = p.count;
+    doc["interval_ms"] = p.intervalMs;
+    doc["rate"] = p.rate;
+
+    JsonArray results = doc["results"].to<JsonArray>();
+    for (const LoadGenResult& r : loadGen.getResults()) {
+        JsonObject o = results.add<JsonObject>();
+        o["bytes"] = r.bytes;
+        o["feed_ms"] = r.feedMs;
+        o["close_ms"] = r.closeMs;
+        o["submit_ms"] = r.submitMs;
+        o["uploaded"] = r.uploaded;
+    }
+
+    String json;
+    serializeJson(doc, json);
+    server.send(code, "application/json", json);
+}
+
 void handleTestDump() {
-    // Simulate a 920i print dump for testing without the machine
-    static const char TEST_DATA[] =
-        "920i Print Output\r\n"
-        "Date: 2026-02-18\r\n"
-        "Time: 10:30:00\r\n"
-        "\r\n"
-        "ID\tGross\tTare\tNet\tUnit\r\n"
-        "1\t1250.5\t120.0\t1130.5\tlb\r\n"
-        "2\t2340.0\t120.0\t2220.0\tlb\r\n"
-        "3\t985.5\t120.0\t865.5\tlb\r\n"
-        "4\t3100.0\t120.0\t2980.0\tlb\r\n"
-        "5\t1875.0\t120.0\t1755.0\tlb\r\n";
-
-    String data(TEST_DATA);
-    Serial.println("[Test] Simulating dump...");
-    onDumpReceived(data, data.length());
-    server.send(200, "text/plain", "Test dump submitted");
+    // Synthetic 920i output, fed through the capture path as if it came
+    // off the UART. No arguments: one 5-row dump, as before.
+    LoadGenParams p;
+    if (server.hasArg("rows")) {
+        p.rows = server.arg("rows").toInt();
+    } else if (server.hasArg("size")) {
+        p.rows = SyntheticDump::rowsForSize(server.arg("size").toInt());
+    }
+    if (server.hasArg("count")) p.count = server.arg("count").toInt();
+    if (server.hasArg("interval")) p.intervalMs = server.arg("interval").toInt();
+    if (server.hasArg("rate")) p.rate = server.arg("rate").toInt();
+    if (server.hasArg("seed")) p.seed = server.arg("seed").toInt();
+
+    long ch = server.hasArg("ch") ? server.arg("ch").toInt() : 1;
+    if (ch < 1 || ch > SERIAL_CHANNELS) {
+        server.send(400, "text/plain", "Unknown channel");
+        return;
+    }
+
+    String error;
+    if (!loadGen.start(channels[ch - 1], p, error)) {
+        server.send(409, "text/plain", error);
+        return;
+    }
+    sendLoadStatus(202);
+}
+
+void handleLoadStatus() {
+    sendLoadStatus(200);
+}
+
+void handleLoadStop() {
+    loadGen.stop();
+    sendLoadStatus(200);
 }
 
 void handleNotFound() {
@@ -131,8 +752,30 @@ void setupWebServer() {
     server.on("/api/status", HTTP_GET, handleStatus);
     server.on("/save", HTTP_POST, handleSave);
     server.on("/api/set-receiver", HTTP_POST, handleSetReceiver);
+    server.on("/api/set-capture-mode", HTTP_POST, handleSetCaptureMode);
+    server.on("/api/set-flow-control", HTTP_POST, handleSetFlowControl);
+    server.on("/api/dumps", HTTP_GET, handleDumps);
+    server.on("/api/dump", HTTP_GET, handleDump);
+    server.on("/api/dumps/ack", HTTP_POST, handleDumpsAck);
+    server.on("/api/filter", HTTP_GET, handleFilter);
+    server.on("/api/filter", HTTP_POST, handleSetFilter);
+    server.on("/api/raw", HTTP_GET, handleRawDump);
+    server.on("/api/trace", HTTP_GET, handleTrace);
+    server.on("/api/trace", HTTP_POST, handleSetTrace);
+    server.on("/api/command", HTTP_POST, handleCommand);
+    server.on("/api/commands", HTTP_GET, handleCommands);
+    server.on("/api/command-schedule", HTTP_POST, handleSetSchedule);
+    server.on("/api/profile", HTTP_GET, handleProfile);
+    server.on("/api/profile-reset", HTTP_POST, handleProfileReset);
+    server.on("/api/logs", HTTP_GET, handleLogs);
+    server.on("/api/log-config", HTTP_GET, handleLogConfig);
+    server.on("/api/log-config", HTTP_POST, handleSetLogConfig);
     server.on("/api/clear-wifi", HTTP_POST, handleClearWifi);
+    server.on("/api/scan", HTTP_GET, handleScan);
+    server.on("/api/scan", HTTP_POST, handleStartScan);
     server.on("/api/test-dump", HTTP_POST, handleTestDump);
+    server.on("/api/test-dump", HTTP_GET, handleLoadStatus);
+    server.on("/api/test-dump-stop", HTTP_POST, handleLoadStop);
     // Captive portal detection — serve dashboard directly (no redirect)
     server.on("/generate_204", HTTP_GET, handleRoot);
     server.on("/hotspot-detect.html", HTTP_GET, handleRoot);
@@ -140,34 +783,66 @@ void setupWebServer() {
     server.onNotFound(handleNotFound);
 
     server.begin();
-    Serial.printf("[Web] Server started on port %d\n", WEB_SERVER_PORT);
+    Log.info(LogModule::WEB, "Server started on port %d", WEB_SERVER_PORT);
 }
 
 void setup() {
+    // Room for the log echo, so Log.update() never waits on the UART/USB
+    Serial.setTxBufferSize(LOG_CONSOLE_TX_BUFFER);
     Serial.begin(115200);
     delay(2000);  // Wait for serial monitor to connect
-    Serial.println("\n[brakeMachine] Starting...");
+    Log.info(LogModule::MAIN, "Starting...");
 
     pinMode(STATUS_LED_PIN, OUTPUT);
 
-    serialComm.onDumpComplete(onDumpReceived);
-    serialComm.begin();
+    State.begin();   // Before anything reads its settings
+    filterRules.load();
+
+    for (SerialComm* ch : channels) {
+        ch->setFilter(&filterRules);
+        ch->setTrace(&uartTrace);
+        ch->onDumpComplete(onDumpReceived);
+        ch->begin();
+        // A stream mode saved by older firmware would drop every reading
+        if (ch != &serialComm && ch->getMode() == CaptureMode::STREAM) {
+            ch->setMode(CaptureMode::DUMP);
+        }
+    }
+    serialComm.onReading(onReadingReceived);
+    commands.begin();
+
+    uint32_t fastest = 0;
+    for (SerialComm* ch : channels) fastest = max(fastest, ch->getBaud());
+    profiler.setBaud(fastest);
 
     wifiMgr.begin();
 
     uploader.setConnectivityCheck([]() {
         return wifiMgr.getMode() == WiFiMode::CONNECTED;
     });
+    uploader.setStatusProvider(buildStatusJson);
     uploader.begin();
+    Log.begin();  // After LittleFS is mounted (flash spill)
+    uartTrace.begin();
+
+    liveStream.setTarget(uploader.getReceiverUrl());
+    liveStream.begin();
 
     setupWebServer();
 
-    Serial.println("[brakeMachine] Ready.");
+    profiler.reset();
+    Log.info(LogModule::MAIN, "Ready.");
 }
 
 void loop() {
-    serialComm.update();
-    wifiMgr.update();
-    uploader.update();
-    server.handleClient();
+    profiler.beginLoop();
+    profiler.run(LoopSection::LOAD_GEN,    [] { loadGen.update(); });
+    profiler.run(LoopSection::SERIAL_COMM, [] { for (SerialComm* ch : channels) ch->update(); });
+    profiler.run(LoopSection::COMMANDS,    [] { commands.update(); });
+    profiler.run(LoopSection::WIFI,        [] { wifiMgr.update(); });
+    profiler.run(LoopSection::UPLOADER,    [] { uploader.update(); });
+    profiler.run(LoopSection::LIVE_STREAM, [] { liveStream.update(); });
+    profiler.run(LoopSection::WEB_SERVER,  [] { server.handleClient(); });
+    profiler.run(LoopSection::LOG,         [] { Log.update(); uartTrace.update(); State.update(); });
+    profiler.endLoop();
 }
@@ -0,0 +1,387 @@
+#include "mqtt_transport.h"
+#include "config.h"
+#include "logger.h"
+#include "device_id.h"
+
+// MQTT control packet types (upper nibble of the fixed header)
+static const uint8_t MQTT_CONNECT    = 0x10;
+static const uint8_t MQTT_CONNACK    = 0x20;
+static const uint8_t MQTT_PUBLISH    = 0x30;
+static const uint8_t MQTT_PUBACK     = 0x40;
+static const uint8_t MQTT_PINGREQ    = 0xC0;
+static const uint8_t MQTT_PINGRESP   = 0xD0;
+static const uint8_t MQTT_DISCONNECT = 0xE0;
+
+// Encode an MQTT "remaining length" varint; returns bytes written (max 4)
+static size_t _encodeLength(uint8_t* out, size_t len) {
+    size_t n = 0;
+    do {
+        uint8_t b = len % 128;
+        len /= 128;
+        if (len > 0) b |= 0x80;
+        out[n++] = b;
+    } while (len > 0 && n < 4);
+    return n;
+}
+
+// Append a length-prefixed UTF-8 string
+static size_t _putString(uint8_t* out, const String& s) {
+    out[0] = s.length() >> 8;
+    out[1] = s.length() & 0xFF;
+    memcpy(out + 2, s.c_str(), s.length());
+    return s.length() + 2;
+}
+
+MqttTransport::MqttTransport(const String& url)
+    : _port(MQTT_DEFAULT_PORT)
+    , _nextPacketId(1)
+    , _lastConnectAttempt(0)
+    , _reconnectInterval(MQTT_RECONNECT_INTERVAL_MS)
+    , _connectFailures(0)
+    , _lastActivity(0)
+    , _pingSentAt(0)
+    , _connected(false) {
+    _parseUrl(url);
+
+    // Client ID doubles as the per-device topic segment, so it must be
+    // unique across the fleet
+    _clientId = deviceId();
+    _topicBase = _topicBase + "/" + _clientId;
+}
+
+MqttTransport::~MqttTransport() {
+    _disconnect(true);
+}
+
+void MqttTransport::update() {
+    if (!_connected) {
+        // Keep the session up between dumps so the first publish after a
+        // quiet spell doesn't pay for the handshake.
+        _ensureConnected();
+        return;
+    }
+
+    if (!_client.connected()) {
+        Log.warn(LogModule::MQTT, "Connection lost");
+        _connected = false;
+        _client.stop();
+        return;
+    }
+
+    // Drain anything the broker sent (PINGRESP, stray PUBACKs)
+    uint8_t type;
+    uint8_t buf[8];
+    size_t len;
+    while (_readPacket(type, buf, sizeof(buf), len) > 0) {
+        if (type == MQTT_PINGRESP) _pingSentAt = 0;
+    }
+
+    unsigned long now = millis();
+    if (_pingSentAt > 0 && now - _pingSentAt > MQTT_ACK_TIMEOUT_MS) {
+        Log.warn(LogModule::MQTT, "Ping timeout, reconnecting");
+        _disconnect();
+        return;
+    }
+    if (_pingSentAt == 0 && now - _lastActivity > (MQTT_KEEPALIVE_S * 1000UL) / 2) {
+        uint8_t ping[2] = { MQTT_PINGREQ, 0 };
+        if (_writeAll(ping, sizeof(ping))) {
+            _pingSentAt = now;
+        } else {
+            _disconnect();
+        }
+    }
+}
+
+bool MqttTransport::send(const String& data, const String& timestamp, uint32_t id, uint32_t crc,
+                         uint8_t channel) {
+    if (!_ensureConnected()) return false;
+
+    // Same metadata line the on-disk queue uses, so consumers can parse
+    // either format with one reader.
+    char meta[112];
+    int metaLen = snprintf(meta, sizeof(meta), "# id=%u ts=%s sz=%u crc=%08x ch=%u\n",
+                           id, timestamp.c_str(), data.length(), crc, channel);
+
+    Log.info(LogModule::MQTT, "PUBLISH %u bytes to %s/dump", data.length(), _topicBase.c_str());
+    return _publish(_topicBase + "/dump", (const uint8_t*)meta, metaLen,
+                    (const uint8_t*)data.c_str(), data.length(), false, 1);
+}
+
+bool MqttTransport::sendFile(File& in, size_t length, const String& timestamp, uint32_t id,
+                             uint32_t crc, uint8_t channel) {
+    if (!_ensureConnected()) return false;
+
+    char meta[112];
+    int metaLen = snprintf(meta, sizeof(meta), "# id=%u ts=%s sz=%u crc=%08x ch=%u\n",
+                           id, timestamp.c_str(), length, crc, channel);
+
+    Log.info(LogModule::MQTT, "PUBLISH %u bytes from flash to %s/dump", length, _topicBase.c_str());
+    return _publish(_topicBase + "/dump", (const uint8_t*)meta, metaLen,
+                    nullptr, length, false, 1, &in);
+}
+
+bool MqttTransport::sendSummary(const String& json, const String& /*timestamp*/, uint32_t id,
+                                uint32_t /*crc*/, uint8_t /*channel*/) {
+    if (!_ensureConnected()) return false;
+
+    // The JSON carries id/ts/ch/crc itself, no metadata line needed
+    Log.info(LogModule::MQTT, "PUBLISH summary #%u to %s/summary", id, _topicBase.c_str());
+    return _publish(_topicBase + "/summary", nullptr, 0,
+                    (const uint8_t*)json.c_str(), json.length(), false, 1);
+}
+
+void MqttTransport::publishStatus(const String& json) {
+    if (!_connected) return;
+    _publish(_topicBase + "/status", nullptr, 0,
+             (const uint8_t*)json.c_str(), json.length(), true, 0);
+}
+
+void MqttTransport::_parseUrl(const String& url) {
+    // mqtt://[user:pass@]host[:port][/prefix]
+    String rest = url.substring(url.indexOf("://") + 3);
+
+    int slash = rest.indexOf('/');
+    String prefix = (slash >= 0) ? rest.substring(slash + 1) : String();
+    if (slash >= 0) rest = rest.substring(0, slash);
+    while (prefix.endsWith("/")) prefix = prefix.substring(0, prefix.length() - 1);
+    _topicBase = prefix.length() > 0 ? prefix : String(MQTT_TOPIC_PREFIX);
+
+    int at = rest.lastIndexOf('@');
+    if (at >= 0) {
+        String creds = rest.substring(0, at);
+        rest = rest.substring(at + 1);
+        int colon = creds.indexOf(':');
+        _user = (colon >= 0) ? creds.substring(0, colon) : creds;
+        _pass = (colon >= 0) ? creds.substring(colon + 1) : String();
+    }
+
+    int colon = rest.lastIndexOf(':');
+    if (colon >= 0) {
+        _host = rest.substring(0, colon);
+        _port = rest.substring(colon + 1).toInt();
+        if (_port == 0) _port = MQTT_DEFAULT_PORT;
+    } else {
+        _host = rest;
+    }
+}
+
+bool MqttTransport::_connect() {
+    _lastConnectAttempt = millis();
+    Log.info(LogModule::MQTT, "Connecting to %s:%u as %s", _host.c_str(), _port, _clientId.c_str());
+
+    _client.setTimeout(3);  // 3 second connect timeout
+    if (!_client.connect(_host.c_str(), _port)) {
+        Log.warn(LogModule::MQTT, "TCP connect failed");
+        return false;
+    }
+
+    String willTopic = _topicBase + "/status";
+    String willMsg = "{\"online\":false}";
+
+    // Clean session off: the broker keeps our session (and any QoS 1
+    // state) across reconnects.
+    uint8_t flags = 0x04 | 0x08 | 0x20;  // will, will QoS 1, will retain
+    size_t remaining = 10 + 2 + _clientId.length()
+                     + 2 + willTopic.length() + 2 + willMsg.length();
+    if (_user.length() > 0) {
+        flags |= 0x80;
+        remaining += 2 + _user.length();
+    }
+    if (_pass.length() > 0) {
+        flags |= 0x40;
+        remaining += 2 + _pass.length();
+    }
+
+    uint8_t pkt[512];
+    if (remaining + 5 > sizeof(pkt)) {
+        Log.warn(LogModule::MQTT, "CONNECT too large (credentials too long?)");
+        _client.stop();
+        return false;
+    }
+
+    size_t n = 0;
+    pkt[n++] = MQTT_CONNECT;
+    n += _encodeLength(pkt + n, remaining);
+    n += _putString(pkt + n, "MQTT");
+    pkt[n++] = 0x04;  // protocol level 3.1.1
+    pkt[n++] = flags;
+    pkt[n++] = MQTT_KEEPALIVE_S >> 8;
+    pkt[n++] = MQTT_KEEPALIVE_S & 0xFF;
+    n += _putString(pkt + n, _clientId);
+    n += _putString(pkt + n, willTopic);
+    n += _putString(pkt + n, willMsg);
+    if (_user.length() > 0) n += _putString(pkt + n, _user);
+    if (_pass.length() > 0) n += _putString(pkt + n, _pass);
+
+    if (!_writeAll(pkt, n)) {
+        _client.stop();
+        return false;
+    }
+
+    _connected = true;  // _waitForAck reads only while connected
+    if (!_waitForAck(MQTT_CONNACK, 0, MQTT_ACK_TIMEOUT_MS)) {
+        Log.warn(LogModule::MQTT, "No CONNACK from broker");
+        _connected = false;
+        _client.stop();
+        return false;
+    }
+
+    _lastActivity = millis();
+    _pingSentAt = 0;
+    Log.info(LogModule::MQTT, "Connected, topic base %s", _topicBase.c_str());
+    return true;
+}
+
+void MqttTransport::_disconnect(bool graceful) {
+    // Dropping without DISCONNECT makes the broker publish our last will
+    if (graceful && _connected) {
+        uint8_t pkt[2] = { MQTT_DISCONNECT, 0 };
+        _writeAll(pkt, sizeof(pkt));
+    }
+    _client.stop();
+    _connected = false;
+}
+
+bool MqttTransport::_ensureConnected() {
+    if (_connected && _client.connected()) return true;
+    _connected = false;
+    if (_host.length() == 0) return false;
+    if (_lastConnectAttempt != 0 && millis() - _lastConnectAttempt < _reconnectInterval) {
+        return false;
+    }
+    if (_connect()) {
+        _connectFailures = 0;
+        _reconnectInterval = MQTT_RECONNECT_INTERVAL_MS;
+        return true;
+    }
+
+    // Each attempt blocks loop() for up to the connect timeout, so back
+    // off while the broker stays down: 5s, 10s, 20s, max 5 minutes
+    if (_connectFailures < 16) _connectFailures++;
+    _reconnectInterval = min((unsigned long)MQTT_RECONNECT_INTERVAL_MS << _connectFailures,
+                             (unsigned long)MQTT_RECONNECT_MAX_MS);
+    Log.info(LogModule::MQTT, "Next connect attempt in %lus", _reconnectInterval / 1000);
+    return false;
+}
+
+bool MqttTransport::_publish(const String& topic, const uint8_t* header, size_t headerLen,
+                             const uint8_t* payload, size_t payloadLen, bool retain, uint8_t qos,
+                             File* in) {
+    uint16_t packetId = 0;
+    size_t remaining = 2 + topic.length() + headerLen + payloadLen;
+    if (qos > 0) {
+        remaining += 2;
+        packetId = _nextPacketId++;
+        if (_nextPacketId == 0) _nextPacketId = 1;
+    }
+
+    uint8_t pkt[16 + 256];
+    if (topic.length() > 256) return false;
+
+    size_t n = 0;
+    pkt[n++] = MQTT_PUBLISH | (qos << 1) | (retain ? 0x01 : 0x00);
+    n += _encodeLength(pkt + n, remaining);
+    n += _putString(pkt + n, topic);
+    if (qos > 0) {
+        pkt[n++] = packetId >> 8;
+        pkt[n++] = packetId & 0xFF;
+    }
+
+    // Payload is streamed straight from the caller's buffer (or file) —
+    // no copy of the dump is made to build the packet.
+    bool ok = _writeAll(pkt, n) && (headerLen == 0 || _writeAll(header, headerLen));
+    if (ok && in) {
+        uint8_t chunk[STREAM_CHUNK];
+        size_t left = payloadLen;
+        while (ok && left > 0) {
+            size_t r = in->read(chunk, min(left, sizeof(chunk)));
+            ok = r > 0 && _writeAll(chunk, r);
+            left -= r;
+        }
+    } else if (ok) {
+        ok = _writeAll(payload, payloadLen);
+    }
+    if (!ok) {
+        Log.warn(LogModule::MQTT, "Write failed");
+        _disconnect();
+        return false;
+    }
+
+    if (qos == 0) return true;
+
+    if (!_waitForAck(MQTT_PUBACK, packetId, MQTT_ACK_TIMEOUT_MS)) {
+        Log.warn(LogModule::MQTT, "No PUBACK for packet %u", packetId);
+        _disconnect();
+        return false;
+    }
+    return true;
+}
+
+bool MqttTransport::_waitForAck(uint8_t expectedType, uint16_t packetId, unsigned long timeoutMs) {
+    unsigned long start = millis();
+    uint8_t buf[8];
+    uint8_t type;
+    size_t len;
+
+    while (millis() - start < timeoutMs) {
+        int r = _readPacket(type, buf, sizeof(buf), len);
+        if (r < 0) return false;
+        if (r == 0) {
+            delay(5);
+            continue;
+        }
+
+        if (type == MQTT_PINGRESP) {
+            _pingSentAt = 0;
+        } else if (type == expectedType) {
+            if (expectedType == MQTT_CONNACK) {
+                // buf[1] is the return code; 0 = accepted
+                if (len >= 2 && buf[1] == 0) return true;
+                Log.warn(LogModule::MQTT, "CONNACK refused: %u", len >= 2 ? buf[1] : 255);
+                return false;
+            }
+            if (len >= 2 && ((buf[0] << 8) | buf[1]) == packetId) return true;
+        }
+    }
+    return false;
+}
+
+int MqttTransport::_readPacket(uint8_t& type, uint8_t* buf, size_t cap, size_t& len) {
+    if (!_connected || !_client.available()) return 0;
+
+    int b = _client.read();
+    if (b < 0) return 0;
+    type = b & 0xF0;
+
+    // Remaining length varint — the rest of the packet follows promptly
+    size_t remaining = 0;
+    size_t multiplier = 1;
+    for (int i = 0; i < 4; i++) {
+        uint8_t lb;
+        if (_client.readBytes(&lb, 1) != 1) return -1;
+        remaining += (lb & 0x7F) * multiplier;
+        multiplier *= 128;
+        if (!(lb & 0x80)) break;
+    }
+
+    len = 0;
+    while (len < remaining) {
+        uint8_t c;
+        if (_client.readBytes(&c, 1) != 1) return -1;
+        if (len < cap) buf[len] = c;
+        len++;
+    }
+    if (len > cap) len = cap;
+    return 1;
+}
+
+bool MqttTransport::_writeAll(const uint8_t* data, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        size_t n = _client.write(data + sent, len - sent);
+        if (n == 0) return false;
+        sent += n;
+    }
+    _lastActivity = millis();
+    return true;
+}
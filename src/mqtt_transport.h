@@ -0,0 +1,60 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include "upload_transport.h"
+#include <WiFi.h>
+
+// Minimal MQTT 3.1.1 client over one persistent TCP connection.
+//
+// URL form: mqtt://[user:pass@]host[:port][/topic-prefix]
+//
+// Dumps are published with QoS 1 to <prefix>/<client-id>/dump and only
+// count as delivered once the broker's PUBACK arrives. Their summaries go
+// the same way to <prefix>/<client-id>/summary. Device status is
+// published retained to <prefix>/<client-id>/status; the broker replaces
+// it with {"online":false} (last will) if the connection drops.
+class MqttTransport : public UploadTransport {
+public:
+    explicit MqttTransport(const String& url);
+    ~MqttTransport() override;
+
+    const char* name() const override { return "mqtt"; }
+    void update() override;
+    bool send(const String& data, const String& timestamp, uint32_t id, uint32_t crc,
+              uint8_t channel) override;
+    bool sendFile(File& in, size_t length, const String& timestamp, uint32_t id, uint32_t crc,
+                  uint8_t channel) override;
+    bool sendSummary(const String& json, const String& timestamp, uint32_t id, uint32_t crc,
+                     uint8_t channel) override;
+    void publishStatus(const String& json) override;
+
+private:
+    WiFiClient _client;
+    String _host;
+    uint16_t _port;
+    String _user;
+    String _pass;
+    String _clientId;
+    String _topicBase;
+    uint16_t _nextPacketId;
+    unsigned long _lastConnectAttempt;
+    unsigned long _reconnectInterval;
+    uint8_t _connectFailures;
+    unsigned long _lastActivity;
+    unsigned long _pingSentAt;
+    bool _connected;
+
+    void _parseUrl(const String& url);
+    bool _connect();
+    void _disconnect(bool graceful = false);
+    bool _ensureConnected();
+    // payload is read from in (payloadLen bytes) when in is given
+    bool _publish(const String& topic, const uint8_t* header, size_t headerLen,
+                  const uint8_t* payload, size_t payloadLen, bool retain, uint8_t qos,
+                  File* in = nullptr);
+    bool _waitForAck(uint8_t expectedType, uint16_t packetId, unsigned long timeoutMs);
+    int _readPacket(uint8_t& type, uint8_t* buf, size_t cap, size_t& len);
+    bool _writeAll(const uint8_t* data, size_t len);
+};
+
+#endif // MQTT_TRANSPORT_H
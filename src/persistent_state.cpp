@@ -0,0 +1,254 @@
+#include "persistent_state.h"
+#include "config.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <nvs_flash.h>
+#include <esp_system.h>
+
+PersistentState State;
+
+PersistentState::PersistentState()
+    : _dirty(false)
+    , _dirtySince(0)
+    , _commits(0)
+    , _writes(0) {
+}
+
+void PersistentState::begin() {
+    // A partition from another layout or IDF version can't be read at all
+    Preferences prefs;
+    if (!prefs.begin("wifi", false)) {
+        Log.error(LogModule::STATE, "NVS init failed, formatting...");
+        nvs_flash_erase();
+        nvs_flash_init();
+    } else {
+        prefs.end();
+    }
+
+    esp_register_shutdown_handler(_onShutdown);
+}
+
+void PersistentState::update() {
+    if (_dirty && millis() - _dirtySince >= STATE_COMMIT_DELAY_MS) {
+        commit();
+    }
+}
+
+void PersistentState::commit() {
+    if (!_dirty) return;
+
+    // One session per namespace, covering all of its dirty keys
+    uint32_t writes = 0;
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (!_entries[i].dirty) continue;
+
+        Preferences prefs;
+        prefs.begin(_entries[i].ns.c_str(), false);
+        for (size_t j = i; j < _entries.size(); j++) {
+            Entry& e = _entries[j];
+            if (!e.dirty || e.ns != _entries[i].ns) continue;
+
+            const char* key = e.key.c_str();
+            if (!e.exists) {
+                prefs.remove(key);
+            } else {
+                switch (e.type) {
+                    case Type::UINT:   prefs.putUInt(key, e.num); break;
+                    case Type::UCHAR:  prefs.putUChar(key, (uint8_t)e.num); break;
+                    case Type::BOOL:   prefs.putBool(key, e.num != 0); break;
+                    case Type::STRING: {
+                        String s;
+                        s.concat((const char*)e.blob.data(), e.blob.size());
+                        prefs.putString(key, s);
+                        break;
+                    }
+                    case Type::BYTES:  prefs.putBytes(key, e.blob.data(), e.blob.size()); break;
+                }
+            }
+            e.dirty = false;
+            writes++;
+        }
+        prefs.end();
+    }
+
+    _dirty = false;
+    _commits++;
+    _writes += writes;
+    Log.debug(LogModule::STATE, "Committed %u value(s)", writes);
+}
+
+uint32_t PersistentState::getUInt(const char* ns, const char* key, uint32_t def) {
+    Entry& e = _entry(ns, key, Type::UINT);
+    return e.exists ? e.num : def;
+}
+
+void PersistentState::setUInt(const char* ns, const char* key, uint32_t value) {
+    Entry& e = _entry(ns, key, Type::UINT);
+    if (e.exists && e.num == value) return;
+    e.num = value;
+    _markDirty(e);
+}
+
+uint8_t PersistentState::getUChar(const char* ns, const char* key, uint8_t def) {
+    Entry& e = _entry(ns, key, Type::UCHAR);
+    return e.exists ? (uint8_t)e.num : def;
+}
+
+void PersistentState::setUChar(const char* ns, const char* key, uint8_t value) {
+    Entry& e = _entry(ns, key, Type::UCHAR);
+    if (e.exists && e.num == value) return;
+    e.num = value;
+    _markDirty(e);
+}
+
+bool PersistentState::getBool(const char* ns, const char* key, bool def) {
+    Entry& e = _entry(ns, key, Type::BOOL);
+    return e.exists ? e.num != 0 : def;
+}
+
+void PersistentState::setBool(const char* ns, const char* key, bool value) {
+    Entry& e = _entry(ns, key, Type::BOOL);
+    if (e.exists && (e.num != 0) == value) return;
+    e.num = value ? 1 : 0;
+    _markDirty(e);
+}
+
+String PersistentState::getString(const char* ns, const char* key, const String& def) {
+    Entry& e = _entry(ns, key, Type::STRING);
+    if (!e.exists) return def;
+    String s;
+    s.concat((const char*)e.blob.data(), e.blob.size());
+    return s;
+}
+
+void PersistentState::setString(const char* ns, const char* key, const String& value) {
+    Entry& e = _entry(ns, key, Type::STRING);
+    const uint8_t* p = (const uint8_t*)value.c_str();
+    if (e.exists && e.blob.size() == value.length()
+        && memcmp(e.blob.data(), p, value.length()) == 0) return;
+    e.blob.assign(p, p + value.length());
+    _markDirty(e);
+}
+
+size_t PersistentState::getBytes(const char* ns, const char* key, void* buf, size_t len) {
+    Entry& e = _entry(ns, key, Type::BYTES);
+    if (!e.exists) return 0;
+    size_t n = min(len, e.blob.size());
+    memcpy(buf, e.blob.data(), n);
+    return n;
+}
+
+void PersistentState::setBytes(const char* ns, const char* key, const void* buf, size_t len) {
+    Entry& e = _entry(ns, key, Type::BYTES);
+    const uint8_t* p = (const uint8_t*)buf;
+    if (e.exists && e.blob.size() == len && memcmp(e.blob.data(), p, len) == 0) return;
+    e.blob.assign(p, p + len);
+    _markDirty(e);
+}
+
+void PersistentState::remove(const char* ns, const char* key) {
+    // The type only matters for a key that isn't cached yet
+    Entry& e = _entry(ns, key, Type::STRING);
+    if (!e.exists) return;
+    _markDirty(e);
+    e.exists = false;
+    e.blob.clear();
+}
+
+uint32_t PersistentState::nextId(const char* ns, const char* key) {
+    Sequence* seq = nullptr;
+    for (Sequence& s : _sequences) {
+        if (s.ns == ns && s.key == key) {
+            seq = &s;
+            break;
+        }
+    }
+    if (!seq) {
+        Sequence s;
+        s.ns = ns;
+        s.key = key;
+        s.next = max(getUInt(ns, key, 1), (uint32_t)1);
+        s.reserved = s.next;
+        _sequences.push_back(s);
+        seq = &_sequences.back();
+    }
+
+    if (seq->next >= seq->reserved) {
+        // Durable before any id of the block is handed out
+        seq->reserved = seq->next + STATE_ID_BLOCK;
+        setUInt(ns, key, seq->reserved);
+        commit();
+    }
+    return seq->next++;
+}
+
+uint32_t PersistentState::getCommits() const {
+    return _commits;
+}
+
+uint32_t PersistentState::getWrites() const {
+    return _writes;
+}
+
+PersistentState::Entry& PersistentState::_entry(const char* ns, const char* key, Type type) {
+    for (Entry& e : _entries) {
+        if (e.ns == ns && e.key == key) return e;
+    }
+
+    // First use: read through from NVS
+    Entry e;
+    e.ns = ns;
+    e.key = key;
+    e.type = type;
+    e.num = 0;
+    e.exists = false;
+    e.dirty = false;
+
+    Preferences prefs;
+    if (prefs.begin(ns, true)) {
+        if (prefs.isKey(key)) {
+            e.exists = true;
+            switch (type) {
+                case Type::UINT:  e.num = prefs.getUInt(key); break;
+                case Type::UCHAR: e.num = prefs.getUChar(key); break;
+                case Type::BOOL:  e.num = prefs.getBool(key) ? 1 : 0; break;
+                case Type::STRING: {
+                    String s = prefs.getString(key);
+                    const uint8_t* p = (const uint8_t*)s.c_str();
+                    e.blob.assign(p, p + s.length());
+                    break;
+                }
+                case Type::BYTES:
+                    e.blob.resize(prefs.getBytesLength(key));
+                    prefs.getBytes(key, e.blob.data(), e.blob.size());
+                    break;
+            }
+        }
+        prefs.end();
+    }
+
+    _entries.push_back(e);
+    return _entries.back();
+}
+
+void PersistentState::_markDirty(Entry& e) {
+    e.exists = true;
+    e.dirty = true;
+    if (!_dirty) _dirtySince = millis();
+    _dirty = true;
+}
+
+void PersistentState::_saveSequences() {
+    // Exact positions, so a clean restart doesn't skip ids. NVS then no
+    // longer covers the rest of the block: an id handed out after this
+    // reserves a new one first, so boot never reads back a used id.
+    for (Sequence& s : _sequences) {
+        setUInt(s.ns.c_str(), s.key.c_str(), s.next);
+        s.reserved = s.next;
+    }
+}
+
+void PersistentState::_onShutdown() {
+    State._saveSequences();
+    State.commit();
+}
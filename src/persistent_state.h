@@ -0,0 +1,91 @@
+#ifndef PERSISTENT_STATE_H
+#define PERSISTENT_STATE_H
+
+#include <Arduino.h>
+#include <vector>
+
+// The one owner of everything kept in NVS: configuration, counters, dump
+// ids and lifetime stats. Values are cached in RAM after the first read.
+// Writes only mark them dirty; dirty values are committed together, one
+// Preferences session per namespace, STATE_COMMIT_DELAY_MS after the
+// first change, on commit(), or from a shutdown handler before a restart.
+// A counter that changes with every dump then costs one NVS write per
+// commit window instead of one per dump.
+//
+// Namespaces and keys are the ones each module used on its own before, so
+// settings saved by older firmware carry over.
+class PersistentState {
+public:
+    PersistentState();
+
+    // Call first in setup() — initializes NVS, erasing it if unreadable
+    void begin();
+
+    // Call from loop() — commits once the oldest change is due
+    void update();
+
+    // Write all dirty values now. Configuration setters call this, so a
+    // settings change survives a power cut straight away.
+    void commit();
+
+    uint32_t getUInt(const char* ns, const char* key, uint32_t def = 0);
+    void setUInt(const char* ns, const char* key, uint32_t value);
+    uint8_t getUChar(const char* ns, const char* key, uint8_t def = 0);
+    void setUChar(const char* ns, const char* key, uint8_t value);
+    bool getBool(const char* ns, const char* key, bool def = false);
+    void setBool(const char* ns, const char* key, bool value);
+    String getString(const char* ns, const char* key, const String& def = String());
+    void setString(const char* ns, const char* key, const String& value);
+
+    // Copies up to len bytes; returns how many (0 if the key is missing)
+    size_t getBytes(const char* ns, const char* key, void* buf, size_t len);
+    void setBytes(const char* ns, const char* key, const void* buf, size_t len);
+
+    void remove(const char* ns, const char* key);
+
+    // Next value of a persistent id sequence (first id 1). NVS records
+    // only the end of a block of STATE_ID_BLOCK reserved ids, written when
+    // the block runs out; the exact position is saved before a restart.
+    // After a crash the rest of the block is skipped — ids never repeat.
+    uint32_t nextId(const char* ns, const char* key);
+
+    // Since boot, for /api/status
+    uint32_t getCommits() const;
+    uint32_t getWrites() const;
+
+private:
+    enum class Type : uint8_t { UINT, UCHAR, BOOL, STRING, BYTES };
+
+    struct Entry {
+        String ns;
+        String key;
+        Type type;
+        uint32_t num;
+        std::vector<uint8_t> blob;   // STRING (no terminator) and BYTES
+        bool exists;
+        bool dirty;
+    };
+
+    struct Sequence {
+        String ns;
+        String key;
+        uint32_t next;       // Next id to hand out
+        uint32_t reserved;   // First id not covered by NVS
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<Sequence> _sequences;
+    bool _dirty;
+    unsigned long _dirtySince;
+    uint32_t _commits;
+    uint32_t _writes;
+
+    Entry& _entry(const char* ns, const char* key, Type type);
+    void _markDirty(Entry& e);
+    void _saveSequences();
+    static void _onShutdown();
+};
+
+extern PersistentState State;
+
+#endif // PERSISTENT_STATE_H
@@ -0,0 +1,77 @@
+#include "queue_record.h"
+#include "config.h"
+#include "crc32.h"
+#include <LittleFS.h>
+
+bool writeQueueRecord(const String& path, const String& data, uint32_t id,
+                      const String& timestamp, uint32_t crc, uint8_t channel) {
+    File f = LittleFS.open(path, "w");
+    if (!f) return false;
+
+    // Metadata header line — stripped before retry upload
+    // crc is the capture-time CRC, so a mismatch on read-back means flash
+    // corruption rather than line noise
+    f.printf("# id=%u ts=%s sz=%u crc=%08x ch=%u\n", id, timestamp.c_str(), data.length(), crc, channel);
+    f.print(data);
+    f.close();
+    return true;
+}
+
+bool readQueueRecord(const String& path, String& data, String& timestamp,
+                     uint32_t& crc, uint8_t& channel) {
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+
+    // First line is metadata comment — parse timestamp from it
+    String metaLine = f.readStringUntil('\n');
+    data = f.readString();
+    f.close();
+
+    // Records queued by older firmware have no CRC — trust them and
+    // send a fresh one
+    bool hasCrc;
+    parseQueueMeta(metaLine, timestamp, crc, hasCrc, channel);
+    if (!hasCrc) crc = crc32Of(data);
+    return true;
+}
+
+void parseQueueMeta(const String& metaLine, String& timestamp, uint32_t& crc,
+                    bool& hasCrc, uint8_t& channel) {
+    // Parse timestamp from "# id=N ts=YYYY-MM-DDTHH:MM:SS sz=NNNNN crc=XXXXXXXX ch=N"
+    timestamp = "retried";
+    int tsIdx = metaLine.indexOf("ts=");
+    if (tsIdx >= 0) {
+        int spaceIdx = metaLine.indexOf(' ', tsIdx + 3);
+        timestamp = (spaceIdx >= 0)
+            ? metaLine.substring(tsIdx + 3, spaceIdx)
+            : metaLine.substring(tsIdx + 3);
+    }
+
+    // Records from before multi-channel capture are all channel 1
+    channel = 1;
+    int chIdx = metaLine.indexOf("ch=");
+    if (chIdx >= 0) {
+        channel = metaLine.substring(chIdx + 3).toInt();
+        if (channel == 0) channel = 1;
+    }
+
+    int crcIdx = metaLine.indexOf("crc=");
+    hasCrc = crcIdx >= 0;
+    crc = hasCrc ? strtoul(metaLine.c_str() + crcIdx + 4, nullptr, 16) : 0;
+}
+
+String dumpPreview(const String& data) {
+    String preview;
+    int pos = 0;
+    for (int i = 0; i < DUMP_PREVIEW_LINES; i++) {
+        int nl = data.indexOf('\n', pos);
+        if (nl < 0) {
+            preview += data.substring(pos);
+            break;
+        }
+        if (i > 0) preview += '\n';
+        preview += data.substring(pos, nl);
+        pos = nl + 1;
+    }
+    return preview;
+}
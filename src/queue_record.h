@@ -0,0 +1,20 @@
+#ifndef QUEUE_RECORD_H
+#define QUEUE_RECORD_H
+
+#include <Arduino.h>
+
+// Queue record (QUEUE_DIR/<id>.tsv): a metadata line
+// "# id=.. ts=.. sz=.. crc=.. ch=.." followed by the dump as captured.
+bool writeQueueRecord(const String& path, const String& data, uint32_t id,
+                      const String& timestamp, uint32_t crc, uint8_t channel);
+bool readQueueRecord(const String& path, String& data, String& timestamp,
+                     uint32_t& crc, uint8_t& channel);
+
+// hasCrc is false for records queued by firmware that didn't store one
+void parseQueueMeta(const String& metaLine, String& timestamp, uint32_t& crc,
+                    bool& hasCrc, uint8_t& channel);
+
+// First DUMP_PREVIEW_LINES lines of a dump, for DumpRecord::preview
+String dumpPreview(const String& data);
+
+#endif // QUEUE_RECORD_H
@@ -1,38 +1,175 @@
 #include "serial_comm.h"
 #include "config.h"
+#include "crc32.h"
+#include "persistent_state.h"
+#include <LittleFS.h>
+#include <esp_idf_version.h>
 
-SerialComm::SerialComm()
-    : _state(CaptureState::IDLE)
+SerialComm::SerialComm(uint8_t channel, uart_port_t uart, int rxPin, int txPin,
+                       uint32_t baud, uint32_t config, int rtsPin, int ctsPin)
+    : _channel(channel)
+    , _uart(uart)
+    , _rxPin(rxPin)
+    , _txPin(txPin)
+    , _rtsPin(rtsPin)
+    , _ctsPin(ctsPin)
+    , _baud(baud)
+    , _config(config)
+    , _logModule(channel <= 1 ? LogModule::SERIAL_COMM : LogModule::SERIAL_COMM2)
+    , _mode(CaptureMode::DUMP)
+    , _flow(FlowControl::NONE)
+    , _throttled(false)
+    , _holding(false)
+    , _throttledAt(0)
+    , _lastXoff(0)
+    , _state(CaptureState::IDLE)
+    , _uartQueue(nullptr)
     , _lastByteTime(0)
+    , _lastRxEvent(0)
     , _lastDumpTime(0)
     , _dumpCount(0)
-    , _dumpCallback(nullptr) {
+    , _dumpCallback(nullptr)
+    , _crc(CRC32_INIT)
+    , _summaryPos(0)
+    , _midLine(false)
+    , _rules(nullptr)
+    , _trace(nullptr)
+    , _spillFailed(false)
+    , _errorsAtStart(0)
+    , _readingCount(0)
+    , _readingCallback(nullptr)
+    , _repliesExpected(0)
+    , _replyCallback(nullptr) {
+    if (channel <= 1) {
+        snprintf(_nvsNamespace, sizeof(_nvsNamespace), "serial");
+    } else {
+        snprintf(_nvsNamespace, sizeof(_nvsNamespace), "serial%u", channel);
+    }
 }
 
 void SerialComm::begin() {
-    Serial1.begin(RS232_BAUD, RS232_CONFIG, RS232_RX_PIN, RS232_TX_PIN);
+    // ESP-IDF driver instead of HardwareSerial: a large RX ring buffer
+    // filled from the ISR, plus an event queue that reports each CR/LF
+    // (pattern detect) and every overrun/framing error. Lines are then
+    // pulled out in bulk, and capture no longer depends on how often
+    // loop() comes around.
+    uart_config_t cfg = {};
+    cfg.baud_rate = _baud;
+    // Arduino SERIAL_xxx constants use the UART_CONF0 register layout
+    cfg.data_bits = (uart_word_length_t)((_config & 0x0C) >> 2);
+    cfg.parity = (uart_parity_t)(_config & 0x03);
+    cfg.stop_bits = (uart_stop_bits_t)((_config & 0x30) >> 4);
+    cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    cfg.source_clk = UART_SCLK_DEFAULT;
+#else
+    cfg.source_clk = UART_SCLK_APB;
+#endif
+
+    uart_driver_install(_uart, UART_RX_RING_SIZE, 0, UART_EVENT_QUEUE_LEN, &_uartQueue, 0);
+    uart_param_config(_uart, &cfg);
+    // RTS is driven by hand from the capture watermarks (not the FIFO
+    // threshold), so only CTS is ever handed to the hardware
+    uart_set_pin(_uart, _txPin, _rxPin, _rtsPin, _ctsPin);
+    uart_enable_pattern_det_baud_intr(_uart, '\n', 1, 9, 0, 0);
+    uart_pattern_queue_reset(_uart, UART_EVENT_QUEUE_LEN);
+
     _buffer.reserve(DUMP_BUFFER_SIZE);
-    Serial.printf("[SerialComm] UART1 initialized: %d baud\n", RS232_BAUD);
+    _line.reserve(STREAM_MAX_LINE);
+    if (_trace) _trace->describe(_channel, _baud, _config);
+
+    _mode = State.getUChar(_nvsNamespace, "mode") == 1 ? CaptureMode::STREAM : CaptureMode::DUMP;
+    uint8_t flow = State.getUChar(_nvsNamespace, "flow");
+
+    _flow = flow <= (uint8_t)FlowControl::XON_XOFF ? (FlowControl)flow : FlowControl::NONE;
+    if ((_flow == FlowControl::RTS_CTS && _rtsPin < 0) || (_flow == FlowControl::XON_XOFF && _txPin < 0)) {
+        _flow = FlowControl::NONE;   // Saved for a board with the pin wired
+    }
+    _applyFlowControl();
+
+    static const char* const FLOW_NAMES[] = {"no", "RTS/CTS", "XON/XOFF"};
+    Log.info(_logModule, "UART%d initialized: %u baud, %u B ring, %s mode, %s flow control",
+             _uart, _baud, UART_RX_RING_SIZE,
+             _mode == CaptureMode::STREAM ? "stream" : "dump", FLOW_NAMES[(int)_flow]);
 }
 
 void SerialComm::update() {
-    // Read all available bytes from the 920i
-    while (Serial1.available()) {
-        char c = Serial1.read();
-        _lastByteTime = millis();
+    _updateFlow();
 
-        if (_state == CaptureState::IDLE) {
-            _state = CaptureState::RECEIVING;
-            _buffer = "";
-            Serial.println("[SerialComm] Receiving data...");
+    uart_event_t event;
+    while (xQueueReceive(_uartQueue, &event, 0) == pdTRUE) {
+        switch (event.type) {
+            case UART_DATA:
+                // Bytes are in the ring; wait for the line end (or idle)
+                _lastRxEvent = millis();
+                break;
+            case UART_PATTERN_DET: {
+                // A whole line is buffered — read it in one go
+                int pos = uart_pattern_pop_pos(_uart);
+                if (pos >= 0) {
+                    _readBytes(pos + 1);
+                } else {
+                    // Pattern queue overflowed; positions are lost
+                    _readBuffered();
+                    uart_pattern_queue_reset(_uart, UART_EVENT_QUEUE_LEN);
+                }
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // The driver pauses RX until we drain; drain now
+                _uartErrors.overflow++;
+                if (_trace) _trace->error(_channel, TraceError::OVERFLOW);
+                _readBuffered();
+                break;
+            case UART_FRAME_ERR:
+                _uartErrors.framing++;
+                if (_trace) _trace->error(_channel, TraceError::FRAMING);
+                break;
+            case UART_PARITY_ERR:
+                _uartErrors.parity++;
+                if (_trace) _trace->error(_channel, TraceError::PARITY);
+                break;
+            case UART_BREAK:
+                _uartErrors.breaks++;
+                if (_trace) _trace->error(_channel, TraceError::BREAK);
+                break;
+            default:
+                break;
         }
+    }
 
-        // Guard against buffer overflow
-        if (_buffer.length() < DUMP_BUFFER_SIZE) {
-            _buffer += c;
+    // Trailing bytes with no CR/LF (a prompt, or a dump without a final
+    // newline) never raise a pattern event — collect them once idle.
+    if (millis() - _lastRxEvent >= UART_PARTIAL_LINE_MS) {
+        size_t buffered = 0;
+        uart_get_buffered_data_len(_uart, &buffered);
+        if (buffered > 0) {
+            _readBuffered();
+            uart_pattern_queue_reset(_uart, UART_EVENT_QUEUE_LEN);
+        }
+    }
+
+    // The dump buffer filled with more of the print still to come: close
+    // this part now and carry on with the rest, which waited in the ring
+    // (holding the 920i off) instead of being dropped
+    if (_holding) {
+        _holding = false;
+        if (_state == CaptureState::RECEIVING) {
+            _flowStats.splits++;
+            Log.warn(_logModule, "Dump buffer full at %u bytes, continuing in the next dump",
+                     _buffer.length());
+            // The 920i is still sending, and the dump callback (upload)
+            // blocks loop() — hold it off until the ring is read again
+            _setThrottled(true);
+            _finalizeDump();
         }
+        _readBuffered();
+        uart_pattern_queue_reset(_uart, UART_EVENT_QUEUE_LEN);
     }
 
+    _updateFlow();
+
     // Check for dump completion: in RECEIVING state and timeout elapsed
     if (_state == CaptureState::RECEIVING) {
         if (millis() - _lastByteTime >= DUMP_COMPLETE_TIMEOUT_MS) {
@@ -41,14 +178,117 @@ void SerialComm::update() {
     }
 }
 
+uint8_t SerialComm::getChannel() const {
+    return _channel;
+}
+
+uint32_t SerialComm::getBaud() const {
+    return _baud;
+}
+
 void SerialComm::onDumpComplete(DumpCallback callback) {
     _dumpCallback = callback;
 }
 
+void SerialComm::onReading(ReadingCallback callback) {
+    _readingCallback = callback;
+}
+
+void SerialComm::setMode(CaptureMode mode) {
+    if (mode == _mode) return;
+    _mode = mode;
+    _buffer = "";
+    if (_spill) _spill.close();
+    _rawDiscard();
+    _spillFailed = false;
+    _line = "";
+    _state = CaptureState::IDLE;
+
+    State.setUChar(_nvsNamespace, "mode", mode == CaptureMode::STREAM ? 1 : 0);
+    State.commit();
+
+    Log.info(_logModule, "Capture mode: %s",
+             mode == CaptureMode::STREAM ? "stream" : "dump");
+}
+
+CaptureMode SerialComm::getMode() const {
+    return _mode;
+}
+
+bool SerialComm::setFlowControl(FlowControl flow) {
+    if (flow == FlowControl::RTS_CTS && _rtsPin < 0) return false;
+    if (flow == FlowControl::XON_XOFF && _txPin < 0) return false;
+    if (flow == _flow) return true;
+
+    _setThrottled(false);   // Release in the old mode before switching
+    _flow = flow;
+    _applyFlowControl();
+
+    State.setUChar(_nvsNamespace, "flow", (uint8_t)flow);
+    State.commit();
+
+    static const char* const FLOW_NAMES[] = {"off", "RTS/CTS", "XON/XOFF"};
+    Log.info(_logModule, "Flow control: %s", FLOW_NAMES[(int)flow]);
+    return true;
+}
+
+FlowControl SerialComm::getFlowControl() const {
+    return _flow;
+}
+
+bool SerialComm::isThrottled() const {
+    return _throttled;
+}
+
+FlowStats SerialComm::getFlowStats() const {
+    FlowStats s = _flowStats;
+    if (_throttled) s.throttledMs += millis() - _throttledAt;
+    return s;
+}
+
 void SerialComm::sendCommand(const String& command) {
-    Serial1.print(command);
-    Serial1.print(RS232_LINE_TERMINATOR);
-    Serial.printf("[SerialComm] Sent: %s\n", command.c_str());
+    uart_write_bytes(_uart, command.c_str(), command.length());
+    uart_write_bytes(_uart, RS232_LINE_TERMINATOR, strlen(RS232_LINE_TERMINATOR));
+    Log.info(_logModule, "Sent: %s", command.c_str());
+}
+
+void SerialComm::setFilter(const FilterRules* rules) {
+    _rules = rules;
+}
+
+void SerialComm::setTrace(UartTrace* trace) {
+    _trace = trace;
+}
+
+void SerialComm::inject(const uint8_t* data, size_t len) {
+    _ingest(data, len);
+}
+
+void SerialComm::flushDump() {
+    if (_state == CaptureState::RECEIVING) {
+        _finalizeDump();
+    }
+}
+
+void SerialComm::expectReply() {
+    _repliesExpected++;
+}
+
+void SerialComm::cancelReplies() {
+    _repliesExpected = 0;
+    _replyLine = "";
+}
+
+void SerialComm::onReply(ReplyCallback callback) {
+    _replyCallback = callback;
+}
+
+const UartErrorStats& SerialComm::getUartErrors() const {
+    return _uartErrors;
+}
+
+unsigned long SerialComm::getIdleTime() const {
+    return millis() - _lastByteTime;
 }
 
 CaptureState SerialComm::getState() const {
@@ -67,19 +307,380 @@ uint32_t SerialComm::getDumpCount() const {
     return _dumpCount;
 }
 
+uint32_t SerialComm::getReadingCount() const {
+    return _readingCount;
+}
+
+const String& SerialComm::getLastReading() const {
+    return _lastReading;
+}
+
+void SerialComm::_applyFlowControl() {
+    bool cts = _flow == FlowControl::RTS_CTS && _ctsPin >= 0;
+    uart_set_hw_flow_ctrl(_uart, cts ? UART_HW_FLOWCTRL_CTS : UART_HW_FLOWCTRL_DISABLE, 0);
+    if (_rtsPin >= 0) {
+        uart_set_rts(_uart, 1);   // Asserted: clear to send us data
+    }
+}
+
+void SerialComm::_updateFlow() {
+    if (_flow == FlowControl::NONE) return;
+
+    size_t waiting = 0;
+    uart_get_buffered_data_len(_uart, &waiting);
+    size_t room = UART_RX_RING_SIZE - min(waiting, (size_t)UART_RX_RING_SIZE);
+
+    if (!_throttled && room < FLOW_XOFF_HEADROOM) {
+        _setThrottled(true);
+    } else if (_throttled && room >= FLOW_XON_HEADROOM) {
+        _setThrottled(false);
+    } else if (_throttled && _flow == FlowControl::XON_XOFF
+               && millis() - _lastXoff >= FLOW_XOFF_RESEND_MS) {
+        static const char XOFF = 0x13;
+        uart_write_bytes(_uart, &XOFF, 1);
+        _lastXoff = millis();
+    }
+}
+
+void SerialComm::_setThrottled(bool on) {
+    if (on == _throttled) return;
+    _throttled = on;
+
+    if (_flow == FlowControl::RTS_CTS) {
+        uart_set_rts(_uart, on ? 0 : 1);
+    } else if (_flow == FlowControl::XON_XOFF) {
+        const char c = on ? 0x13 : 0x11;   // XOFF : XON
+        uart_write_bytes(_uart, &c, 1);
+        _lastXoff = millis();
+    }
+
+    if (on) {
+        _throttledAt = millis();
+        _flowStats.throttles++;
+        Log.debug(_logModule, "Holding off the 920i");
+    } else {
+        uint32_t held = millis() - _throttledAt;
+        _flowStats.throttledMs += held;
+        Log.debug(_logModule, "Releasing the 920i after %u ms", held);
+    }
+}
+
+void SerialComm::_processLines(bool final) {
+    // Each line completed by the last append is filtered, summarized and
+    // added to the CRC, then written back over the buffer in place —
+    // dropped lines and columns never take RAM or flash. The final call
+    // also takes the unterminated tail.
+    if (_summaryPos >= _buffer.length()) return;
+    char* buf = &_buffer[0];
+    char* end = buf + _buffer.length();
+    char* p = buf + _summaryPos;
+
+    // The rest of a line whose start was spilled raw goes the same way
+    if (_midLine) {
+        char* nl = (char*)memchr(p, '\n', end - p);
+        char* stop = nl ? nl + 1 : end;
+        _crc = crc32Update(_crc, (const uint8_t*)p, stop - p);
+        p = stop;
+        _midLine = (nl == nullptr);
+    }
+
+    char* out = p;
+    while (p < end) {
+        char* nl = (char*)memchr(p, '\n', end - p);
+        if (!nl && !final) break;
+        size_t len = (nl ? nl + 1 : end) - p;
+
+        if (!_filter.drops(p, len)) {
+            // Totals come from the full line, before any column is cut
+            _meta.summary.addLine(p, nl ? nl - p : len);
+            size_t n = _filter.project(p, len, out);
+            _crc = crc32Update(_crc, (const uint8_t*)out, n);
+            out += n;
+        }
+        p += len;
+    }
+
+    size_t done = p - buf;
+    _summaryPos = out - buf;
+    if (done > _summaryPos) _buffer.remove(_summaryPos, done - _summaryPos);
+}
+
+void SerialComm::_rawWrite(const uint8_t* data, size_t len) {
+    // Flash is checked once per SPILL_CHUNK, as for the spill itself
+    size_t before = _raw.size();
+    if (before == 0 || before / SPILL_CHUNK != (before + len) / SPILL_CHUNK) {
+        size_t free = LittleFS.totalBytes() - LittleFS.usedBytes();
+        if (free < SPILL_CHUNK + SPILL_FLASH_RESERVE) {
+            Log.warn(_logModule, "Flash full, not keeping the raw dump");
+            _rawDiscard();
+            return;
+        }
+    }
+    if (_raw.write(data, len) != len) {
+        Log.warn(_logModule, "Raw dump write failed, not keeping it");
+        _rawDiscard();
+    }
+}
+
+void SerialComm::_rawDiscard() {
+    if (!_raw) return;
+    String path = _raw.path();
+    _raw.close();
+    LittleFS.remove(path);
+}
+
+void SerialComm::_spillIfNeeded() {
+    if (_spillFailed) return;
+    if (!_spill) {
+        if (_buffer.length() < SPILL_RAM_WATERMARK) return;
+
+        if (!LittleFS.exists(SPILL_DIR)) LittleFS.mkdir(SPILL_DIR);
+        char path[24];
+        snprintf(path, sizeof(path), "%s/ch%u.tsv", SPILL_DIR, _channel);
+        _spill = LittleFS.open(path, "w");   // Replaces a spill a reset left behind
+        if (!_spill) {
+            Log.warn(_logModule, "Can't open %s, dump stays in RAM", path);
+            _spillFailed = true;
+            return;
+        }
+        Log.info(_logModule, "Dump past %u bytes, continuing on flash", SPILL_RAM_WATERMARK);
+    } else if (_buffer.length() < SPILL_CHUNK) {
+        return;
+    }
+
+    // Whole lines only, so the partial last line stays for the filter.
+    // A single line this long can't wait for its end: what there is of
+    // it goes out as it came, neither filtered nor summarized, and so
+    // does the rest of it.
+    if (_summaryPos == 0) {
+        _crc = crc32Update(_crc, (const uint8_t*)_buffer.c_str(), _buffer.length());
+        _summaryPos = _buffer.length();
+        _midLine = true;
+    }
+    _spillWrite(_summaryPos);
+}
+
+bool SerialComm::_spillWrite(size_t len) {
+    // Flash is checked once per SPILL_CHUNK; a write that runs out in
+    // between comes back short
+    size_t before = _spill.size();
+    bool room = true;
+    if (before == 0 || before / SPILL_CHUNK != (before + len) / SPILL_CHUNK) {
+        size_t free = LittleFS.totalBytes() - LittleFS.usedBytes();
+        room = free >= len + SPILL_FLASH_RESERVE;
+    }
+    size_t written = 0;
+    if (room) {
+        written = _spill.write((const uint8_t*)_buffer.c_str(), len);
+    }
+    if (written != len) {
+        // Anything partly written is on flash; the rest stays in RAM
+        Log.warn(_logModule, "Flash full after %u bytes of dump, keeping the rest in RAM",
+                 _spill.size());
+        _spillFailed = true;
+    }
+
+    _buffer.remove(0, written);
+    _summaryPos -= min(_summaryPos, written);
+    return written == len;
+}
+
 void SerialComm::_finalizeDump() {
     _state = CaptureState::COMPLETE;
-    _lastDump = _buffer;
     _lastDumpTime = millis();
     _dumpCount++;
 
-    Serial.printf("[SerialComm] Dump #%u complete: %u bytes\n",
-                  _dumpCount, _buffer.length());
+    _processLines(true);
+    _meta.crc32 = crc32Final(_crc);
+    _meta.uartErrors = _uartErrors.total() - _errorsAtStart;
+    _meta.linesDropped = _filter.linesDropped();
+    if (_raw) {
+        _meta.rawPath = _raw.path();
+        _raw.close();
+    }
+
+    size_t length = _buffer.length();
+    if (_spill) {
+        // The tail goes to flash too; one that won't fit is lost
+        size_t tail = _buffer.length();
+        bool tailLost = tail > 0 && !_spillWrite(tail);
+        if (tailLost) {
+            _meta.dropped += _buffer.length();
+            _buffer = "";
+        }
+        length = _spill.size();
+        _meta.spillPath = _spill.path();
+        _spill.close();
+        _lastDump = "";
+
+        // The running CRC covered the lost bytes; the receiver must get
+        // one over what was kept
+        if (tailLost) {
+            File f = LittleFS.open(_meta.spillPath, "r");
+            uint32_t crc = CRC32_INIT;
+            uint8_t chunk[UART_READ_CHUNK];
+            size_t n;
+            while (f && (n = f.read(chunk, sizeof(chunk))) > 0) {
+                crc = crc32Update(crc, chunk, n);
+            }
+            f.close();
+            _meta.crc32 = crc32Final(crc);
+        }
+    } else {
+        _lastDump = _buffer;
+    }
+    _spillFailed = false;
+    _meta.summary.bytes = length;
+    if (_trace) _trace->dump(_channel, length);
+
+    Log.info(_logModule, "Dump #%u complete: %u bytes%s, %u records, crc %08x",
+             _dumpCount, length, _meta.spillPath.length() > 0 ? " (on flash)" : "",
+             _meta.summary.records, _meta.crc32);
+    if (_filter.active()) {
+        Log.info(_logModule, "Dump #%u filtered: %u of %u bytes kept, %u lines dropped",
+                 _dumpCount, length, _meta.rawBytes, _meta.linesDropped);
+    }
+    if (_meta.dropped > 0 || _meta.uartErrors > 0) {
+        Log.warn(_logModule, "Dump #%u: %u bytes dropped, %u UART errors",
+                 _dumpCount, _meta.dropped, _meta.uartErrors);
+    }
 
     if (_dumpCallback) {
-        _dumpCallback(_buffer, _buffer.length());
+        _dumpCallback(_buffer, length, _meta);
+    }
+    if (_meta.spillPath.length() > 0) {
+        LittleFS.remove(_meta.spillPath);
+    }
+    if (_meta.rawPath.length() > 0 && LittleFS.exists(_meta.rawPath)) {
+        LittleFS.remove(_meta.rawPath);
     }
 
     _buffer = "";
     _state = CaptureState::IDLE;
 }
+
+void SerialComm::_readBytes(size_t len) {
+    uint8_t chunk[UART_READ_CHUNK];
+    while (len > 0) {
+        size_t want = min(len, sizeof(chunk));
+
+        // With flow control, bytes that don't fit the dump buffer stay in
+        // the ring (see update()) instead of being dropped
+        if (_flow != FlowControl::NONE && _mode == CaptureMode::DUMP
+            && _state == CaptureState::RECEIVING) {
+            size_t room = DUMP_BUFFER_SIZE - min((size_t)_buffer.length(), (size_t)DUMP_BUFFER_SIZE);
+            if (room == 0) {
+                _holding = true;
+                break;
+            }
+            want = min(want, room);
+        }
+
+        int n = uart_read_bytes(_uart, chunk, want, 0);
+        if (n <= 0) break;
+        if (_trace) _trace->data(_channel, chunk, n);
+        _ingest(chunk, n);
+        len -= n;
+    }
+}
+
+void SerialComm::_readBuffered() {
+    size_t buffered = 0;
+    uart_get_buffered_data_len(_uart, &buffered);
+    _readBytes(buffered);
+}
+
+void SerialComm::_ingest(const uint8_t* data, size_t len) {
+    _lastByteTime = millis();
+    _lastRxEvent = _lastByteTime;
+
+    size_t i = 0;
+    while (i < len) {
+        // Command replies arrive between dumps; never split a dump for one
+        if (_repliesExpected > 0 && _state != CaptureState::RECEIVING) {
+            _replyByte(data[i++]);
+            continue;
+        }
+
+        if (_mode == CaptureMode::STREAM) {
+            _streamByte(data[i++]);
+            continue;
+        }
+
+        if (_state == CaptureState::IDLE) {
+            _state = CaptureState::RECEIVING;
+            _buffer = "";
+            _buffer.reserve(DUMP_BUFFER_SIZE);  // No-op unless capacity was lost
+            _crc = CRC32_INIT;
+            _meta = DumpMeta();
+            _meta.channel = _channel;
+            _summaryPos = 0;
+            _midLine = false;
+            _errorsAtStart = _uartErrors.total();
+            _filter.begin(_rules ? *_rules : FilterRules());
+            if (_filter.active() && _rules->raw) {
+                if (!LittleFS.exists(RAW_DIR)) LittleFS.mkdir(RAW_DIR);
+                char path[24];
+                snprintf(path, sizeof(path), "%s/ch%u.tmp", RAW_DIR, _channel);
+                _raw = LittleFS.open(path, "w");
+                if (!_raw) Log.warn(_logModule, "Can't open %s, raw dump not kept", path);
+            }
+            Log.info(_logModule, "Receiving data...");
+        }
+
+        // Dump bytes: append the rest of the block at once. Guard against
+        // buffer overflow — anything past DUMP_BUFFER_SIZE is counted and
+        // dropped.
+        size_t n = len - i;
+        size_t space = DUMP_BUFFER_SIZE - min((size_t)_buffer.length(), (size_t)DUMP_BUFFER_SIZE);
+        size_t take = min(n, space);
+        if (take > 0) {
+            _buffer.concat((const char*)data + i, take);
+            if (_raw) _rawWrite(data + i, take);
+            _processLines(false);
+            _spillIfNeeded();
+        }
+        _meta.rawBytes += take;
+        _meta.dropped += n - take;
+        i = len;
+    }
+}
+
+void SerialComm::_streamByte(char c) {
+    if (c != '\r' && c != '\n') {
+        // Over-long lines are truncated rather than split into two readings
+        if (_line.length() < STREAM_MAX_LINE) {
+            _line += c;
+        }
+        return;
+    }
+
+    // CR/LF pair (or a blank line) — nothing to emit
+    if (_line.length() == 0) return;
+
+    _lastReading = _line;
+    _readingCount++;
+    _line = "";
+
+    if (_readingCallback) {
+        _readingCallback(_lastReading);
+    }
+}
+
+void SerialComm::_replyByte(char c) {
+    if (c != '\r' && c != '\n') {
+        if (_replyLine.length() < STREAM_MAX_LINE) {
+            _replyLine += c;
+        }
+        return;
+    }
+    if (_replyLine.length() == 0) return;
+
+    String reply = _replyLine;
+    _replyLine = "";
+    _repliesExpected--;
+
+    if (_replyCallback) {
+        _replyCallback(reply);
+    }
+}
@@ -3,6 +3,12 @@
 
 #include <Arduino.h>
 #include <functional>
+#include <driver/uart.h>
+#include <FS.h>
+#include "logger.h"
+#include "dump_summary.h"
+#include "dump_filter.h"
+#include "uart_trace.h"
 
 // State machine for capturing data dumps from the 920i
 enum class CaptureState {
@@ -11,29 +17,138 @@ enum class CaptureState {
     COMPLETE    // Dump finished (timeout elapsed with no new data)
 };
 
+// How incoming bytes are grouped
+enum class CaptureMode {
+    DUMP,   // Buffer everything until the line goes quiet, then emit one dump
+    STREAM  // Emit each CR/LF-terminated line as a standalone reading
+};
+
+// How the 920i is held off when the capture path falls behind
+enum class FlowControl {
+    NONE,     // Bytes past DUMP_BUFFER_SIZE are dropped
+    RTS_CTS,  // Deassert RTS (needs RS232_RTS_PIN); CTS also gates our TX if wired
+    XON_XOFF  // Send XOFF/XON (needs a TX pin; 920i port set to XON/XOFF)
+};
+
+// Flow control counters (since boot)
+struct FlowStats {
+    uint32_t throttles = 0;     // Times the 920i was held off
+    uint32_t throttledMs = 0;   // Total time held off, including now
+    uint32_t splits = 0;        // Dumps closed early on a full buffer
+};
+
+// Per-dump details gathered during capture
+struct DumpMeta {
+    uint8_t channel = 1;      // Capture channel the dump arrived on (1-based)
+    uint32_t crc32 = 0;       // CRC-32 of the dump as delivered (after filtering)
+    uint32_t rawBytes = 0;    // Bytes received, before filtering
+    uint32_t linesDropped = 0;  // Lines removed by the dump filter
+    uint32_t dropped = 0;     // Bytes lost to buffer overflow
+    uint32_t uartErrors = 0;  // UART errors seen while this dump arrived
+    DumpSummary summary;      // Record count and weight totals
+    String spillPath;         // Set if the dump is in this LittleFS file
+                              // (data is then empty); removed once the
+                              // dump callback returns
+    String rawPath;           // Unfiltered copy, if the rules keep one;
+                              // removed unless the callback moves it
+};
+
+// UART receive error counters (since boot)
+struct UartErrorStats {
+    uint32_t framing = 0;
+    uint32_t parity = 0;
+    uint32_t overflow = 0;   // RX FIFO / ring buffer overrun
+    uint32_t breaks = 0;
+
+    uint32_t total() const { return framing + parity + overflow + breaks; }
+};
+
 // Callback type: called when a complete dump is captured
-using DumpCallback = std::function<void(const String& data, size_t length)>;
+using DumpCallback = std::function<void(const String& data, size_t length, const DumpMeta& meta)>;
 
+// Callback type: called for each line in STREAM mode
+using ReadingCallback = std::function<void(const String& reading)>;
+
+// Callback type: called with each reply line to a command
+using ReplyCallback = std::function<void(const String& reply)>;
+
+// One capture channel: a UART wired to one indicator port, with its own
+// serial profile, buffer and capture mode. Channel 1 keeps the original
+// NVS namespace ("serial"); others use "serial<n>".
 class SerialComm {
 public:
-    SerialComm();
+    SerialComm(uint8_t channel, uart_port_t uart, int rxPin, int txPin,
+               uint32_t baud, uint32_t config, int rtsPin = -1, int ctsPin = -1);
 
     // Initialize the UART connection to the 920i
     void begin();
 
+    // 1-based channel number, tagged on every dump
+    uint8_t getChannel() const;
+    uint32_t getBaud() const;
+
     // Call from loop() — processes incoming serial data
     void update();
 
     // Register a callback for when a dump is complete
     void onDumpComplete(DumpCallback callback);
 
+    // Register a callback for each reading (STREAM mode only)
+    void onReading(ReadingCallback callback);
+
+    // Switch capture mode (persisted to NVS). Any partial dump or line
+    // in progress is discarded.
+    void setMode(CaptureMode mode);
+    CaptureMode getMode() const;
+
+    // Switch flow control (persisted to NVS). Fails if the mode needs a
+    // pin this channel doesn't have wired.
+    bool setFlowControl(FlowControl flow);
+    FlowControl getFlowControl() const;
+    bool isThrottled() const;
+    FlowStats getFlowStats() const;
+
+    // Filter applied to each dump from its first byte (nullptr = none).
+    // The rules are read once per dump, so a change takes effect on the
+    // next one.
+    void setFilter(const FilterRules* rules);
+
+    // Record bytes read off the UART, UART errors and dump boundaries
+    // (nullptr = none). Injected bytes are not traced.
+    void setTrace(UartTrace* trace);
+
+    // Feed bytes through the capture path as if they came off the UART
+    // (load generator, native benchmark). They are routed exactly like
+    // received data.
+    void inject(const uint8_t* data, size_t len);
+
+    // Finish the dump in progress now instead of waiting for the line
+    // to go quiet
+    void flushDump();
+
     // Send a command to the 920i (appends CR terminator)
     void sendCommand(const String& command);
 
+    // Route the next reply line to the reply callback instead of the
+    // dump buffer / reading stream. Call once per command that answers.
+    void expectReply();
+
+    // Stop routing lines to the reply callback (e.g. after a timeout)
+    void cancelReplies();
+
+    // Register a callback for command reply lines
+    void onReply(ReplyCallback callback);
+
+    // UART error counters — line noise shows up here, not in the CRC
+    const UartErrorStats& getUartErrors() const;
+
+    // Milliseconds since the last byte arrived from the 920i
+    unsigned long getIdleTime() const;
+
     // Get current state
     CaptureState getState() const;
 
-    // Get the last completed dump data
+    // Get the last completed dump data (empty if it spilled to flash)
     const String& getLastDump() const;
 
     // Get the timestamp of the last completed dump
@@ -42,16 +157,73 @@ public:
     // Get total number of dumps captured this session
     uint32_t getDumpCount() const;
 
+    // STREAM mode: readings seen this session and the most recent one
+    uint32_t getReadingCount() const;
+    const String& getLastReading() const;
+
 private:
+    uint8_t _channel;
+    uart_port_t _uart;
+    int _rxPin;
+    int _txPin;
+    int _rtsPin;
+    int _ctsPin;
+    uint32_t _baud;
+    uint32_t _config;
+    LogModule _logModule;
+    char _nvsNamespace[12];
+    CaptureMode _mode;
+    FlowControl _flow;
+    bool _throttled;
+    bool _holding;            // Dump buffer full; the rest waits in the ring
+    unsigned long _throttledAt;
+    unsigned long _lastXoff;
+    FlowStats _flowStats;
     CaptureState _state;
     String _buffer;
+    QueueHandle_t _uartQueue;
     unsigned long _lastByteTime;
+    unsigned long _lastRxEvent;
     unsigned long _lastDumpTime;
     uint32_t _dumpCount;
     String _lastDump;
     DumpCallback _dumpCallback;
+    uint32_t _crc;
+    DumpMeta _meta;
+    size_t _summaryPos;       // Start of the first line not yet filtered
+                              // and summarized
+    bool _midLine;            // A line too long to wait for went to flash
+                              // unfiltered; the rest of it follows as is
+    const FilterRules* _rules;
+    DumpFilter _filter;
+    File _raw;                // Unfiltered copy of the dump in progress
+    UartTrace* _trace;
+    File _spill;              // Open while the dump in progress is on flash
+    bool _spillFailed;        // Flash full this dump; the rest stays in RAM
+    uint32_t _errorsAtStart;
+    UartErrorStats _uartErrors;
+    String _line;
+    String _lastReading;
+    uint32_t _readingCount;
+    ReadingCallback _readingCallback;
+    String _replyLine;
+    uint8_t _repliesExpected;
+    ReplyCallback _replyCallback;
 
+    void _applyFlowControl();
+    void _updateFlow();
+    void _setThrottled(bool on);
+    void _readBytes(size_t len);
+    void _readBuffered();
+    void _ingest(const uint8_t* data, size_t len);
+    void _processLines(bool final);
+    void _rawWrite(const uint8_t* data, size_t len);
+    void _rawDiscard();
+    void _spillIfNeeded();
+    bool _spillWrite(size_t len);
     void _finalizeDump();
+    void _streamByte(char c);
+    void _replyByte(char c);
 };
 
 #endif // SERIAL_COMM_H
@@ -0,0 +1,32 @@
+#include "status_json.h"
+#include "config.h"
+
+void addUploadStatus(JsonDocument& doc, const UploadStats& stats, const DumpRecord& last) {
+    doc["upload_success"] = stats.totalSuccess;
+    doc["upload_failed"] = stats.totalFailed;
+    doc["queue_depth"] = stats.queueDepth;
+    doc["queue_ram"] = stats.ramQueued;
+    doc["flash_writes_avoided"] = stats.flashWritesAvoided;
+    doc["queue_corrupt"] = stats.corruptQueued;
+    doc["summaries_sent"] = stats.summariesSent;
+    doc["summaries_pending"] = stats.summariesPending;
+    doc["last_upload_time"] = stats.lastUploadTime;
+    doc["pulled"] = stats.pulled;
+    doc["pull_active"] = stats.lastPullAt != 0 && millis() - stats.lastPullAt < PULL_ACTIVE_MS;
+    doc["receiver_url"] = stats.receiverUrl;
+    doc["transport"] = stats.transport;
+
+    if (last.id > 0) {
+        JsonObject o = doc["last_dump"].to<JsonObject>();
+        o["id"] = last.id;
+        o["timestamp"] = last.timestamp;
+        o["size"] = last.size;
+        o["channel"] = last.channel;
+        o["uploaded"] = last.uploaded;
+        char crcHex[9];
+        snprintf(crcHex, sizeof(crcHex), "%08x", last.crc);
+        o["crc"] = crcHex;
+        o["preview"] = last.preview;
+        last.summary.toJson(o["summary"].to<JsonObject>());
+    }
+}
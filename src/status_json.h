@@ -0,0 +1,13 @@
+#ifndef STATUS_JSON_H
+#define STATUS_JSON_H
+
+#include <ArduinoJson.h>
+#include "data_uploader.h"
+
+// The upload part of /api/status: counters, receiver, and the last dump
+// with its preview and summary. The rest of the status is built in
+// main.cpp; this part is split out so the native benchmark
+// (test/test_bench) times the same code.
+void addUploadStatus(JsonDocument& doc, const UploadStats& stats, const DumpRecord& last);
+
+#endif // STATUS_JSON_H
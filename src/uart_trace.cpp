@@ -0,0 +1,222 @@
+#include "uart_trace.h"
+#include "logger.h"
+#include "persistent_state.h"
+#include <LittleFS.h>
+#include <esp_timer.h>
+
+static const uint8_t TRACE_HEADER = 0x00;
+static const uint8_t TRACE_START = 0x1;
+static const uint8_t TRACE_DATA = 0x2;
+static const uint8_t TRACE_ERROR = 0x3;
+static const uint8_t TRACE_DUMP = 0x4;
+
+static const char* const TRACE_FILES[] = { TRACE_DIR "/trace.1.bin", TRACE_DIR "/trace.bin" };
+
+UartTrace::UartTrace()
+    : _on(false)
+    , _lastUs(0)
+    , _lastFlush(0)
+    , _fileBytes(0)
+    , _records(0)
+    , _dropped(0)
+    , _channelCount(0) {
+}
+
+void UartTrace::begin() {
+    _fileBytes = _measure();
+    if (State.getBool("trace", "on", false)) {
+        _on = true;
+        _start(true);
+        Log.info(LogModule::SERIAL_COMM, "UART trace recording, %u bytes on flash", _fileBytes);
+    }
+}
+
+void UartTrace::update() {
+    if (!_buf.empty() && millis() - _lastFlush >= TRACE_FLUSH_MS) {
+        flush();
+    }
+}
+
+void UartTrace::describe(uint8_t channel, uint32_t baud, uint32_t config) {
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        if (_channels[i].id == channel) {
+            _channels[i].baud = baud;
+            _channels[i].config = config;
+            return;
+        }
+    }
+    if (_channelCount < TRACE_MAX_CHANNELS) {
+        _channels[_channelCount++] = { channel, baud, config };
+    }
+}
+
+void UartTrace::setEnabled(bool on) {
+    if (on == _on) return;
+    if (!on) flush();
+    _on = on;
+    State.setBool("trace", "on", on);
+    State.commit();
+
+    if (on) {
+        _start(true);
+    } else {
+        _buf.clear();
+        _buf.shrink_to_fit();
+    }
+    Log.info(LogModule::SERIAL_COMM, "UART trace %s", on ? "on" : "off");
+}
+
+bool UartTrace::isEnabled() const {
+    return _on;
+}
+
+void UartTrace::data(uint8_t channel, const uint8_t* bytes, size_t len) {
+    if (!_on || len == 0) return;
+    _record(TRACE_DATA, channel, len + 5);
+    _putVarint(len);
+    _buf.insert(_buf.end(), bytes, bytes + len);
+}
+
+void UartTrace::error(uint8_t channel, TraceError code) {
+    if (!_on) return;
+    _record(TRACE_ERROR, channel, 1);
+    _buf.push_back((uint8_t)code);
+}
+
+void UartTrace::dump(uint8_t channel, size_t length) {
+    if (!_on) return;
+    _record(TRACE_DUMP, channel, 5);
+    _putVarint(length);
+}
+
+void UartTrace::clear() {
+    _buf.clear();
+    for (const char* path : TRACE_FILES) LittleFS.remove(path);
+    _fileBytes = 0;
+    _records = 0;
+    _dropped = 0;
+    if (_on) _start(true);
+    Log.info(LogModule::SERIAL_COMM, "UART trace cleared");
+}
+
+size_t UartTrace::getSize() const {
+    return _fileBytes + _buf.size();
+}
+
+uint32_t UartTrace::getRecords() const {
+    return _records;
+}
+
+uint32_t UartTrace::getDropped() const {
+    return _dropped;
+}
+
+size_t UartTrace::flush() {
+    _lastFlush = millis();
+    if (_buf.empty()) return _fileBytes;
+
+    size_t free = LittleFS.totalBytes() - LittleFS.usedBytes();
+    if (free < _buf.size() + SPILL_FLASH_RESERVE) {
+        // Queued dumps matter more than the trace
+        _discard();
+        return _fileBytes;
+    }
+
+    if (!LittleFS.exists(TRACE_DIR)) LittleFS.mkdir(TRACE_DIR);
+    String path = String(TRACE_DIR) + "/trace.bin";
+    File f = LittleFS.open(path, "a");
+    if (!f) {
+        _discard();
+        return _fileBytes;
+    }
+    if (f.size() == 0) {
+        static const uint8_t header[] = { TRACE_HEADER, 'B', 'M', 'T', '1' };
+        f.write(header, sizeof(header));
+    }
+    f.write(_buf.data(), _buf.size());
+    size_t size = f.size();
+    f.close();
+    _buf.clear();
+
+    if (size >= TRACE_MAX_BYTES) {
+        String old = String(TRACE_DIR) + "/trace.1.bin";
+        LittleFS.remove(old);
+        LittleFS.rename(path, old);
+        _start(false);   // So each file says how its channels were set up
+    }
+    _fileBytes = _measure();
+    return _fileBytes;
+}
+
+size_t UartTrace::write(Print& out) {
+    size_t total = 0;
+    uint8_t chunk[STREAM_CHUNK];
+    for (const char* path : TRACE_FILES) {
+        File f = LittleFS.open(path, "r");
+        if (!f) continue;
+        int n;
+        while ((n = f.read(chunk, sizeof(chunk))) > 0) {
+            size_t w = out.write(chunk, n);
+            total += w;
+            if (w != (size_t)n) break;
+        }
+        f.close();
+    }
+    return total;
+}
+
+void UartTrace::_start(bool session) {
+    // A new session has no time link to whatever was recorded before it
+    _buf.reserve(TRACE_BUFFER_SIZE);
+    if (session) _lastUs = esp_timer_get_time();
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        _record(TRACE_START, _channels[i].id, 13);
+        _putU32(_channels[i].baud);
+        _putU32(_channels[i].config);
+        _putU32(millis());
+        _buf.push_back(session ? 1 : 0);
+    }
+}
+
+void UartTrace::_discard() {
+    // The lost records leave a hole in the timeline: start a new session
+    // so a replay doesn't join the two sides up. The buffer is empty by
+    // then, so the START records can't flush again.
+    _dropped += _buf.size();
+    _buf.clear();
+    _start(true);
+}
+
+void UartTrace::_record(uint8_t type, uint8_t channel, size_t room) {
+    // Tag and varint time take at most 11 bytes
+    if (_buf.size() + room + 11 > TRACE_BUFFER_SIZE) flush();
+
+    int64_t now = esp_timer_get_time();
+    _buf.push_back((uint8_t)(type << 4 | (channel & 0x0F)));
+    _putVarint((uint64_t)(now - _lastUs));
+    _lastUs = now;
+    _records++;
+}
+
+void UartTrace::_putVarint(uint64_t v) {
+    while (v >= 0x80) {
+        _buf.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    _buf.push_back((uint8_t)v);
+}
+
+void UartTrace::_putU32(uint32_t v) {
+    for (int i = 0; i < 4; i++) _buf.push_back((uint8_t)(v >> (8 * i)));
+}
+
+size_t UartTrace::_measure() const {
+    size_t total = 0;
+    for (const char* path : TRACE_FILES) {
+        File f = LittleFS.open(path, "r");
+        if (!f) continue;
+        total += f.size();
+        f.close();
+    }
+    return total;
+}
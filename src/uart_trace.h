@@ -0,0 +1,98 @@
+#ifndef UART_TRACE_H
+#define UART_TRACE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+
+// UART error recorded in a trace
+enum class TraceError : uint8_t {
+    FRAMING,
+    PARITY,
+    OVERFLOW,
+    BREAK
+};
+
+// Records what arrives on the capture UARTs — raw bytes with their
+// arrival times, UART errors, and where each dump was closed — to a
+// binary file on flash, so a dump that was mis-split or truncated in the
+// field can be replayed on the bench (receiver/trace_replay.py).
+//
+// Every record starts with a tag byte (type << 4 | channel) and, except
+// HEADER, the microseconds since the previous record as a varint:
+//
+//   HEADER 0x00  "BMT1"; starts each file
+//   START  0x1c  baud u32, config u32, millis u32 (little-endian),
+//                session u8; once per channel when recording starts
+//                (session 1: no time link to earlier records) and at
+//                the top of each file (session 0)
+//   DATA   0x2c  length varint, bytes
+//   ERROR  0x3c  TraceError u8
+//   DUMP   0x4c  length varint — capture closed a dump of this size here
+//
+// Times are when a chunk was read out of the driver's ring (at each line
+// end, or once the line goes idle), not per byte. Records are staged in
+// RAM and appended to TRACE_DIR/trace.bin every TRACE_FLUSH_MS; past
+// TRACE_MAX_BYTES it rotates to trace.1.bin, as the log spill does.
+class UartTrace {
+public:
+    UartTrace();
+
+    // After LittleFS is mounted; resumes recording if it was on
+    void begin();
+
+    // Call from loop() — writes staged records to flash
+    void update();
+
+    // Serial profile of a channel, written in its START record
+    void describe(uint8_t channel, uint32_t baud, uint32_t config);
+
+    // Start/stop recording (persisted to NVS)
+    void setEnabled(bool on);
+    bool isEnabled() const;
+
+    void data(uint8_t channel, const uint8_t* bytes, size_t len);
+    void error(uint8_t channel, TraceError code);
+    void dump(uint8_t channel, size_t length);
+
+    // Delete the trace files; recording, if on, starts a fresh one
+    void clear();
+
+    // Trace bytes on flash plus those still staged
+    size_t getSize() const;
+    uint32_t getRecords() const;
+    uint32_t getDropped() const;     // Bytes lost to a full flash
+
+    // Write staged records to flash now; returns the trace size on flash
+    size_t flush();
+
+    // Write the trace on flash (oldest file first) to out. Returns the
+    // bytes written.
+    size_t write(Print& out);
+
+private:
+    struct Channel {
+        uint8_t id;
+        uint32_t baud;
+        uint32_t config;
+    };
+
+    bool _on;
+    std::vector<uint8_t> _buf;
+    int64_t _lastUs;
+    unsigned long _lastFlush;
+    size_t _fileBytes;
+    uint32_t _records;
+    uint32_t _dropped;
+    Channel _channels[TRACE_MAX_CHANNELS];
+    uint8_t _channelCount;
+
+    void _start(bool session);
+    void _discard();
+    void _record(uint8_t type, uint8_t channel, size_t room);
+    void _putVarint(uint64_t v);
+    void _putU32(uint32_t v);
+    size_t _measure() const;
+};
+
+#endif // UART_TRACE_H
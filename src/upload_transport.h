@@ -0,0 +1,62 @@
+#ifndef UPLOAD_TRANSPORT_H
+#define UPLOAD_TRANSPORT_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+enum class DeltaResult {
+    OK,           // Receiver rebuilt and stored the full dump
+    FAILED,       // Transient failure — retry later
+    NEED_FULL,    // Receiver can't apply it (missing base, CRC mismatch)
+    UNSUPPORTED   // Transport has no delta upload
+};
+
+// Backend that delivers dumps to the receiver. DataUploader owns one and
+// picks the implementation from the receiver URL scheme.
+class UploadTransport {
+public:
+    virtual ~UploadTransport() = default;
+
+    // Short name for logs and /api/status ("http", "mqtt")
+    virtual const char* name() const = 0;
+
+    // Call from loop() while connected — keep-alive, reconnects
+    virtual void update() {}
+
+    // Deliver one dump. crc is the CRC-32 of data, carried so the
+    // receiver can verify it; channel is the capture channel it came
+    // from. Returns true only once the receiver has acknowledged it, so
+    // the caller may drop it from the queue.
+    virtual bool send(const String& data, const String& timestamp, uint32_t id, uint32_t crc,
+                      uint8_t channel) = 0;
+
+    // As send(), for a dump too large to hold in RAM: length bytes are
+    // read from in, starting at its current position, STREAM_CHUNK at a
+    // time. in may be left anywhere.
+    virtual bool sendFile(File& in, size_t length, const String& timestamp, uint32_t id,
+                          uint32_t crc, uint8_t channel) = 0;
+
+    // Deliver the summary of dump id (JSON, see DumpSummary) ahead of
+    // the dump itself. crc is the CRC-32 of the full dump it describes.
+    // Returns true once the receiver has it — or has made clear it never
+    // will (a receiver without summary support), so the caller stops
+    // retrying.
+    virtual bool sendSummary(const String& json, const String& timestamp, uint32_t id,
+                             uint32_t crc, uint8_t channel) = 0;
+
+    // True if sendDelta() is implemented; delta fingerprints are only
+    // kept for transports that can use them
+    virtual bool supportsDelta() const { return false; }
+
+    // Deliver a dump as a delta against baseId (see DeltaEncoder). crc is
+    // still the CRC-32 of the full dump, checked after reconstruction.
+    virtual DeltaResult sendDelta(const String& /*delta*/, const String& /*timestamp*/, uint32_t /*id*/,
+                                  uint32_t /*crc*/, uint8_t /*channel*/, uint32_t /*baseId*/) {
+        return DeltaResult::UNSUPPORTED;
+    }
+
+    // Publish a device status snapshot (no-op for transports without one)
+    virtual void publishStatus(const String& /*json*/) {}
+};
+
+#endif // UPLOAD_TRANSPORT_H
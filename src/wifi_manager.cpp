@@ -1,8 +1,10 @@
 #include "wifi_manager.h"
 #include "config.h"
+#include "logger.h"
+#include "persistent_state.h"
 #include <time.h>
-#include <nvs_flash.h>
 #include <esp_wifi.h>
+#include <algorithm>
 
 // WiFi event handler — logs actual reason codes for connection failures
 static void _wifiEventHandler(WiFiEvent_t event, WiFiEventInfo_t info) {
@@ -25,11 +27,11 @@ static void _wifiEventHandler(WiFiEvent_t event, WiFiEventInfo_t info) {
                 case 204: tag = "HANDSHAKE_TIMEOUT"; break;
                 case 205: tag = "CONNECTION_FAIL"; break;
             }
-            Serial.printf("[WiFi] STA disconnected — reason %d (%s)\n", reason, tag);
+            Log.warn(LogModule::WIFI, "STA disconnected — reason %d (%s)", reason, tag);
             break;
         }
         case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-            Serial.printf("[WiFi] Got IP: %s\n", WiFi.localIP().toString().c_str());
+            Log.info(LogModule::WIFI, "Got IP: %s", WiFi.localIP().toString().c_str());
             break;
         default:
             break;
@@ -41,7 +43,10 @@ WiFiManager::WiFiManager()
     , _lastConnectAttempt(0)
     , _reconnectInterval(5000)
     , _connectAttempts(0)
-    , _timeSynced(false) {
+    , _timeSynced(false)
+    , _afterScan(AfterScan::NONE)
+    , _scanning(false)
+    , _scanTime(0) {
 }
 
 void WiFiManager::begin() {
@@ -49,31 +54,28 @@ void WiFiManager::begin() {
     WiFi.onEvent(_wifiEventHandler);
 
     // Load saved credentials from NVS
-    // First call with read-write to create the namespace if it doesn't exist
-    if (!_prefs.begin("wifi", false)) {
-        Serial.println("[WiFi] NVS init failed, formatting...");
-        nvs_flash_erase();
-        nvs_flash_init();
-        _prefs.begin("wifi", false);
-    }
-    _savedSSID = _prefs.getString("ssid", "");
-    _savedPassword = _prefs.getString("pass", "");
+    _savedSSID = State.getString("wifi", "ssid");
+    _savedPassword = State.getString("wifi", "pass");
     _savedSSID.trim();
     _savedPassword.trim();
-    _prefs.end();
 
     if (_savedSSID.length() > 0) {
-        Serial.printf("[WiFi] Saved network: %s\n", _savedSSID.c_str());
-        _scanNetworks();
-        _startSTA();
+        Log.info(LogModule::WIFI, "Saved network: %s", _savedSSID.c_str());
+        // Look for it first; the connect starts when the scan is done
+        WiFi.mode(WIFI_STA);
+        _mode = WiFiMode::CONNECTING;
+        _lastConnectAttempt = millis();
+        _afterScan = AfterScan::START;
+        if (!_beginScan()) _afterScanDone();
     } else {
-        Serial.println("[WiFi] No saved credentials, starting AP mode");
+        Log.info(LogModule::WIFI, "No saved credentials, starting AP mode");
         _startAP();
     }
 }
 
 void WiFiManager::update() {
     _updateLED();
+    _updateScan();
 
     switch (_mode) {
         case WiFiMode::AP_MODE:
@@ -85,68 +87,64 @@ void WiFiManager::update() {
             if (WiFi.getMode() == WIFI_AP_STA) {
                 _dnsServer.processNextRequest();
             }
+            if (_afterScan != AfterScan::NONE) {
+                break;  // Attempt paused for a scan
+            }
             if (WiFi.status() == WL_CONNECTED) {
                 _mode = WiFiMode::CONNECTED;
                 _connectAttempts = 0;
                 _reconnectInterval = 5000;
-                Serial.printf("[WiFi] Connected! IP: %s  RSSI: %d dBm\n",
-                              WiFi.localIP().toString().c_str(), WiFi.RSSI());
+                Log.info(LogModule::WIFI, "Connected! IP: %s  RSSI: %d dBm",
+                         WiFi.localIP().toString().c_str(), WiFi.RSSI());
 
                 // If we were in AP+STA mode, shut down the AP
                 if (WiFi.getMode() == WIFI_AP_STA) {
                     _dnsServer.stop();
                     WiFi.softAPdisconnect(true);
                     WiFi.mode(WIFI_STA);
-                    Serial.println("[WiFi] AP shut down (STA connected)");
+                    Log.info(LogModule::WIFI, "AP shut down (STA connected)");
                 }
 
                 // Start mDNS
                 if (MDNS.begin(DEVICE_HOSTNAME)) {
                     MDNS.addService("http", "tcp", WEB_SERVER_PORT);
-                    Serial.printf("[WiFi] mDNS: http://%s.local\n", DEVICE_HOSTNAME);
+                    Log.info(LogModule::WIFI, "mDNS: http://%s.local", DEVICE_HOSTNAME);
                 }
 
                 _initNTP();
             } else if (millis() - _lastConnectAttempt > 20000) {
                 // Connection attempt timed out (20s per attempt)
                 _connectAttempts++;
-                Serial.printf("[WiFi] Attempt %d timed out (status=%d)\n",
-                              _connectAttempts, WiFi.status());
-
-                // Scan every 3rd attempt to check signal
-                if (_connectAttempts % 3 == 0) {
-                    _scanNetworks();
-                }
+                Log.warn(LogModule::WIFI, "Attempt %d timed out (status=%d)",
+                         _connectAttempts, WiFi.status());
 
-                if (_connectAttempts >= 5 && WiFi.getMode() != WIFI_AP_STA) {
-                    // Start AP alongside STA so dashboard is reachable while retrying
-                    Serial.println("[WiFi] Starting AP+STA for dashboard access");
-                    _startAPSTA();
-                } else {
-                    // Retry — preserve AP+STA if already in that mode
-                    _retrySTA();
+                // Scan every 3rd attempt to check signal; the next
+                // attempt follows the scan
+                if (_connectAttempts % 3 == 0 && _beginScan()) {
+                    break;
                 }
+                _nextAttempt();
             }
             break;
 
         case WiFiMode::CONNECTED:
             if (WiFi.status() != WL_CONNECTED) {
                 _mode = WiFiMode::DISCONNECTED;
-                Serial.println("[WiFi] Connection lost");
+                Log.warn(LogModule::WIFI, "Connection lost");
             }
             // Check if NTP has synced
             if (!_timeSynced) {
                 struct tm timeinfo;
                 if (getLocalTime(&timeinfo, 0)) {
                     _timeSynced = true;
-                    Serial.printf("[WiFi] NTP synced: %s\n", getTimestamp().c_str());
+                    Log.info(LogModule::WIFI, "NTP synced: %s", getTimestamp().c_str());
                 }
             }
             break;
 
         case WiFiMode::DISCONNECTED:
             if (_savedSSID.length() > 0 && millis() - _lastConnectAttempt > _reconnectInterval) {
-                Serial.println("[WiFi] Attempting reconnect...");
+                Log.info(LogModule::WIFI, "Attempting reconnect...");
                 _connectAttempts = 0;
                 _startSTA();
                 // Exponential backoff: 5s, 10s, 20s, 40s, max 60s
@@ -183,16 +181,15 @@ void WiFiManager::setCredentials(const String& ssid, const String& password) {
     trimmedSSID.trim();
     trimmedPass.trim();
 
-    _prefs.begin("wifi", false);  // read-write
-    _prefs.putString("ssid", trimmedSSID);
-    _prefs.putString("pass", trimmedPass);
-    _prefs.end();
+    State.setString("wifi", "ssid", trimmedSSID);
+    State.setString("wifi", "pass", trimmedPass);
+    State.commit();
 
     _savedSSID = trimmedSSID;
     _savedPassword = trimmedPass;
     _connectAttempts = 0;
 
-    Serial.printf("[WiFi] Credentials saved for: %s\n", ssid.c_str());
+    Log.info(LogModule::WIFI, "Credentials saved for: %s", ssid.c_str());
 
     // Stop AP and try connecting
     _dnsServer.stop();
@@ -205,13 +202,12 @@ bool WiFiManager::hasSavedCredentials() const {
 }
 
 void WiFiManager::clearCredentials() {
-    _prefs.begin("wifi", false);
-    _prefs.remove("ssid");
-    _prefs.remove("pass");
-    _prefs.end();
+    State.remove("wifi", "ssid");
+    State.remove("wifi", "pass");
+    State.commit();
     _savedSSID = "";
     _savedPassword = "";
-    Serial.println("[WiFi] Credentials cleared");
+    Log.info(LogModule::WIFI, "Credentials cleared");
 }
 
 bool WiFiManager::isTimeSynced() const {
@@ -228,7 +224,26 @@ String WiFiManager::getTimestamp() const {
     return String(buf);
 }
 
+bool WiFiManager::startScan() {
+    if (_scanning) return true;
+    if (_scanTime != 0 && millis() - _scanTime < WIFI_SCAN_MIN_INTERVAL_MS) return false;
+    return _beginScan();
+}
+
+bool WiFiManager::isScanning() const {
+    return _scanning;
+}
+
+const std::vector<ScanResult>& WiFiManager::getScanResults() const {
+    return _scanResults;
+}
+
+unsigned long WiFiManager::getScanTime() const {
+    return _scanTime;
+}
+
 void WiFiManager::_startAP() {
+    _afterScan = AfterScan::NONE;
     WiFi.disconnect(true);
     WiFi.mode(WIFI_OFF);
     delay(100);
@@ -249,16 +264,17 @@ void WiFiManager::_startAP() {
     bool result = WiFi.softAP(AP_SSID, nullptr, 1, 0, 4);
     _mode = WiFiMode::AP_MODE;
 
-    Serial.printf("[WiFi] AP softAP() returned: %s\n", result ? "true" : "false");
-    Serial.printf("[WiFi] AP started: %s (password: %s)\n", AP_SSID, AP_PASSWORD);
-    Serial.printf("[WiFi] AP IP: %s\n", WiFi.softAPIP().toString().c_str());
-    Serial.printf("[WiFi] AP MAC: %s\n", WiFi.softAPmacAddress().c_str());
+    Log.info(LogModule::WIFI, "AP softAP() returned: %s", result ? "true" : "false");
+    Log.info(LogModule::WIFI, "AP started: %s (password: %s)", AP_SSID, AP_PASSWORD);
+    Log.info(LogModule::WIFI, "AP IP: %s", WiFi.softAPIP().toString().c_str());
+    Log.info(LogModule::WIFI, "AP MAC: %s", WiFi.softAPmacAddress().c_str());
 
     // DNS server redirects all requests to the AP IP (captive portal)
     _dnsServer.start(53, "*", WiFi.softAPIP());
 }
 
 void WiFiManager::_startSTA() {
+    _afterScan = AfterScan::NONE;   // A fresh attempt supersedes a paused one
     WiFi.disconnect(true);
     delay(100);
     WiFi.mode(WIFI_STA);
@@ -266,7 +282,7 @@ void WiFiManager::_startSTA() {
     WiFi.begin(_savedSSID.c_str(), _savedPassword.c_str());
     _mode = WiFiMode::CONNECTING;
     _lastConnectAttempt = millis();
-    Serial.printf("[WiFi] Connecting to %s...\n", _savedSSID.c_str());
+    Log.info(LogModule::WIFI, "Connecting to %s...", _savedSSID.c_str());
 }
 
 void WiFiManager::_retrySTA() {
@@ -275,9 +291,9 @@ void WiFiManager::_retrySTA() {
     delay(200);
     WiFi.begin(_savedSSID.c_str(), _savedPassword.c_str());
     _lastConnectAttempt = millis();
-    Serial.printf("[WiFi] Retrying %s... (attempt %d, mode=%s)\n",
-                  _savedSSID.c_str(), _connectAttempts + 1,
-                  WiFi.getMode() == WIFI_AP_STA ? "AP+STA" : "STA");
+    Log.info(LogModule::WIFI, "Retrying %s... (attempt %d, mode=%s)",
+             _savedSSID.c_str(), _connectAttempts + 1,
+             WiFi.getMode() == WIFI_AP_STA ? "AP+STA" : "STA");
 }
 
 void WiFiManager::_startAPSTA() {
@@ -300,37 +316,109 @@ void WiFiManager::_startAPSTA() {
     _mode = WiFiMode::CONNECTING;
     _lastConnectAttempt = millis();
 
-    Serial.printf("[WiFi] AP+STA mode — dashboard at %s, still trying %s\n",
-                  WiFi.softAPIP().toString().c_str(), _savedSSID.c_str());
+    Log.info(LogModule::WIFI, "AP+STA mode — dashboard at %s, still trying %s",
+             WiFi.softAPIP().toString().c_str(), _savedSSID.c_str());
 }
 
-void WiFiManager::_scanNetworks() {
-    Serial.println("[WiFi] Scanning...");
-    WiFi.mode(WIFI_STA);
-    delay(100);
-    int n = WiFi.scanNetworks(false, false, false, 300);  // active scan, 300ms/channel
-    if (n <= 0) {
-        Serial.println("[WiFi] No networks found!");
+void WiFiManager::_nextAttempt() {
+    if (_connectAttempts >= 5 && WiFi.getMode() != WIFI_AP_STA) {
+        // Start AP alongside STA so dashboard is reachable while retrying
+        Log.info(LogModule::WIFI, "Starting AP+STA for dashboard access");
+        _startAPSTA();
+    } else {
+        // Retry — preserve AP+STA if already in that mode
+        _retrySTA();
+    }
+}
+
+bool WiFiManager::_beginScan() {
+    if (_scanning) return true;
+
+    // The radio can't scan during a connect attempt — pause it
+    if (_mode == WiFiMode::CONNECTING && _afterScan == AfterScan::NONE) {
+        WiFi.disconnect(false);
+        _afterScan = AfterScan::RETRY;
+    }
+    // Scans run on the STA interface; enabling it leaves the AP up
+    if (WiFi.getMode() == WIFI_AP) {
+        WiFi.enableSTA(true);
+    }
+
+    // Async, active scan: update() collects the results
+    if (WiFi.scanNetworks(true, false, false, WIFI_SCAN_MS_PER_CHANNEL) == WIFI_SCAN_FAILED) {
+        Log.warn(LogModule::WIFI, "Scan failed to start");
+        if (_afterScan == AfterScan::RETRY) _afterScanDone();
+        return false;
+    }
+    _scanning = true;
+    Log.info(LogModule::WIFI, "Scanning...");
+    return true;
+}
+
+void WiFiManager::_updateScan() {
+    if (!_scanning) return;
+    int16_t n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING) return;
+    _scanning = false;
+
+    if (n == WIFI_SCAN_FAILED) {
+        Log.warn(LogModule::WIFI, "Scan failed");
     } else {
-        bool found = false;
+        _scanResults.clear();
         for (int i = 0; i < n; i++) {
-            Serial.printf("[WiFi]   %-20s  ch%-2d  %d dBm  %s\n",
-                          WiFi.SSID(i).c_str(), WiFi.channel(i), WiFi.RSSI(i),
-                          WiFi.encryptionType(i) == WIFI_AUTH_OPEN ? "open" : "encrypted");
-            if (WiFi.SSID(i) == _savedSSID) {
-                found = true;
-            }
+            ScanResult r;
+            r.ssid = WiFi.SSID(i);
+            r.rssi = WiFi.RSSI(i);
+            r.channel = WiFi.channel(i);
+            r.auth = WiFi.encryptionType(i);
+            Log.debug(LogModule::WIFI, "  %-20s  ch%-2d  %d dBm", r.ssid.c_str(), r.channel, r.rssi);
+            if (r.ssid.length() > 0) _scanResults.push_back(r);
+        }
+        WiFi.scanDelete();
+        _scanTime = millis();
+
+        // Strongest first, then keep one entry per SSID (mesh/extenders)
+        std::sort(_scanResults.begin(), _scanResults.end(),
+                  [](const ScanResult& a, const ScanResult& b) { return a.rssi > b.rssi; });
+        std::vector<ScanResult> unique;
+        for (const ScanResult& r : _scanResults) {
+            bool seen = false;
+            for (const ScanResult& u : unique) seen = seen || u.ssid == r.ssid;
+            if (!seen && unique.size() < WIFI_SCAN_MAX_RESULTS) unique.push_back(r);
         }
-        if (!found) {
-            Serial.printf("[WiFi] WARNING: '%s' not found in scan results!\n", _savedSSID.c_str());
+        _scanResults.swap(unique);
+
+        Log.info(LogModule::WIFI, "Scan found %d networks", n);
+        if (_savedSSID.length() > 0) {
+            const ScanResult* saved = nullptr;
+            for (const ScanResult& r : _scanResults) {
+                if (r.ssid == _savedSSID) saved = &r;
+            }
+            if (saved) {
+                Log.info(LogModule::WIFI, "'%s' on ch%d at %d dBm",
+                         _savedSSID.c_str(), saved->channel, saved->rssi);
+            } else {
+                Log.warn(LogModule::WIFI, "'%s' not found in scan results!", _savedSSID.c_str());
+            }
         }
     }
-    WiFi.scanDelete();
+    _afterScanDone();
+}
+
+void WiFiManager::_afterScanDone() {
+    AfterScan next = _afterScan;
+    _afterScan = AfterScan::NONE;
+    if (_mode != WiFiMode::CONNECTING) return;
+    if (next == AfterScan::START) {
+        _startSTA();
+    } else if (next == AfterScan::RETRY) {
+        _nextAttempt();
+    }
 }
 
 void WiFiManager::_initNTP() {
     configTime(DEFAULT_UTC_OFFSET, DEFAULT_DST_OFFSET, NTP_SERVER);
-    Serial.println("[WiFi] NTP sync started");
+    Log.info(LogModule::WIFI, "NTP sync started");
 }
 
 void WiFiManager::_updateLED() {
@@ -3,9 +3,9 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <Preferences.h>
 #include <DNSServer.h>
 #include <ESPmDNS.h>
+#include <vector>
 
 enum class WiFiMode {
     CONNECTING,   // Trying to connect to saved network
@@ -14,6 +14,14 @@ enum class WiFiMode {
     DISCONNECTED  // Lost connection, will retry
 };
 
+// One network from the last scan
+struct ScanResult {
+    String ssid;
+    int8_t rssi;
+    uint8_t channel;
+    wifi_auth_mode_t auth;
+};
+
 class WiFiManager {
 public:
     WiFiManager();
@@ -48,9 +56,20 @@ public:
     // Get formatted timestamp string
     String getTimestamp() const;
 
+    // Start a background scan; results arrive via update(). The AP stays
+    // up, and a connect attempt in progress is paused and retried after.
+    // False if the last scan is under WIFI_SCAN_MIN_INTERVAL_MS old (use
+    // the cached results) or the scan couldn't start.
+    bool startScan();
+    bool isScanning() const;
+
+    // Networks from the last completed scan, strongest first, one entry
+    // per SSID; getScanTime() is its millis(), 0 = never scanned
+    const std::vector<ScanResult>& getScanResults() const;
+    unsigned long getScanTime() const;
+
 private:
     WiFiMode _mode;
-    Preferences _prefs;
     DNSServer _dnsServer;
     String _savedSSID;
     String _savedPassword;
@@ -59,11 +78,21 @@ private:
     uint8_t _connectAttempts;
     bool _timeSynced;
 
+    // What the connect logic was waiting on the scan to do
+    enum class AfterScan { NONE, START, RETRY };
+    AfterScan _afterScan;
+    bool _scanning;
+    unsigned long _scanTime;
+    std::vector<ScanResult> _scanResults;
+
     void _startAP();
     void _startSTA();
     void _retrySTA();
     void _startAPSTA();
-    void _scanNetworks();
+    void _nextAttempt();
+    bool _beginScan();
+    void _updateScan();
+    void _afterScanDone();
     void _initNTP();
     void _updateLED();
 };
@@ -0,0 +1,60 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino-ESP32 core to build the capture, queue and
+// status code on a PC for the native benchmark. Not a simulator: there
+// is no UART, WiFi or web server, and flash is a RAM image (LittleFS.h).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include "WString.h"
+#include "Stream.h"
+#include "freertos/FreeRTOS.h"
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define F(s) (s)
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define SERIAL_8N1 0x800001c
+#define SERIAL_8N2 0x800003c
+#define SERIAL_7E1 0x800001a
+#define SERIAL_7O1 0x800001b
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// Console output; quiet unless BENCH_VERBOSE is set in the environment
+class HardwareSerial : public Stream {
+public:
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int availableForWrite() { return 4096; }
+    explicit operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_ARDUINO_H
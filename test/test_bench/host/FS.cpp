@@ -0,0 +1,146 @@
+#include "FS.h"
+#include "LittleFS.h"
+
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!_impl || !_impl->data || !_impl->writable) return 0;
+    std::vector<uint8_t>& d = *_impl->data;
+    if (_impl->pos + size > d.size()) d.resize(_impl->pos + size);
+    memcpy(d.data() + _impl->pos, buf, size);
+    _impl->pos += size;
+    return size;
+}
+
+int File::available() {
+    if (!_impl || !_impl->data) return 0;
+    return (int)(_impl->data->size() - _impl->pos);
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!_impl || !_impl->data || _impl->pos >= _impl->data->size()) return -1;
+    return (*_impl->data)[_impl->pos];
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!_impl || !_impl->data) return 0;
+    size_t left = _impl->data->size() - _impl->pos;
+    if (size > left) size = left;
+    memcpy(buf, _impl->data->data() + _impl->pos, size);
+    _impl->pos += size;
+    return size;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_impl || !_impl->data) return false;
+    size_t base = mode == SeekSet ? 0 : (mode == SeekCur ? _impl->pos : _impl->data->size());
+    if (base + pos > _impl->data->size()) return false;
+    _impl->pos = base + pos;
+    return true;
+}
+
+const char* File::name() const {
+    if (!_impl) return "";
+    size_t slash = _impl->path.rfind('/');
+    return _impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+File File::openNextFile(const char* mode) {
+    if (!isDirectory() || _impl->next >= _impl->entries.size()) return File();
+    return _impl->fs->open(_impl->entries[_impl->next++].c_str(), mode);
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    std::string p(path);
+    if (_dirs.count(p) || p == "/") {
+        std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+        impl->path = p;
+        impl->fs = this;
+        std::string prefix = (p == "/") ? "/" : p + "/";
+        for (auto& f : _files) {
+            if (f.first.compare(0, prefix.size(), prefix) == 0 && _parent(f.first) == p) {
+                impl->entries.push_back(f.first);
+            }
+        }
+        for (auto& d : _dirs) {
+            if (d.first != p && _parent(d.first) == p) impl->entries.push_back(d.first);
+        }
+        return File(impl);
+    }
+
+    auto it = _files.find(p);
+    bool write = mode[0] == 'w' || mode[0] == 'a' || strchr(mode, '+');
+    if (it == _files.end()) {
+        if (!write) return File();
+        std::string parent = _parent(p);
+        if (parent != "/" && !_dirs.count(parent)) {
+            if (!create) return File();
+            mkdir(parent.c_str());
+        }
+        it = _files.insert(std::make_pair(p, std::make_shared<std::vector<uint8_t>>())).first;
+    }
+
+    std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+    impl->path = p;
+    impl->data = it->second;
+    impl->writable = write;
+    impl->fs = this;
+    if (mode[0] == 'w') impl->data->clear();
+    if (mode[0] == 'a') impl->pos = impl->data->size();
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    return _files.count(path) || _dirs.count(path);
+}
+
+bool FS::remove(const char* path) {
+    return _files.erase(path) > 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    auto it = _files.find(from);
+    if (it == _files.end()) return false;
+    std::shared_ptr<std::vector<uint8_t>> data = it->second;
+    _files.erase(it);
+    _files[to] = data;
+    return true;
+}
+
+bool FS::mkdir(const char* path) {
+    std::string p(path);
+    std::string parent = _parent(p);
+    if (parent != "/" && !_dirs.count(parent)) mkdir(parent.c_str());
+    _dirs[p] = true;
+    return true;
+}
+
+bool FS::rmdir(const char* path) {
+    return _dirs.erase(path) > 0;
+}
+
+void FS::clear() {
+    _files.clear();
+    _dirs.clear();
+}
+
+size_t FS::usedBytes() {
+    // LittleFS allocates whole 4 KB blocks
+    size_t used = 0;
+    for (auto& f : _files) used += (f.second->size() + 4095) / 4096 * 4096;
+    return used + _dirs.size() * 4096;
+}
+
+std::string FS::_parent(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return (slash == 0 || slash == std::string::npos) ? "/" : path.substr(0, slash);
+}
+
+}  // namespace fs
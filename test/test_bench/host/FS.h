@@ -0,0 +1,96 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// RAM-backed filesystem with the Arduino-ESP32 fs::FS interface. Each
+// benchmark run starts from an empty image, so results don't depend on
+// the state of a disk or on what an earlier run left behind.
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FS;
+
+struct FileImpl {
+    std::string path;
+    std::shared_ptr<std::vector<uint8_t>> data;   // null for a directory
+    size_t pos = 0;
+    bool writable = false;
+    std::vector<std::string> entries;             // Directory listing
+    size_t next = 0;
+    FS* fs = nullptr;
+};
+
+class File : public Stream {
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : _impl(impl) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* buf, size_t size);
+    size_t readBytes(uint8_t* buf, size_t length) override { return read(buf, length); }
+    using Stream::readBytes;
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const { return _impl ? _impl->pos : 0; }
+    size_t size() const { return (_impl && _impl->data) ? _impl->data->size() : 0; }
+    void flush() override {}
+    void close() { _impl.reset(); }
+    operator bool() const { return (bool)_impl; }
+    const char* path() const { return _impl ? _impl->path.c_str() : ""; }
+    const char* name() const;
+    bool isDirectory() const { return _impl && !_impl->data; }
+    File openNextFile(const char* mode = "r");
+    void rewindDirectory() { if (_impl) _impl->next = 0; }
+    time_t getLastWrite() { return 0; }
+
+private:
+    std::shared_ptr<FileImpl> _impl;
+};
+
+class FS {
+public:
+    File open(const char* path, const char* mode = "r", bool create = false);
+    File open(const String& path, const char* mode = "r", bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+    // Empty the image
+    void clear();
+    size_t usedBytes();
+
+private:
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> _files;
+    std::map<std::string, bool> _dirs;
+
+    static std::string _parent(const std::string& path);
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekSet;
+
+#endif // HOST_FS_H
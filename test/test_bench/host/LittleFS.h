@@ -0,0 +1,26 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <FS.h>
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+    bool begin(bool /*formatOnFail*/ = false, const char* /*basePath*/ = "/littlefs",
+               uint8_t /*maxOpenFiles*/ = 10, const char* /*partitionLabel*/ = "spiffs") {
+        return true;
+    }
+    void end() {}
+    bool format() {
+        clear();
+        return true;
+    }
+    size_t totalBytes() { return 1441792; }   // default.csv data partition
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
@@ -0,0 +1,82 @@
+#ifndef HOST_STREAM_H
+#define HOST_STREAM_H
+
+#include <cstdarg>
+#include <cstdio>
+#include "WString.h"
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) {
+        size_t n = 0;
+        while (size-- && write(*buf++)) n++;
+        return n;
+    }
+    size_t write(const char* buf, size_t size) { return write((const uint8_t*)buf, size); }
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+    virtual void flush() {}
+
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t println() { return write("\r\n"); }
+    size_t println(const String& s) { return print(s) + println(); }
+    size_t println(const char* s) { return print(s) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char small[64];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(small, sizeof(small), format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+        char* big = (char*)malloc(n + 1);
+        if (!big) return 0;
+        va_start(args, format);
+        vsnprintf(big, n + 1, format, args);
+        va_end(args);
+        size_t w = write((const uint8_t*)big, n);
+        free(big);
+        return w;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long) {}
+
+    virtual size_t readBytes(uint8_t* buf, size_t length) {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0) buf[n++] = (uint8_t)c;
+        return n;
+    }
+    size_t readBytes(char* buf, size_t length) { return readBytes((uint8_t*)buf, length); }
+
+    String readStringUntil(char terminator) {
+        String ret;
+        int c;
+        while ((c = read()) >= 0 && c != terminator) ret += (char)c;
+        return ret;
+    }
+
+    String readString() {
+        String ret;
+        int c;
+        while ((c = read()) >= 0) ret += (char)c;
+        return ret;
+    }
+};
+
+#endif // HOST_STREAM_H
@@ -0,0 +1,335 @@
+#include "WString.h"
+#include <cctype>
+#include <cstdio>
+#include <strings.h>
+
+String::String(const char* cstr) : _buf(nullptr), _cap(0), _len(0) {
+    if (cstr) _copy(cstr, strlen(cstr));
+}
+
+String::String(const char* cstr, unsigned int length) : _buf(nullptr), _cap(0), _len(0) {
+    if (cstr) _copy(cstr, length);
+}
+
+String::String(const String& str) : _buf(nullptr), _cap(0), _len(0) {
+    *this = str;
+}
+
+String::String(String&& str) : _buf(str._buf), _cap(str._cap), _len(str._len) {
+    str._buf = nullptr;
+    str._cap = 0;
+    str._len = 0;
+}
+
+String::String(char c) : _buf(nullptr), _cap(0), _len(0) {
+    _copy(&c, 1);
+}
+
+static void formatInt(char* out, size_t cap, unsigned long long v, bool neg, unsigned char base) {
+    char tmp[66];
+    int n = 0;
+    do {
+        unsigned d = v % base;
+        tmp[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+        v /= base;
+    } while (v > 0);
+    size_t i = 0;
+    if (neg) out[i++] = '-';
+    while (n > 0 && i < cap - 1) out[i++] = tmp[--n];
+    out[i] = '\0';
+}
+
+#define STRING_FROM_SIGNED(T)                                                       \
+    String::String(T value, unsigned char base) : _buf(nullptr), _cap(0), _len(0) { \
+        char b[68];                                                                 \
+        bool neg = value < 0 && base == 10;                                         \
+        formatInt(b, sizeof(b), neg ? 0ULL - (unsigned long long)value             \
+                                    : (unsigned long long)value, neg, base);       \
+        _copy(b, strlen(b));                                                        \
+    }
+#define STRING_FROM_UNSIGNED(T)                                                     \
+    String::String(T value, unsigned char base) : _buf(nullptr), _cap(0), _len(0) { \
+        char b[68];                                                                 \
+        formatInt(b, sizeof(b), value, false, base);                                \
+        _copy(b, strlen(b));                                                        \
+    }
+STRING_FROM_UNSIGNED(unsigned char)
+STRING_FROM_SIGNED(int)
+STRING_FROM_UNSIGNED(unsigned int)
+STRING_FROM_SIGNED(long)
+STRING_FROM_UNSIGNED(unsigned long)
+STRING_FROM_SIGNED(long long)
+STRING_FROM_UNSIGNED(unsigned long long)
+
+String::String(float value, unsigned int decimals) : _buf(nullptr), _cap(0), _len(0) {
+    char b[48];
+    snprintf(b, sizeof(b), "%.*f", decimals, (double)value);
+    _copy(b, strlen(b));
+}
+
+String::String(double value, unsigned int decimals) : _buf(nullptr), _cap(0), _len(0) {
+    char b[48];
+    snprintf(b, sizeof(b), "%.*f", decimals, value);
+    _copy(b, strlen(b));
+}
+
+String::~String() {
+    free(_buf);
+}
+
+String& String::operator=(const String& rhs) {
+    if (this == &rhs) return *this;
+    if (rhs._buf) _copy(rhs._buf, rhs._len);
+    else _len = 0;
+    if (_buf) _buf[_len] = '\0';
+    return *this;
+}
+
+String& String::operator=(String&& rhs) {
+    if (this == &rhs) return *this;
+    free(_buf);
+    _buf = rhs._buf;
+    _cap = rhs._cap;
+    _len = rhs._len;
+    rhs._buf = nullptr;
+    rhs._cap = 0;
+    rhs._len = 0;
+    return *this;
+}
+
+String& String::operator=(const char* cstr) {
+    if (cstr) _copy(cstr, strlen(cstr));
+    else _len = 0;
+    if (_buf) _buf[_len] = '\0';
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    if (_buf && _cap >= size) return true;
+    if (!_grow(size)) return false;
+    if (_len == 0) _buf[0] = '\0';
+    return true;
+}
+
+bool String::_grow(unsigned int size) {
+    // Exact size, as the core's changeBuffer() does
+    char* p = (char*)realloc(_buf, size + 1);
+    if (!p) return false;
+    _buf = p;
+    _cap = size;
+    return true;
+}
+
+void String::_copy(const char* cstr, unsigned int length) {
+    if (!reserve(length)) return;
+    memmove(_buf, cstr, length);
+    _len = length;
+    _buf[_len] = '\0';
+}
+
+bool String::concat(const char* cstr, unsigned int length) {
+    if (!cstr) return false;
+    if (length == 0) return true;
+    // cstr may point into our own buffer
+    size_t off = (_buf && cstr >= _buf && cstr < _buf + _len) ? cstr - _buf : (size_t)-1;
+    if (!reserve(_len + length)) return false;
+    if (off != (size_t)-1) cstr = _buf + off;
+    memmove(_buf + _len, cstr, length);
+    _len += length;
+    _buf[_len] = '\0';
+    return true;
+}
+
+bool String::concat(const String& str) {
+    return concat(str.c_str(), str._len);
+}
+
+bool String::concat(const char* cstr) {
+    return cstr && concat(cstr, strlen(cstr));
+}
+
+bool String::concat(char c) {
+    return concat(&c, 1);
+}
+
+bool String::concat(int num) {
+    return concat(String(num));
+}
+
+bool String::concat(unsigned int num) {
+    return concat(String(num));
+}
+
+bool String::concat(long num) {
+    return concat(String(num));
+}
+
+bool String::concat(unsigned long num) {
+    return concat(String(num));
+}
+
+bool String::equals(const String& s) const {
+    return _len == s._len && memcmp(c_str(), s.c_str(), _len) == 0;
+}
+
+bool String::equals(const char* cstr) const {
+    return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::equalsIgnoreCase(const String& s) const {
+    return _len == s._len && strncasecmp(c_str(), s.c_str(), _len) == 0;
+}
+
+bool String::startsWith(const String& prefix) const {
+    return prefix._len <= _len && memcmp(c_str(), prefix.c_str(), prefix._len) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return suffix._len <= _len && memcmp(c_str() + _len - suffix._len, suffix.c_str(), suffix._len) == 0;
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _len) {
+        dummy = 0;
+        return dummy;
+    }
+    return _buf[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+    if (!bufsize || !buf) return;
+    if (index >= _len) {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if (n > _len - index) n = _len - index;
+    memcpy(buf, _buf + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* p = (const char*)memchr(_buf + fromIndex, ch, _len - fromIndex);
+    return p ? (int)(p - _buf) : -1;
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+    if (fromIndex >= _len) return -1;
+    const char* p = strstr(_buf + fromIndex, str.c_str());
+    return p ? (int)(p - _buf) : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+    for (int i = (int)_len - 1; i >= 0; i--) {
+        if (_buf[i] == ch) return i;
+    }
+    return -1;
+}
+
+int String::lastIndexOf(const String& str) const {
+    if (str._len > _len) return -1;
+    for (int i = (int)(_len - str._len); i >= 0; i--) {
+        if (memcmp(_buf + i, str.c_str(), str._len) == 0) return i;
+    }
+    return -1;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+    if (left > right) {
+        unsigned int t = left;
+        left = right;
+        right = t;
+    }
+    if (left >= _len) return String();
+    if (right > _len) right = _len;
+    return String(_buf + left, right - left);
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (_len == 0 || find._len == 0) return;
+    String out;
+    unsigned int pos = 0;
+    int hit;
+    while ((hit = indexOf(find, pos)) >= 0) {
+        out.concat(_buf + pos, hit - pos);
+        out.concat(replace);
+        pos = hit + find._len;
+    }
+    out.concat(_buf + pos, _len - pos);
+    *this = out;
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _len) return;
+    if (count > _len - index) count = _len - index;
+    memmove(_buf + index, _buf + index + count, _len - index - count);
+    _len -= count;
+    _buf[_len] = '\0';
+}
+
+void String::toLowerCase() {
+    for (unsigned int i = 0; i < _len; i++) _buf[i] = tolower((unsigned char)_buf[i]);
+}
+
+void String::toUpperCase() {
+    for (unsigned int i = 0; i < _len; i++) _buf[i] = toupper((unsigned char)_buf[i]);
+}
+
+void String::trim() {
+    if (_len == 0) return;
+    unsigned int begin = 0;
+    while (begin < _len && isspace((unsigned char)_buf[begin])) begin++;
+    unsigned int end = _len;
+    while (end > begin && isspace((unsigned char)_buf[end - 1])) end--;
+    _len = end - begin;
+    if (begin > 0) memmove(_buf, _buf + begin, _len);
+    _buf[_len] = '\0';
+}
+
+StringSumHelper operator+(const StringSumHelper& lhs, const String& rhs) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(rhs);
+    return a;
+}
+
+StringSumHelper operator+(const StringSumHelper& lhs, const char* cstr) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(cstr);
+    return a;
+}
+
+StringSumHelper operator+(const StringSumHelper& lhs, char c) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(c);
+    return a;
+}
+
+StringSumHelper operator+(const StringSumHelper& lhs, int num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(num);
+    return a;
+}
+
+StringSumHelper operator+(const StringSumHelper& lhs, unsigned int num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(num);
+    return a;
+}
+
+StringSumHelper operator+(const StringSumHelper& lhs, long num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(num);
+    return a;
+}
+
+StringSumHelper operator+(const StringSumHelper& lhs, unsigned long num) {
+    StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+    a.concat(num);
+    return a;
+}
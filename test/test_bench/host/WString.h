@@ -0,0 +1,118 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Arduino String for the host build. Allocates the way the ESP32 core's
+// WString does — one realloc to the exact length whenever a change
+// outgrows the buffer — so allocation counts track the device. (The
+// core also keeps strings under 12 bytes inline; this doesn't, so short
+// strings count an allocation the device wouldn't make.)
+class String {
+public:
+    String(const char* cstr = "");
+    String(const char* cstr, unsigned int length);
+    String(const String& str);
+    String(String&& str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimals = 2);
+    explicit String(double value, unsigned int decimals = 2);
+    ~String();
+
+    String& operator=(const String& rhs);
+    String& operator=(String&& rhs);
+    String& operator=(const char* cstr);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _len; }
+    bool isEmpty() const { return _len == 0; }
+    const char* c_str() const { return _buf ? _buf : ""; }
+
+    bool concat(const String& str);
+    bool concat(const char* cstr);
+    bool concat(const char* cstr, unsigned int length);
+    bool concat(char c);
+    bool concat(int num);
+    bool concat(unsigned int num);
+    bool concat(long num);
+    bool concat(unsigned long num);
+
+    template <typename T>
+    String& operator+=(const T& rhs) {
+        concat(rhs);
+        return *this;
+    }
+
+    bool equals(const String& s) const;
+    bool equals(const char* cstr) const;
+    bool equalsIgnoreCase(const String& s) const;
+    bool operator==(const String& rhs) const { return equals(rhs); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& rhs) const { return !equals(rhs); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& rhs) const { return strcmp(c_str(), rhs.c_str()) < 0; }
+    bool startsWith(const String& prefix) const;
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const { return index < _len ? _buf[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < _len) _buf[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index);
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String& str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(const String& str) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const { return _buf ? atol(_buf) : 0; }
+    float toFloat() const { return _buf ? (float)atof(_buf) : 0; }
+
+private:
+    char* _buf;
+    unsigned int _cap;
+    unsigned int _len;
+
+    bool _grow(unsigned int size);
+    void _copy(const char* cstr, unsigned int length);
+};
+
+// ArduinoJson's String adapter also names this type
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* p) : String(p) {}
+};
+
+StringSumHelper operator+(const StringSumHelper& lhs, const String& rhs);
+StringSumHelper operator+(const StringSumHelper& lhs, const char* cstr);
+StringSumHelper operator+(const StringSumHelper& lhs, char c);
+StringSumHelper operator+(const StringSumHelper& lhs, int num);
+StringSumHelper operator+(const StringSumHelper& lhs, unsigned int num);
+StringSumHelper operator+(const StringSumHelper& lhs, long num);
+StringSumHelper operator+(const StringSumHelper& lhs, unsigned long num);
+inline StringSumHelper operator+(const String& lhs, const String& rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, const char* rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const char* lhs, const String& rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, char rhs) { return StringSumHelper(lhs) + rhs; }
+
+#endif // HOST_WSTRING_H
@@ -0,0 +1,8 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+
+#endif // HOST_FREERTOS_QUEUE_H
@@ -0,0 +1,219 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <driver/uart.h>
+#include <esp_ota_ops.h>
+#include <esp_timer.h>
+#include <nvs_flash.h>
+#include <chrono>
+#include "host.h"
+
+// --- Clock ---
+// delay() moves the clock on instead of sleeping, so timeouts in the
+// code under test don't stretch the benchmark
+
+static const std::chrono::steady_clock::time_point s_start = std::chrono::steady_clock::now();
+static uint64_t s_skippedUs = 0;
+
+static uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - s_start).count() + s_skippedUs;
+}
+
+unsigned long millis() {
+    return (unsigned long)(nowUs() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)nowUs();
+}
+
+int64_t esp_timer_get_time() {
+    return (int64_t)nowUs();
+}
+
+void delay(unsigned long ms) {
+    s_skippedUs += (uint64_t)ms * 1000;
+}
+
+void yield() {}
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+
+// --- Console ---
+
+static bool verbose() {
+    static int on = -1;
+    if (on < 0) on = getenv("BENCH_VERBOSE") != nullptr;
+    return on;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t size) {
+    if (verbose()) fwrite(buf, 1, size, stderr);
+    return size;
+}
+
+HardwareSerial Serial;
+
+// --- ESP-IDF ---
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t) { return ESP_OK; }
+uint32_t esp_get_free_heap_size(void) { return 200000; }
+esp_err_t nvs_flash_init() { return ESP_OK; }
+esp_err_t nvs_flash_erase() { return ESP_OK; }
+
+int esp_ota_get_app_elf_sha256(char* dst, size_t size) {
+    return snprintf(dst, size, "%s", "native");
+}
+
+esp_err_t uart_driver_install(uart_port_t, int, int, int, QueueHandle_t* queue, int) {
+    if (queue) *queue = nullptr;
+    return ESP_OK;
+}
+esp_err_t uart_param_config(uart_port_t, const uart_config_t*) { return ESP_OK; }
+esp_err_t uart_set_pin(uart_port_t, int, int, int, int) { return ESP_OK; }
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t, char, uint8_t, int, int, int) { return ESP_OK; }
+esp_err_t uart_pattern_queue_reset(uart_port_t, int) { return ESP_OK; }
+int uart_pattern_pop_pos(uart_port_t) { return -1; }
+int uart_read_bytes(uart_port_t, void*, uint32_t, TickType_t) { return 0; }
+int uart_write_bytes(uart_port_t, const void*, size_t size) { return (int)size; }
+esp_err_t uart_set_hw_flow_ctrl(uart_port_t, uart_hw_flowcontrol_t, uint8_t) { return ESP_OK; }
+esp_err_t uart_set_rts(uart_port_t, int) { return ESP_OK; }
+
+esp_err_t uart_get_buffered_data_len(uart_port_t, size_t* size) {
+    *size = 0;
+    return ESP_OK;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t, void*, TickType_t) {
+    return pdFALSE;
+}
+
+// --- NVS ---
+
+static std::map<std::string, std::vector<uint8_t>> s_nvs;
+
+bool Preferences::begin(const char* name, bool) {
+    _ns = name;
+    return true;
+}
+
+std::vector<uint8_t>* Preferences::_find(const char* key) {
+    auto it = s_nvs.find(_ns + "/" + key);
+    return it == s_nvs.end() ? nullptr : &it->second;
+}
+
+size_t Preferences::_put(const char* key, const void* value, size_t len) {
+    s_nvs[_ns + "/" + key].assign((const uint8_t*)value, (const uint8_t*)value + len);
+    return len;
+}
+
+bool Preferences::isKey(const char* key) {
+    return _find(key) != nullptr;
+}
+
+bool Preferences::remove(const char* key) {
+    return s_nvs.erase(_ns + "/" + key) > 0;
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    return getUChar(key, defaultValue ? 1 : 0) != 0;
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+    std::vector<uint8_t>* v = _find(key);
+    return (v && v->size() == 1) ? (*v)[0] : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    std::vector<uint8_t>* v = _find(key);
+    if (!v || v->size() != sizeof(uint32_t)) return defaultValue;
+    uint32_t value;
+    memcpy(&value, v->data(), sizeof(value));
+    return value;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    std::vector<uint8_t>* v = _find(key);
+    return v ? String((const char*)v->data(), v->size()) : defaultValue;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    std::vector<uint8_t>* v = _find(key);
+    return v ? v->size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    std::vector<uint8_t>* v = _find(key);
+    if (!v || v->size() > maxLen) return 0;
+    memcpy(buf, v->data(), v->size());
+    return v->size();
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+    return putUChar(key, value ? 1 : 0);
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+    return _put(key, &value, 1);
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return _put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putString(const char* key, const String& value) {
+    return _put(key, value.c_str(), value.length());
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    return _put(key, value, len);
+}
+
+// --- Allocation counting ---
+
+static bool s_counting = false;
+static uint64_t s_allocs = 0;
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    if (s_counting) s_allocs++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    if (s_counting) s_allocs++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (s_counting) s_allocs++;
+    return __libc_realloc(ptr, size);
+}
+}
+
+bool hostAllocCounting() {
+    return true;
+}
+#else
+bool hostAllocCounting() {
+    return false;
+}
+#endif
+
+void hostCountAllocs(bool on) {
+    s_counting = on;
+}
+
+uint64_t hostAllocs() {
+    return s_allocs;
+}
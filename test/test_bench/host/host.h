@@ -0,0 +1,13 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <cstdint>
+
+// Heap allocation counting for the benchmark (glibc only: malloc,
+// calloc and realloc are interposed and counted while counting is on,
+// which includes operator new). hostAllocCounting() is false elsewhere.
+bool hostAllocCounting();
+void hostCountAllocs(bool on);
+uint64_t hostAllocs();
+
+#endif // HOST_H
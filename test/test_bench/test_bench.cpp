@@ -0,0 +1,284 @@
+// Host benchmark of the per-dump paths: capture ingest, preview, queue
+// record write/read-back and the upload part of /api/status, run over
+// each dump in corpus/. Reports ns/byte and heap allocations per dump
+// and fails on a regression against baseline.txt.
+//
+//   pio test -e native                  compare against the baseline
+//   BENCH_SAVE=1 pio test -e native     rewrite the baseline
+//
+// Allocation counts are deterministic, so any increase fails. Times are
+// compared with BENCH_TOLERANCE_PCT (+ BENCH_TOLERANCE_NS) of slack; a
+// baseline is only meaningful on the machine that recorded it.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <unity.h>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "crc32.h"
+#include "queue_record.h"
+#include "serial_comm.h"
+#include "status_json.h"
+#include "host/host.h"
+
+#define BENCH_MIN_TIME_MS 200        // Repeat each case for at least this long
+#define BENCH_MIN_ITERATIONS 5
+#define BENCH_ROUNDS 5               // Best of this many timed rounds
+#define BENCH_TOLERANCE_PCT 25       // Slower than baseline by more = regression
+#define BENCH_TOLERANCE_NS 0.5       // Plus this much, so sub-ns cases aren't all noise
+
+struct BenchResult {
+    std::string name;
+    double nsPerByte = 0;
+    double allocs = -1;       // Per dump; -1 = not counted on this host
+};
+
+struct Baseline {
+    double nsPerByte;
+    double allocs;
+};
+
+struct CorpusDump {
+    std::string name;         // File name without .txt
+    String data;
+};
+
+static std::vector<CorpusDump> s_corpus;
+static std::map<std::string, Baseline> s_baseline;
+static std::vector<BenchResult> s_results;
+
+static std::string benchDir() {
+    std::string file = __FILE__;
+    size_t slash = file.rfind('/');
+    return slash == std::string::npos ? "." : file.substr(0, slash);
+}
+
+static bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+static void loadCorpus() {
+    const char* names[] = { "ticket", "truck_db", "audit" };
+    for (const char* name : names) {
+        std::string bytes;
+        if (!readFile(benchDir() + "/corpus/" + name + ".txt", bytes)) continue;
+        CorpusDump dump;
+        dump.name = name;
+        dump.data = String(bytes.data(), bytes.size());
+        s_corpus.push_back(dump);
+    }
+}
+
+static void loadBaseline() {
+    std::ifstream in((benchDir() + "/baseline.txt").c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        Baseline b;
+        if (fields >> name >> b.nsPerByte >> b.allocs) {
+            s_baseline[name] = b;
+        }
+    }
+}
+
+static void saveBaseline() {
+    std::ofstream out((benchDir() + "/baseline.txt").c_str());
+    out << "# name ns_per_byte allocs_per_dump (BENCH_SAVE=1 pio test -e native)\n";
+    for (const BenchResult& r : s_results) {
+        char line[128];
+        snprintf(line, sizeof(line), "%s %.3f %.0f\n", r.name.c_str(), r.nsPerByte, r.allocs);
+        out << line;
+    }
+    printf("bench: baseline saved (%u cases)\n", (unsigned)s_results.size());
+}
+
+// Runs fn until it has taken BENCH_MIN_TIME_MS, BENCH_ROUNDS times, and
+// keeps the fastest round. The first call is a warm-up: first-use
+// allocations (buffer reserves, file creation) are not part of the
+// steady-state per-dump cost.
+static void measure(const std::string& name, size_t bytes, std::function<void()> fn) {
+    fn();
+
+    BenchResult r;
+    r.name = name;
+
+    if (hostAllocCounting()) {
+        uint64_t before = hostAllocs();
+        hostCountAllocs(true);
+        fn();
+        hostCountAllocs(false);
+        r.allocs = (double)(hostAllocs() - before);
+    }
+
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        uint32_t iterations = 0;
+        uint64_t start = micros();
+        uint64_t elapsed = 0;
+        while (iterations < BENCH_MIN_ITERATIONS || elapsed < BENCH_MIN_TIME_MS * 1000ULL) {
+            fn();
+            iterations++;
+            elapsed = micros() - start;
+        }
+        double ns = (double)elapsed * 1000.0 / ((double)bytes * iterations);
+        if (round == 0 || ns < best) best = ns;
+    }
+    r.nsPerByte = best;
+
+    printf("bench: %-22s %9.2f ns/B %7.0f allocs\n", r.name.c_str(), r.nsPerByte, r.allocs);
+    s_results.push_back(r);
+}
+
+// Checks the results of one stage (names starting with prefix)
+static void compare(const std::string& prefix) {
+    std::string failures;
+    for (const BenchResult& r : s_results) {
+        if (r.name.compare(0, prefix.size(), prefix) != 0) continue;
+        auto it = s_baseline.find(r.name);
+        if (it == s_baseline.end()) continue;
+        const Baseline& base = it->second;
+
+        bool slower = base.nsPerByte > 0
+            && r.nsPerByte > base.nsPerByte * (100 + BENCH_TOLERANCE_PCT) / 100 + BENCH_TOLERANCE_NS;
+        bool moreAllocs = r.allocs >= 0 && base.allocs >= 0 && r.allocs > base.allocs + 0.5;
+        if (slower || moreAllocs) {
+            char line[160];
+            snprintf(line, sizeof(line), "%s: %.2f ns/B (base %.2f), %.0f allocs (base %.0f); ",
+                     r.name.c_str(), r.nsPerByte, base.nsPerByte, r.allocs, base.allocs);
+            failures += line;
+        }
+    }
+    if (!failures.empty()) {
+        TEST_FAIL_MESSAGE(failures.c_str());
+    }
+}
+
+// Bytes arrive in UART_READ_CHUNK reads, as from the driver, on a
+// channel that is never begin()'d: no UART, same code path. Dumps past
+// SPILL_RAM_WATERMARK go through the spill file on the RAM image.
+static void test_ingest() {
+    SerialComm capture(0, RS232_UART_NUM, -1, -1, RS232_BAUD, RS232_CONFIG);
+    for (const CorpusDump& c : s_corpus) {
+        const String& data = c.data;
+        measure("ingest_" + c.name, data.length(), [&]() {
+            const uint8_t* p = (const uint8_t*)data.c_str();
+            size_t left = data.length();
+            while (left > 0) {
+                size_t n = min(left, (size_t)UART_READ_CHUNK);
+                capture.inject(p, n);
+                p += n;
+                left -= n;
+            }
+            capture.flushDump();
+        });
+    }
+    compare("ingest_");
+}
+
+static void test_preview() {
+    for (const CorpusDump& c : s_corpus) {
+        measure("preview_" + c.name, c.data.length(), [&]() {
+            String preview = dumpPreview(c.data);
+        });
+    }
+    compare("preview_");
+}
+
+static void test_queue_record() {
+    String path = String(QUEUE_DIR) + "/1.tsv";
+    for (const CorpusDump& c : s_corpus) {
+        const String& data = c.data;
+        uint32_t crc = crc32Of(data);
+
+        measure("q_write_" + c.name, data.length(), [&]() {
+            writeQueueRecord(path, data, 1, "2026-02-18T10:30:00", crc, 1);
+        });
+
+        measure("q_read_" + c.name, data.length(), [&]() {
+            String readBack;
+            String timestamp;
+            uint32_t storedCrc;
+            uint8_t channel;
+            readQueueRecord(path, readBack, timestamp, storedCrc, channel);
+        });
+
+        String readBack;
+        String timestamp;
+        uint32_t storedCrc = 0;
+        uint8_t channel = 0;
+        TEST_ASSERT_TRUE(readQueueRecord(path, readBack, timestamp, storedCrc, channel));
+        TEST_ASSERT_TRUE(readBack == data);
+        TEST_ASSERT_EQUAL_UINT32(crc, storedCrc);
+    }
+    LittleFS.remove(path);
+    compare("q_");
+}
+
+// Per dump, the status page carries its preview and summary
+static void test_status_json() {
+    UploadStats stats;
+    stats.totalSuccess = 1234;
+    stats.queueDepth = 3;
+    stats.lastUploadTime = "2026-02-18T10:30:05";
+    stats.receiverUrl = "http://receiver.local:8080/api/dump";
+    stats.transport = "http";
+
+    for (const CorpusDump& c : s_corpus) {
+        DumpRecord last;
+        last.id = 42;
+        last.timestamp = "2026-02-18T10:30:00";
+        last.size = c.data.length();
+        last.crc = crc32Of(c.data);
+        last.preview = dumpPreview(c.data);
+        last.summary = DumpSummary::of(c.data);
+
+        measure("status_" + c.name, c.data.length(), [&]() {
+            JsonDocument doc;
+            addUploadStatus(doc, stats, last);
+            String json;
+            serializeJson(doc, json);
+        });
+    }
+    compare("status_");
+}
+
+static void test_corpus() {
+    TEST_ASSERT_EQUAL_MESSAGE(3, s_corpus.size(), "corpus/ missing or incomplete");
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    loadCorpus();
+    loadBaseline();
+    LittleFS.begin(true);
+    LittleFS.mkdir(QUEUE_DIR);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_corpus);
+    RUN_TEST(test_ingest);
+    RUN_TEST(test_preview);
+    RUN_TEST(test_queue_record);
+    RUN_TEST(test_status_json);
+    int failed = UNITY_END();
+
+    if (getenv("BENCH_SAVE")) {
+        saveBaseline();
+        return 0;
+    }
+    return failed;
+}